@@ -3,24 +3,81 @@
 
 #include "Skill.h"
 #include "SkillsTree.h"
+#include "SkillsWorldManager.h"
+#include "SkillsTreeStats.h"
+#include "GameFramework/DamageType.h"
+#include "GameFramework/Pawn.h"
+#include "Kismet/GameplayStatics.h"
 
 void ASkill::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
-    if (ProjectileCollisionFX)
+    SCOPE_CYCLE_COUNTER(STAT_SkillsOnHit);
+
+    //Only the first hit of a shot counts - repeated hits don't re-arm the release
+    if (!bIsSkillActive || bHasHit) return;
+
+    //A recorded capsule which moved into a rewound skill - it only gets hit where the shooter saw it
+    ASkillsWorldManager* Manager = SkillsManager.Get();
+    if (RewindHandle != INDEX_NONE && Manager && Manager->IsLagCompensated(OtherComp)) return;
+    bHasHit = true;
+
+    FSkillHitRecord Record;
+    Record.Skill = this;
+    Record.Target = OtherActor;
+    Record.Instigator = Instigator;
+    Record.Location = Hit.ImpactPoint;
+    Record.Normal = Hit.ImpactNormal;
+    Record.SkillType = SkillType;
+    Record.Level = (uint8)CurrentLevel;
+
+    //The effects get applied in one batch after physics - without a manager we apply them right away
+    if (!Manager || !Manager->RecordSkillHit(Record)) ApplyHitEffects(Record);
+}
+
+void ASkill::ApplyHitEffects(const FSkillHitRecord& Record)
+{
+    if (!bIsSkillActive) return;
+
+    const float HitDamage = Damage * FMath::Max<int32>(Record.Level, 1);
+
+    //The server applies the damage - cosmetic copies only play the impact
+    if (HitDamage > 0.f && !bIsCosmetic && Record.Target && !Record.Target->IsPendingKill())
     {
-        //Activate the collision FX and start the destroy timer
-        ParticleComp->SetTemplate(ProjectileCollisionFX);
-        ParticleComp->Activate(true);
+        AController* InstigatorController = Record.Instigator ? Record.Instigator->GetController() : nullptr;
+        Record.Target->TakeDamage(HitDamage, FDamageEvent(UDamageType::StaticClass()), InstigatorController, this);
+    }
+
+    if (SplashRadius > 0.f && HitDamage > 0.f && !bIsCosmetic) ApplySplashDamage(Record, HitDamage);
+
+    //The impact plays on a shared emitter so we don't have to wait for it - FX which didn't stream in yet get skipped
+    UParticleSystem* CollisionFX = ProjectileCollisionFX.Get();
+    ASkillsWorldManager* Manager = SkillsManager.Get();
+    if (CollisionFX && Manager) Manager->PlayImpactFX(CollisionFX, Record.Location, Record.Normal.Rotation());
+    else if (CollisionFX && GetNetMode() != NM_DedicatedServer) UGameplayStatics::SpawnEmitterAtLocation(this, CollisionFX, Record.Location, Record.Normal.Rotation());
 
-        FTimerHandle TimerHandle;
-        FTimerDelegate TimerDel;
+    ReleaseSkill();
+}
+
+void ASkill::ApplySplashDamage(const FSkillHitRecord& Record, float HitDamage)
+{
+    SCOPE_CYCLE_COUNTER(STAT_SkillsSplash);
 
-        TimerDel.BindLambda([&]()
-        {
-            Destroy();
-        });
+    //The targets come from the world's grid instead of an overlap against the physics scene
+    ASkillsWorldManager* Manager = SkillsManager.Get();
+    if (!Manager) return;
 
-        GetWorld()->GetTimerManager().SetTimer(TimerHandle, TimerDel, DestroyDelay, false);
+    TArray<AActor*, TInlineAllocator<16>> Targets;
+    Manager->FindSkillTargets(Record.Location, SplashRadius, Targets, Record.Instigator);
+
+    AController* InstigatorController = Record.Instigator ? Record.Instigator->GetController() : nullptr;
+    for (AActor* Target : Targets)
+    {
+        //The direct hit already took its damage
+        if (Target == Record.Target || Target->IsPendingKill()) continue;
+
+        const float Falloff = 1.f - FVector::Dist(Target->GetActorLocation(), Record.Location) / SplashRadius;
+        const float SplashDamage = HitDamage * SplashDamageScale * FMath::Clamp(Falloff, 0.f, 1.f);
+        if (SplashDamage > 0.f) Target->TakeDamage(SplashDamage, FDamageEvent(UDamageType::StaticClass()), InstigatorController, this);
     }
 }
 
@@ -32,7 +89,8 @@ ASkill::ASkill()
 
     SphereComp = CreateDefaultSubobject<USphereComponent>(FName("SphereComp"));
 
-    SphereComp->SetCollisionProfileName(FName("BlockAll"));
+    //Skills only collide with the world and pawns - see the SkillProjectile profile in DefaultEngine.ini
+    SphereComp->SetCollisionProfileName(FName("SkillProjectile"));
 
     SetRootComponent(SphereComp);
 
@@ -44,32 +102,275 @@ ASkill::ASkill()
 
     ParticleComp = CreateDefaultSubobject<UParticleSystemComponent>(FName("ParticleComp"));
     ParticleComp->SetupAttachment(SphereComp);
+
+    //Projectiles never replicate - clients rebuild them from the volley of the firing character
+    bReplicates = false;
 }
 
 // Called when the game starts or when spawned
 void ASkill::BeginPlay()
 {
+    SCOPE_CYCLE_COUNTER(STAT_SkillsSkillBeginPlay);
+
     Super::BeginPlay();
 
     SphereComp->OnComponentHit.AddDynamic(this, &ASkill::OnHit);
+    ParticleBaseLocation = ParticleComp->RelativeLocation;
+
+    //Pooled skills are activated by their pool
+    if (!bIsPooled) ActivateSkill(GetActorTransform());
+}
+
+void ASkill::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    StopBatchedSimulation();
+    StopLagCompensation();
+    StopInstancedVisual();
+    CancelExpiry();
+
+    //Destroyed in flight (level teardown, gameplay Destroy) - the pool would count us as active forever
+    ASkillsWorldManager* Manager = SkillsManager.Get();
+    if (bIsPooled && bIsSkillActive && Manager) Manager->RemoveDestroyedSkill(this);
+    bIsSkillActive = false;
+
+    Super::EndPlay(EndPlayReason);
+}
+
+void ASkill::ActivateSkill(const FTransform& SpawnTransform)
+{
+    bIsSkillActive = true;
+    bHasHit = false;
 
-    if (ProjectileFX)
+    if (!SkillsManager.IsValid()) SkillsManager = ASkillsWorldManager::Get(this);
+
+    SetActorLocationAndRotation(SpawnTransform.GetLocation(), SpawnTransform.GetRotation(), false, nullptr, ETeleportType::TeleportPhysics);
+    SetActorHiddenInGame(false);
+    SetActorEnableCollision(true);
+
+    const FVector Velocity = SpawnTransform.GetRotation().GetForwardVector() * ProjectileMovementComp->InitialSpeed;
+    ASkillsWorldManager* Manager = SkillsManager.Get();
+
+    if (bUseBatchedSimulation && Manager)
     {
-        ParticleComp->SetTemplate(ProjectileFX);
-        ParticleComp->Activate();
+        //The batched simulation moves us - no ticking for the actor or its movement comp
+        SetActorTickEnabled(false);
+        ProjectileMovementComp->Deactivate();
+
+        const float GravityZ = GetWorld()->GetGravityZ() * ProjectileMovementComp->ProjectileGravityScale;
+        SimulationHandle = Manager->RegisterSimulatedSkill(this, Velocity, SphereComp->GetScaledSphereRadius(), GravityZ);
+
+        //The simulation picks the nearest target every frame
+        if (HomingAcceleration > 0.f) Manager->SetSimulatedSkillHoming(SimulationHandle, HomingAcceleration, HomingRange);
+    }
+    else
+    {
+        SetActorTickEnabled(true);
+
+        //The movement comp clears its updated component when it stops so we need to hook it up again
+        ProjectileMovementComp->SetUpdatedComponent(SphereComp);
+        ProjectileMovementComp->Velocity = Velocity;
+        ProjectileMovementComp->UpdateComponentVelocity();
+
+        //The movement comp homes on its own - it only needs the nearest target at launch
+        AActor* HomingTarget = (HomingAcceleration > 0.f && Manager) ? Manager->FindNearestSkillTarget(SpawnTransform.GetLocation(), HomingRange, GetOwner()) : nullptr;
+        ProjectileMovementComp->bIsHomingProjectile = HomingTarget != nullptr;
+        ProjectileMovementComp->HomingTargetComponent = HomingTarget ? HomingTarget->GetRootComponent() : nullptr;
+        ProjectileMovementComp->HomingAccelerationMagnitude = HomingAcceleration;
+
+        ProjectileMovementComp->Activate(true);
+    }
+
+    //Lightweight skills get their particles from the instanced visuals once they are near enough - until the mesh streamed in they keep them
+    if (GetLightweightMesh() && Manager) VisualHandle = Manager->RegisterLightweightSkill(this);
+
+    //The FX are streamed by the world's skills manager - we never load them here
+    if (UParticleSystem* TravelFX = ProjectileFX.Get())
+    {
+        if (ParticleComp->Template != TravelFX) ParticleComp->SetTemplate(TravelFX);
+        if (VisualHandle == INDEX_NONE) ParticleComp->Activate(true);
+    }
+
+    //Skills which never hit anything get released after their lifetime
+    if (MaxLifetime > 0.f) ScheduleExpiry(MaxLifetime);
+}
+
+void ASkill::ScheduleExpiry(float Delay)
+{
+    CancelExpiry();
+
+    if (ASkillsWorldManager* Manager = SkillsManager.Get()) ExpiryHandle = Manager->ScheduleSkillExpiry(this, Delay);
+}
+
+void ASkill::CancelExpiry()
+{
+    if (ExpiryHandle == INDEX_NONE) return;
+
+    if (ASkillsWorldManager* Manager = SkillsManager.Get()) Manager->CancelSkillExpiry(ExpiryHandle);
+    ExpiryHandle = INDEX_NONE;
+}
+
+void ASkill::DeactivateSkill()
+{
+    bIsSkillActive = false;
+    bIsCosmetic = false;
+    PredictionKey = 0;
+
+    CancelExpiry();
+    StopBatchedSimulation();
+    StopLagCompensation();
+    StopInstancedVisual();
+
+    ProjectileMovementComp->StopMovementImmediately();
+    ProjectileMovementComp->Deactivate();
+    ProjectileMovementComp->bIsHomingProjectile = false;
+    ProjectileMovementComp->HomingTargetComponent = nullptr;
+    ParticleComp->Deactivate();
+
+    //The template stays for the next shot - a new one would reallocate the emitter instances. The manager clears it once the FX get evicted
+    ParticleComp->SetRelativeLocation(ParticleBaseLocation);
+
+    SetActorHiddenInGame(true);
+    SetActorEnableCollision(false);
+    SetActorTickEnabled(false);
+}
+
+FVector ASkill::CorrectPrediction(const FTransform& AuthoritativeTransform)
+{
+    const FVector Error = GetActorLocation() - AuthoritativeTransform.GetLocation();
+    const FVector Velocity = AuthoritativeTransform.GetRotation().GetForwardVector() * ProjectileMovementComp->InitialSpeed;
+
+    SetActorLocationAndRotation(AuthoritativeTransform.GetLocation(), AuthoritativeTransform.GetRotation(), false, nullptr, ETeleportType::TeleportPhysics);
+
+    ASkillsWorldManager* Manager = SkillsManager.Get();
+    if (SimulationHandle != INDEX_NONE && Manager)
+    {
+        Manager->TeleportSimulatedSkill(SimulationHandle, AuthoritativeTransform.GetLocation(), Velocity);
+    }
+    else
+    {
+        ProjectileMovementComp->Velocity = Velocity;
+        ProjectileMovementComp->UpdateComponentVelocity();
+    }
+
+    return Error;
+}
+
+void ASkill::SetVisualOffset(const FVector& WorldOffset)
+{
+    ParticleComp->SetRelativeLocation(ParticleBaseLocation + GetActorTransform().InverseTransformVectorNoScale(WorldOffset));
+}
+
+FSkillSpawnPattern ASkill::GetSpawnPattern(int32 Level) const
+{
+    if (LevelSpawnPatterns.IsValidIndex(Level - 1)) return LevelSpawnPatterns[Level - 1];
+
+    FSkillSpawnPattern Pattern;
+    Pattern.Count = FMath::Max(Level, 0);
+    return Pattern;
+}
+
+FSkillCastRules ASkill::GetCastRules(int32 Level) const
+{
+    if (LevelCastRules.Num() == 0) return FSkillCastRules();
+    return LevelCastRules[FMath::Clamp(Level - 1, 0, LevelCastRules.Num() - 1)];
+}
+
+void ASkill::StopBatchedSimulation()
+{
+    if (SimulationHandle == INDEX_NONE) return;
+
+    if (ASkillsWorldManager* Manager = SkillsManager.Get()) Manager->UnregisterSimulatedSkill(SimulationHandle);
+    SimulationHandle = INDEX_NONE;
+}
+
+void ASkill::SetParticlesEnabled(bool bEnabled)
+{
+    if (bEnabled == ParticleComp->IsActive()) return;
+
+    if (bEnabled && ParticleComp->Template) ParticleComp->Activate(true);
+    else if (!bEnabled)
+    {
+        //The instance takes over right away so the trail must not linger
+        ParticleComp->Deactivate();
+        ParticleComp->KillParticlesForced();
     }
 }
 
+void ASkill::StopInstancedVisual()
+{
+    if (VisualHandle == INDEX_NONE) return;
+
+    if (ASkillsWorldManager* Manager = SkillsManager.Get()) Manager->UnregisterLightweightSkill(VisualHandle);
+    VisualHandle = INDEX_NONE;
+}
+
+void ASkill::StartLagCompensation(float LagTime)
+{
+    ASkillsWorldManager* Manager = SkillsManager.Get();
+    if (!Manager || LagTime <= 0.f || RewindHandle != INDEX_NONE) return;
+
+    RewindHandle = Manager->RegisterRewoundSkill(this);
+    if (RewindHandle == INDEX_NONE) return;
+
+    //Recorded capsules only get hit where the shooter saw them - present-time hits would count them twice. Pawns
+    //outside the history still get hit in the present
+    LagCompensationTime = FMath::Min(LagTime, Manager->GetMaxLagCompensation());
+    TArray<UPrimitiveComponent*> Capsules;
+    Manager->GetLagCompensatedCapsules(Capsules);
+    for (UPrimitiveComponent* Capsule : Capsules) SphereComp->IgnoreComponentWhenMoving(Capsule, true);
+}
+
+void ASkill::StopLagCompensation()
+{
+    if (RewindHandle == INDEX_NONE) return;
+
+    if (ASkillsWorldManager* Manager = SkillsManager.Get()) Manager->UnregisterRewoundSkill(RewindHandle);
+    RewindHandle = INDEX_NONE;
+    LagCompensationTime = 0.f;
+
+    //Pooled skills get reused for shots which don't get rewound
+    SphereComp->ClearMoveIgnoreComponents();
+}
+
+bool ASkill::SweepSkillInWorld(const UWorld* World, const FVector& Start, const FVector& End, float SweepRadius, const FCollisionQueryParams& QueryParams, FHitResult& OutHit) const
+{
+    const FCollisionResponseParams ResponseParams(SphereComp->GetCollisionResponseToChannels());
+    return World->SweepSingleByChannel(OutHit, Start, End, FQuat::Identity, SphereComp->GetCollisionObjectType(), FCollisionShape::MakeSphere(SweepRadius), QueryParams, ResponseParams);
+}
+
+FTraceHandle ASkill::AsyncSweepSimulatedSkill(const FVector& Start, const FVector& End, float SweepRadius, const FCollisionQueryParams& QueryParams) const
+{
+    const FCollisionResponseParams ResponseParams(SphereComp->GetCollisionResponseToChannels());
+    return GetWorld()->AsyncSweepByChannel(EAsyncTraceType::Single, Start, End, SphereComp->GetCollisionObjectType(), FCollisionShape::MakeSphere(SweepRadius), QueryParams, ResponseParams);
+}
+
+void ASkill::HandleSimulatedHit(const FHitResult& Hit)
+{
+    //Same as a movement comp stopping on a blocking hit
+    StopBatchedSimulation();
+    SetActorLocation(Hit.Location, false, nullptr, ETeleportType::TeleportPhysics);
+
+    OnHit(SphereComp, Hit.GetActor(), Hit.GetComponent(), FVector::ZeroVector, Hit);
+}
+
+void ASkill::ReleaseSkill()
+{
+    ASkillsWorldManager* Manager = SkillsManager.Get();
+    if (bIsPooled && Manager) Manager->ReleaseSkill(this);
+    else Destroy();
+}
 
 void ASkill::OnConstruction(const FTransform& Transform)
 {
     Super::OnConstruction(Transform);
 
     //Used in order to have a visual feedback in the editor when we 
-    //assign a new particle
-    if (ProjectileFX)
+    //assign a new particle - game worlds get their FX from the streamer
+    UWorld* World = GetWorld();
+    UParticleSystem* TravelFX = (World && !World->IsGameWorld()) ? ProjectileFX.LoadSynchronous() : ProjectileFX.Get();
+    if (TravelFX)
     {
-        ParticleComp->SetTemplate(ProjectileFX);
+        ParticleComp->SetTemplate(TravelFX);
         ParticleComp->Activate();
     }
 }
\ No newline at end of file
@@ -7,14 +7,20 @@
 #include "Components/SphereComponent.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "Particles/ParticleSystemComponent.h"
+#include "Engine/StaticMesh.h"
 #include "ParticleDefinitions.h"
+#include "UObject/AssetPtr.h"
+#include "SkillSpawnPattern.h"
+#include "SkillCastRules.h"
 #include "Skill.generated.h"
 
 UENUM(BlueprintType)
 enum class ESkillType : uint8
 {
 	WaterBall,
-	FileBall
+	FileBall,
+
+	MAX UMETA(Hidden)
 };
 
 UCLASS()
@@ -22,6 +28,13 @@ class SKILLSTREE_API ASkill : public AActor
 {
 	GENERATED_BODY()
 
+	friend struct FSkillProjectilePool;
+	friend struct FSkillInstancedVisuals;
+	friend class ASkillsWorldManager;
+
+	/*The Lookup scenario gives its generated skill classes their own ids and types*/
+	friend class USkillsTreeBenchmarkCommandlet;
+
 private:
 	UFUNCTION()
 	void OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpusle, const FHitResult& Hit);
@@ -33,35 +46,187 @@ public:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	virtual void OnConstruction(const FTransform& Transform) override;
 
-	/*Increases the level by one - clamps on max level*/
-	UFUNCTION(BlueprintCallable,Category=TLSkillsTree)
-	void AdvanceLevel() { CurrentLevel = (CurrentLevel + 1 > MaxLevel) ? 1 : ++CurrentLevel; }
+	/*Places the skill at the given transform and starts its movement and FX - called by the pool instead of BeginPlay*/
+	virtual void ActivateSkill(const FTransform& SpawnTransform);
 
-	/*Resets the level of the skill - 0 means that the player will not be able to fire*/
-	UFUNCTION(BlueprintCallable,Category=TLSkillsTree)
-	void ResetLevel() { CurrentLevel = 0; }
+	/*Hides the skill and stops its movement, collision and FX - called by the pool instead of Destroy*/
+	virtual void DeactivateSkill();
 
-	/*Returns the level of the current skill*/
-	UFUNCTION(BlueprintCallable,Category=TLSkillsTree)
-	int32 GetLevel() { return CurrentLevel; }
+	/*Returns the skill to its pool - non pooled skills get destroyed*/
+	void ReleaseSkill();
+
+	/*Returns true if the skill is in flight (or playing its collision FX)*/
+	bool IsSkillActive() const { return bIsSkillActive; }
+
+	/*Returns true if the skill is owned by a projectile pool*/
+	bool IsPooled() const { return bIsPooled; }
+
+	/*Returns true if the skill is moved by the world's batched simulation instead of its movement comp*/
+	bool UsesBatchedSimulation() const { return bUseBatchedSimulation; }
+
+	/*Sweeps the collision sphere of the skill from Start to End - used by the batched simulation*/
+	bool SweepSimulatedSkill(const FVector& Start, const FVector& End, float SweepRadius, const FCollisionQueryParams& QueryParams, FHitResult& OutHit) const { return SweepSkillInWorld(GetWorld(), Start, End, SweepRadius, QueryParams, OutHit); }
 
-	/*Returns the skill's texture*/
+	/*Same as SweepSimulatedSkill in the given world - works on the default object, which has no world of its own*/
+	bool SweepSkillInWorld(const UWorld* World, const FVector& Start, const FVector& End, float SweepRadius, const FCollisionQueryParams& QueryParams, FHitResult& OutHit) const;
+
+	/*Same as SweepSimulatedSkill but as an async trace - the result is available on the next frame*/
+	FTraceHandle AsyncSweepSimulatedSkill(const FVector& Start, const FVector& End, float SweepRadius, const FCollisionQueryParams& QueryParams) const;
+
+	/*Called by the batched simulation when the skill hit something*/
+	void HandleSimulatedHit(const FHitResult& Hit);
+
+	/*Applies the damage and impact FX of a recorded hit and releases the skill - called by the world's hit batch*/
+	virtual void ApplyHitEffects(const struct FSkillHitRecord& Record);
+
+	/*Damages the skill targets within SplashRadius of the hit, except the one which got hit directly*/
+	void ApplySplashDamage(const struct FSkillHitRecord& Record, float HitDamage);
+
+	/*Returns the level the projectile was fired with - the learned levels live in USkillsComponent*/
+	int32 GetLevel() const { return CurrentLevel; }
+
+	/*Returns the skill's texture - null until the texture got streamed in*/
 	UFUNCTION(BlueprintCallable,Category=TLSkillsTree)
-	UTexture* GetSkillTexture() { return SkillTexture; }
+	UTexture* GetSkillTexture() { return SkillTexture.Get(); }
+
+	/*Returns the soft reference to the skill's texture*/
+	const TAssetPtr<UTexture>& GetSkillTextureAsset() const { return SkillTexture; }
+
+	/*Returns the soft reference to the traveling FX*/
+	const TAssetPtr<UParticleSystem>& GetProjectileFXAsset() const { return ProjectileFX; }
+
+	/*Returns the soft reference to the collision FX*/
+	const TAssetPtr<UParticleSystem>& GetCollisionFXAsset() const { return ProjectileCollisionFX; }
 
 	/*Returns the skill type*/
-	ESkillType GetSkillType() { return SkillType; }
+	ESkillType GetSkillType() const { return SkillType; }
+
+	/*Returns the id used by data driven lookups - the class name when no id was assigned*/
+	FName GetSkillId() const { return SkillId.IsNone() ? GetClass()->GetFName() : SkillId; }
+
+	/*Returns the max level of the skill*/
+	int32 GetMaxLevel() const { return MaxLevel; }
+
+	/*Returns true if the skill has its own muzzle offset*/
+	bool OverridesMuzzleOffset() const { return bOverrideMuzzleOffset; }
+
+	/*Returns the spawn point relative to the firing character - only used if OverridesMuzzleOffset*/
+	const FTransform& GetMuzzleOffset() const { return MuzzleOffset; }
+
+	/*Returns the spawn pattern of the given level - defaults to a fan with one projectile per level*/
+	FSkillSpawnPattern GetSpawnPattern(int32 Level) const;
+
+	/*Returns the cooldown, charges and mana cost of the given level*/
+	FSkillCastRules GetCastRules(int32 Level) const;
+
+	/*Sets the level this projectile was fired with*/
+	void SetLevel(int32 NewLevel) { CurrentLevel = FMath::Clamp(NewLevel, 0, MaxLevel); }
+
+	/*Returns the random spread of each projectile in degrees*/
+	float GetSpreadJitter() const { return SpreadJitter; }
+
+	/*Returns the speed the skill gets fired with*/
+	float GetInitialSpeed() const { return ProjectileMovementComp->InitialSpeed; }
+
+	/*Cosmetic skills are client side copies of a server volley - they play their FX but never apply damage*/
+	void SetCosmetic(bool bInCosmetic) { bIsCosmetic = bInCosmetic; }
+
+	/*Returns true if the skill is a client side copy of a server volley*/
+	bool IsCosmetic() const { return bIsCosmetic; }
+
+	/*Tags the skill with the key of the predicted volley it belongs to*/
+	void SetPredictionKey(uint16 Key) { PredictionKey = Key; }
+
+	/*Returns the key of the predicted volley - 0 for skills which were not predicted*/
+	uint16 GetPredictionKey() const { return PredictionKey; }
+
+	/*Moves a predicted skill onto the path of the server's projectile - returns how far the skill was off*/
+	FVector CorrectPrediction(const FTransform& AuthoritativeTransform);
+
+	/*Offsets the visuals from the collision - lets a corrected skill blend into its new path*/
+	void SetVisualOffset(const FVector& WorldOffset);
+
+	/*Checks the skill's hits against where the shooter saw its targets LagTime seconds ago - server only*/
+	void StartLagCompensation(float LagTime);
+
+	/*Returns the components the skill passes through - the recorded capsules while its hits get rewound*/
+	const TArray<UPrimitiveComponent*>& GetIgnoredComponents() const { return SphereComp->GetMoveIgnoreComponents(); }
+
+	/*Returns the radius of the collision sphere*/
+	float GetCollisionRadius() const { return SphereComp->GetScaledSphereRadius(); }
+
+	/*Returns the mesh which stands in for the particles of far away projectiles - null if the skill always uses its particles or the mesh didn't stream in yet*/
+	UStaticMesh* GetLightweightMesh() const { return LightweightMesh.Get(); }
+
+	/*Returns the soft reference to the lightweight mesh*/
+	const TAssetPtr<UStaticMesh>& GetLightweightMeshAsset() const { return LightweightMesh; }
+
+	/*Returns the scale of the lightweight mesh*/
+	const FVector& GetLightweightScale() const { return LightweightScale; }
 
-	/*Returns true if the level is maxed out*/
-	bool IsMaxLevel() { return CurrentLevel == MaxLevel; }
+	/*Switches between the particle comp and an instance of the lightweight mesh - called by the world's instanced visuals*/
+	void SetParticlesEnabled(bool bEnabled);
 
 private:
 	int32 CurrentLevel = 1;
 
 	int32 MaxLevel = 3;
 
+	/*True when the skill was spawned by the projectile pool*/
+	bool bIsPooled = false;
+
+	/*True between ActivateSkill and DeactivateSkill*/
+	bool bIsSkillActive = false;
+
+	/*True for client side copies of a server volley - reset when the skill gets deactivated*/
+	bool bIsCosmetic = false;
+
+	/*The predicted volley this skill belongs to - reset when the skill gets deactivated*/
+	uint16 PredictionKey = 0;
+
+	/*Where the particle comp sits relative to the sphere without a visual offset*/
+	FVector ParticleBaseLocation = FVector::ZeroVector;
+
+	/*The manager whose pool this skill returns to*/
+	TWeakObjectPtr<class ASkillsWorldManager> SkillsManager;
+
+	/*True once the skill hit something - further hits of the same shot get ignored*/
+	bool bHasHit = false;
+
+	/*Handle in the world's expiry wheel - INDEX_NONE when no release is pending*/
+	int32 ExpiryHandle = INDEX_NONE;
+
+	/*Releases the skill after Delay seconds - replaces any pending expiry*/
+	void ScheduleExpiry(float Delay);
+
+	/*Cancels the pending expiry*/
+	void CancelExpiry();
+
+	/*Handle in the world's batched simulation - INDEX_NONE when not simulated*/
+	int32 SimulationHandle = INDEX_NONE;
+
+	/*Removes the skill from the batched simulation*/
+	void StopBatchedSimulation();
+
+	/*How far back the server checks the skill's hits - the shooter saw its targets this many seconds ago. While it is above 0 the skill passes through the capsules of the history*/
+	float LagCompensationTime = 0.f;
+
+	/*Handle in the world's rewound skills - INDEX_NONE when the skill's hits are not rewound*/
+	int32 RewindHandle = INDEX_NONE;
+
+	/*Stops checking the skill against the capsule history*/
+	void StopLagCompensation();
+
+	/*Handle in the world's instanced visuals - INDEX_NONE when the skill draws its particles itself*/
+	int32 VisualHandle = INDEX_NONE;
+
+	/*Removes the skill from the world's instanced visuals*/
+	void StopInstancedVisual();
+
 protected:
 	/*Sphere comp used for collision*/
 	UPROPERTY(VisibleAnywhere)
@@ -75,24 +240,81 @@ protected:
 	UPROPERTY(VisibleAnywhere)
 	UParticleSystemComponent* ParticleComp;
 
-	/*The particle system for our projectile when traveling*/
+	/*The particle system for our projectile when traveling - streamed in once a character learns the skill*/
 	UPROPERTY(EditDefaultsOnly)
-	UParticleSystem* ProjectileFX;
+	TAssetPtr<UParticleSystem> ProjectileFX;
 
-	/*The particle system for our collision*/
+	/*The particle system for our collision - streamed in along with ProjectileFX*/
 	UPROPERTY(EditDefaultsOnly)
-	UParticleSystem* ProjectileCollisionFX;
+	TAssetPtr<UParticleSystem> ProjectileCollisionFX;
 
-	/*The skill texture*/
+	/*The skill texture - streamed in when a skill panel asks for it*/
 	UPROPERTY(EditDefaultsOnly)
-	UTexture* SkillTexture;
+	TAssetPtr<UTexture> SkillTexture;
 
-	/*The time (after a collision has happened) that our skill will get destroyed*/
-	UPROPERTY(EditAnywhere)
-	float DestroyDelay = 1.5f;
+	/*The damage of a hit - gets multiplied by the level of the skill*/
+	UPROPERTY(EditDefaultsOnly)
+	float Damage = 0.f;
+
+	/*The time after which a skill that never hit anything gets released - 0 means never*/
+	UPROPERTY(EditDefaultsOnly)
+	float MaxLifetime = 10.f;
 
 	/*The skill type of the skill*/
 	UPROPERTY(EditDefaultsOnly)
 	ESkillType SkillType;
+
+	/*Unique id of the skill for data driven skills which share a skill type - leave None to use the class name*/
+	UPROPERTY(EditDefaultsOnly)
+	FName SkillId;
+
+	/*The spawn pattern of each level - the first entry is level 1. Levels without an entry fire one projectile per level*/
+	UPROPERTY(EditDefaultsOnly)
+	TArray<FSkillSpawnPattern> LevelSpawnPatterns;
+
+	/*The cooldown, charges and mana cost of each level - the first entry is level 1. Levels without an entry use the last one*/
+	UPROPERTY(EditDefaultsOnly)
+	TArray<FSkillCastRules> LevelCastRules;
+
+	/*Targets within this radius of a hit take splash damage - 0 means the skill only damages what it hits*/
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "0"))
+	float SplashRadius = 0.f;
+
+	/*The splash damage at the center of the hit as a fraction of the hit damage - falls off to 0 at SplashRadius*/
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "0"))
+	float SplashDamageScale = 0.5f;
+
+	/*How fast the skill turns towards the nearest skill target - 0 means the skill flies straight*/
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "0"))
+	float HomingAcceleration = 0.f;
+
+	/*Homing skills only pick targets within this radius*/
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "0"))
+	float HomingRange = 2000.f;
+
+	/*Random rotation of each projectile in degrees - seeded by the volley so every client rolls the same spread*/
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "0"))
+	float SpreadJitter = 0.f;
+
+	/*When true the skill spawns at MuzzleOffset instead of the muzzle of the character*/
+	UPROPERTY(EditDefaultsOnly)
+	bool bOverrideMuzzleOffset = false;
+
+	/*Where the skill spawns, relative to the firing character*/
+	UPROPERTY(EditDefaultsOnly, meta = (EditCondition = "bOverrideMuzzleOffset"))
+	FTransform MuzzleOffset;
+
+	/*When true the skill doesn't tick - it gets moved by the world's batched projectile simulation instead*/
+	UPROPERTY(EditDefaultsOnly)
+	bool bUseBatchedSimulation = false;
+
+	/*When set, only the projectiles nearest to the camera play ProjectileFX - the others get drawn as
+	one instance each of this mesh, which the world shares between every skill using the mesh. Streamed in along with ProjectileFX*/
+	UPROPERTY(EditDefaultsOnly)
+	TAssetPtr<UStaticMesh> LightweightMesh;
+
+	/*The scale of each instance of the lightweight mesh*/
+	UPROPERTY(EditDefaultsOnly)
+	FVector LightweightScale = FVector::OneVector;
 };
 
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillAssetStreamer.h"
+#include "Skill.h"
+
+TSharedPtr<FStreamableHandle> FSkillAssetStreamer::RequestIcons(const TArray<TSubclassOf<ASkill>>& SkillClasses, FStreamableDelegate OnLoaded)
+{
+    TArray<FStringAssetReference> Icons;
+    for (auto SkillClass : SkillClasses)
+    {
+        const TAssetPtr<UTexture>& Icon = SkillClass ? SkillClass->GetDefaultObject<ASkill>()->GetSkillTextureAsset() : TAssetPtr<UTexture>();
+        if (!Icon.IsNull()) Icons.AddUnique(Icon.ToStringReference());
+    }
+
+    //The panel is on screen - icons go before everything else
+    return StreamableManager.RequestAsyncLoad(Icons, OnLoaded, FStreamableManager::AsyncLoadHighPriority);
+}
+
+FSkillAssetStreamer::FEntry& FSkillAssetStreamer::FindOrLoad(TSubclassOf<ASkill> SkillClass, TAsyncLoadPriority Priority)
+{
+    if (FEntry* Entry = Entries.Find(SkillClass)) return *Entry;
+
+    const ASkill* Skill = SkillClass->GetDefaultObject<ASkill>();
+
+    //The lightweight mesh only ever draws in place of the FX - it comes and goes with them
+    TArray<FStringAssetReference> FX;
+    if (!Skill->GetProjectileFXAsset().IsNull()) FX.Add(Skill->GetProjectileFXAsset().ToStringReference());
+    if (!Skill->GetCollisionFXAsset().IsNull()) FX.Add(Skill->GetCollisionFXAsset().ToStringReference());
+    if (!Skill->GetLightweightMeshAsset().IsNull()) FX.Add(Skill->GetLightweightMeshAsset().ToStringReference());
+
+    FEntry& Entry = Entries.Add(SkillClass);
+    if (FX.Num() > 0) Entry.Handle = StreamableManager.RequestAsyncLoad(FX, FStreamableDelegate(), Priority);
+    return Entry;
+}
+
+void FSkillAssetStreamer::AcquireFX(TSubclassOf<ASkill> SkillClass, float Now)
+{
+    if (!SkillClass) return;
+
+    FEntry& Entry = FindOrLoad(SkillClass, FStreamableManager::DefaultAsyncLoadPriority);
+    Entry.RefCount++;
+    Entry.LastUsedTime = Now;
+}
+
+void FSkillAssetStreamer::ReleaseFX(TSubclassOf<ASkill> SkillClass, float Now)
+{
+    FEntry* Entry = SkillClass ? Entries.Find(SkillClass) : nullptr;
+    if (!Entry) return;
+
+    Entry->RefCount = FMath::Max(Entry->RefCount - 1, 0);
+    Entry->LastUsedTime = Now;
+}
+
+void FSkillAssetStreamer::TouchFX(TSubclassOf<ASkill> SkillClass, float Now)
+{
+    if (!SkillClass) return;
+
+    //Nobody learned the skill through a skills component - it's about to be fired so it can't wait
+    FindOrLoad(SkillClass, FStreamableManager::AsyncLoadHighPriority).LastUsedTime = Now;
+}
+
+void FSkillAssetStreamer::EvictColdFX(float Now, TArray<const UClass*>& OutEvicted)
+{
+    for (auto It = Entries.CreateIterator(); It; ++It)
+    {
+        const FEntry& Entry = It.Value();
+        if (Entry.RefCount > 0 || Now - Entry.LastUsedTime < ColdTime) continue;
+
+        if (Entry.Handle.IsValid()) Entry.Handle->ReleaseHandle();
+        OutEvicted.Add(It.Key());
+        It.RemoveCurrent();
+    }
+}
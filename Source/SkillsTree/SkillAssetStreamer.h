@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/StreamableManager.h"
+
+class ASkill;
+
+/*Streams the soft referenced assets of the skills of a world.
+FX (and the lightweight mesh which stands in for them) are reference counted per skill class - every character which learned a skill holds a reference.
+Unreferenced FX stay loaded for ColdTime seconds after their last use and get released afterwards so the
+garbage collector can unload them. Icons are requested in bulk and stay loaded while the caller holds the handle*/
+class SKILLSTREE_API FSkillAssetStreamer
+{
+public:
+	/*Starts loading the icons of the given skills - OnLoaded gets called once every icon is loaded*/
+	TSharedPtr<FStreamableHandle> RequestIcons(const TArray<TSubclassOf<ASkill>>& SkillClasses, FStreamableDelegate OnLoaded);
+
+	/*Adds a reference to the FX of the given skill and starts loading them*/
+	void AcquireFX(TSubclassOf<ASkill> SkillClass, float Now);
+
+	/*Removes a reference to the FX of the given skill - the FX get evicted once they're cold*/
+	void ReleaseFX(TSubclassOf<ASkill> SkillClass, float Now);
+
+	/*Marks the FX of the given skill as used - loads them with high priority if nobody prefetched them*/
+	void TouchFX(TSubclassOf<ASkill> SkillClass, float Now);
+
+	/*Releases every unreferenced FX which wasn't used during the last ColdTime seconds - appends their skill classes to OutEvicted*/
+	void EvictColdFX(float Now, TArray<const UClass*>& OutEvicted);
+
+	/*Returns the number of skill classes whose FX are loaded or loading*/
+	int32 GetNumStreamedFX() const { return Entries.Num(); }
+
+	/*Unreferenced FX get evicted after this many seconds*/
+	float ColdTime = 30.f;
+
+private:
+	struct FEntry
+	{
+		TSharedPtr<FStreamableHandle> Handle;
+
+		int32 RefCount = 0;
+
+		float LastUsedTime = 0.f;
+	};
+
+	/*Returns the entry of the given class - starts loading its FX with the given priority if there is none*/
+	FEntry& FindOrLoad(TSubclassOf<ASkill> SkillClass, TAsyncLoadPriority Priority);
+
+	FStreamableManager StreamableManager;
+
+	TMap<const UClass*, FEntry> Entries;
+};
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SkillCastRules.generated.h"
+
+/*Cooldown, charges and mana cost of one skill level*/
+USTRUCT(BlueprintType)
+struct SKILLSTREE_API FSkillCastRules
+{
+	GENERATED_BODY()
+
+	/*Seconds until a spent charge comes back - 0 means the skill has no cooldown*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree, meta = (ClampMin = "0"))
+	float Cooldown = 0.f;
+
+	/*Casts which can be stored up while the skill recharges*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree, meta = (ClampMin = "1"))
+	int32 Charges = 1;
+
+	/*The mana each cast takes*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree, meta = (ClampMin = "0"))
+	float ManaCost = 0.f;
+};
+
+/*The cast rules of one slot level as the cast checks read them - compiled by USkillsComponent*/
+struct FSkillCastLimits
+{
+	float Cooldown = 0.f;
+
+	/*How far the recharge of every charge may lie ahead for a cast to be allowed - (Charges - 1) * Cooldown*/
+	float ChargeWindow = 0.f;
+
+	float ManaCost = 0.f;
+
+	int32 Charges = 0;
+
+	FSkillCastLimits() {}
+
+	explicit FSkillCastLimits(const FSkillCastRules& Rules)
+		: Cooldown(FMath::Max(Rules.Cooldown, 0.f))
+		, ManaCost(FMath::Max(Rules.ManaCost, 0.f))
+		, Charges(FMath::Max(Rules.Charges, 1))
+	{
+		ChargeWindow = (Charges - 1) * Cooldown;
+	}
+
+	/*The limits of level 0 - unlearned skills can never be cast*/
+	static FSkillCastLimits Unlearned()
+	{
+		FSkillCastLimits Limits;
+		Limits.ManaCost = MAX_FLT;
+		return Limits;
+	}
+};
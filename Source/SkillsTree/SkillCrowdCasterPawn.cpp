@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillCrowdCasterPawn.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/World.h"
+#include "SkillsWorldManager.h"
+#include "SkillsTreeStats.h"
+
+ASkillCrowdCasterPawn::ASkillCrowdCasterPawn()
+{
+    //The world's skills manager thinks for us
+    PrimaryActorTick.bCanEverTick = false;
+
+    //Crowd casters don't need a controller - the casts are decided by the crowd
+    AutoPossessAI = EAutoPossessAI::Disabled;
+    bReplicates = true;
+
+    CapsuleComp = CreateDefaultSubobject<UCapsuleComponent>(TEXT("CapsuleComp"));
+    CapsuleComp->InitCapsuleSize(42.f, 96.f);
+    CapsuleComp->SetCollisionProfileName(UCollisionProfile::Pawn_ProfileName);
+    RootComponent = CapsuleComp;
+
+    MeshComp = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("MeshComp"));
+    MeshComp->SetupAttachment(CapsuleComp);
+    MeshComp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+    MeshComp->bGenerateOverlapEvents = false;
+
+    SkillsComponent = CreateDefaultSubobject<USkillsComponent>(TEXT("SkillsComponent"));
+
+    //Skills spawn in front of the caster
+    MuzzleOffset = FTransform(FVector(100.f, 0.f, 0.f));
+}
+
+void ASkillCrowdCasterPawn::BeginPlay()
+{
+    Super::BeginPlay();
+
+    //The skills component reset its levels in its own BeginPlay
+    if (HasAuthority() && bLearnSkillsOnBeginPlay)
+    {
+        for (int32 SkillNum = 0; SkillNum < SkillsComponent->SkillsArray.Num(); SkillNum++) SkillsComponent->AdvanceSkillLevelAtSlot(SkillNum);
+    }
+
+    ASkillsWorldManager* SkillsManager = ASkillsWorldManager::Get(this);
+    if (!SkillsManager) return;
+
+    if (bLagCompensated) LagCompensationHandle = SkillsManager->RegisterLagCompensatedCapsule(CapsuleComp);
+    SkillTargetHandle = SkillsManager->RegisterSkillTarget(this);
+    RegisteredManager = SkillsManager;
+
+    //Only the server decides casts - clients get the volleys
+    if (HasAuthority()) CrowdHandle = SkillsManager->RegisterCrowdCaster(this, SkillTargetHandle);
+}
+
+void ASkillCrowdCasterPawn::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    //Not Get - that would spawn a manager while the world tears down
+    ASkillsWorldManager* SkillsManager = RegisteredManager.Get();
+    if (SkillsManager && CrowdHandle != INDEX_NONE) SkillsManager->UnregisterCrowdCaster(CrowdHandle);
+    if (SkillsManager && LagCompensationHandle != INDEX_NONE) SkillsManager->UnregisterLagCompensatedCapsule(LagCompensationHandle);
+    if (SkillsManager && SkillTargetHandle != INDEX_NONE) SkillsManager->UnregisterSkillTarget(SkillTargetHandle);
+    CrowdHandle = INDEX_NONE;
+    LagCompensationHandle = INDEX_NONE;
+    SkillTargetHandle = INDEX_NONE;
+
+    Super::EndPlay(EndPlayReason);
+}
+
+bool ASkillCrowdCasterPawn::CastSkillAt(int32 SkillNum, const FVector& TargetLocation)
+{
+    SCOPE_CYCLE_COUNTER(STAT_SkillsFire);
+
+    if (!SkillsComponent->TryCastSkill(SkillNum, GetWorld()->GetTimeSeconds())) return false;
+
+    //Skills may bring their own muzzle offset, otherwise we use the caster's one
+    const FSkillSlotInfo* Info = SkillsComponent->GetSkillSlotInfo(SkillNum);
+    const FTransform Muzzle = ((Info && Info->bOverrideMuzzleOffset) ? Info->MuzzleOffset : MuzzleOffset) * GetActorTransform();
+
+    //The pattern faces the target - turning the caster would only cost a transform update
+    const FTransform Origin((TargetLocation - Muzzle.GetLocation()).Rotation(), Muzzle.GetLocation());
+    const FSkillVolley Volley = SkillsComponent->MakeVolley(SkillNum, SkillsComponent->GetSkillLevel(SkillNum), Origin);
+    SkillsComponent->FireVolley(Volley, 0.f, false);
+
+    if (GetNetMode() != NM_Standalone) MulticastFireVolley(Volley);
+    return true;
+}
+
+void ASkillCrowdCasterPawn::MulticastFireVolley_Implementation(const FSkillVolley& Volley)
+{
+    //The server already fired the real projectiles
+    if (HasAuthority()) return;
+
+    SkillsComponent->FireVolley(Volley, SkillsComponent->GetVolleyCatchUpTime(Volley, MaxVolleyCatchUp), true);
+}
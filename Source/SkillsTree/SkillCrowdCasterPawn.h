@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Pawn.h"
+#include "SkillsComponent.h"
+#include "SkillVolley.h"
+#include "SkillCrowdCasterPawn.generated.h"
+
+/*A lean NPC which casts the skills of its skills component at the nearest skill target of another team.
+It has no camera, no movement component and doesn't tick - the world's skills manager decides the casts of
+every crowd caster in one batch and fires them through the same volley path as the players' shots*/
+UCLASS(Config = Game)
+class SKILLSTREE_API ASkillCrowdCasterPawn : public APawn
+{
+	GENERATED_BODY()
+
+public:
+	ASkillCrowdCasterPawn();
+
+	/*Learns the skills and registers with the world's crowd*/
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/*Returns the skills component*/
+	UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
+	USkillsComponent* GetSkillsComponent() const { return SkillsComponent; }
+
+	/*Casts the given skill's index at TargetLocation if it is ready - server only, returns true if the skill was cast*/
+	bool CastSkillAt(int32 SkillNum, const FVector& TargetLocation);
+
+	/*Returns the distance within which the caster picks its targets*/
+	float GetCastRange() const { return CastRange; }
+
+	/*Returns the seconds between two decisions of the caster*/
+	float GetThinkInterval() const { return ThinkInterval; }
+
+	/*Returns the team of the caster - 0 means no team*/
+	uint8 GetTeam() const { return Team; }
+
+	/*Sets the team of the caster - only before BeginPlay, the crowd reads it once*/
+	void SetTeam(uint8 InTeam) { Team = InTeam; }
+
+protected:
+	/*The collision of the caster - the skills hit it*/
+	UPROPERTY(VisibleAnywhere)
+	class UCapsuleComponent* CapsuleComp;
+
+	/*The look of the caster - a static mesh so a crowd doesn't pay for skeletal animation*/
+	UPROPERTY(VisibleAnywhere)
+	class UStaticMeshComponent* MeshComp;
+
+	/*Skills Component reference*/
+	UPROPERTY(VisibleAnywhere)
+	USkillsComponent* SkillsComponent;
+
+	/*Where the skills get spawned, relative to the caster - skills can override it*/
+	UPROPERTY(EditDefaultsOnly, Category = TLSkillsTree)
+	FTransform MuzzleOffset;
+
+	/*The caster only picks targets within this distance*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree, meta = (ClampMin = "0"))
+	float CastRange = 2000.f;
+
+	/*The seconds between two decisions - the cooldowns of the skills still apply*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree, meta = (ClampMin = "0"))
+	float ThinkInterval = 0.5f;
+
+	/*Casters never target casters of their own team - 0 targets everyone*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree)
+	uint8 Team = 1;
+
+	/*When true the server spends the available skill points on BeginPlay, one level per skill in SkillsArray order*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree)
+	bool bLearnSkillsOnBeginPlay = true;
+
+	/*When true the server records the caster's capsule so remote shooters hit it where they saw it. Off by default - a
+	crowd would fill the history and leave no room for the players; casters outside it get hit where they are*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree)
+	bool bLagCompensated = false;
+
+	/*Clients move the projectiles of a volley forward by the time it took to arrive, up to this many seconds*/
+	UPROPERTY(EditDefaultsOnly, Category = TLSkillsTree)
+	float MaxVolleyCatchUp = 0.25f;
+
+private:
+	/*One RPC per cast - clients rebuild the volley locally*/
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastFireVolley(const FSkillVolley& Volley);
+
+	/*Our handle in the world's crowd - INDEX_NONE on clients*/
+	int32 CrowdHandle = INDEX_NONE;
+
+	/*Our capsule's handle in the world's lag compensation history - INDEX_NONE unless bLagCompensated*/
+	int32 LagCompensationHandle = INDEX_NONE;
+
+	/*Our handle in the world's skill targets*/
+	int32 SkillTargetHandle = INDEX_NONE;
+
+	/*The manager which holds our handles*/
+	TWeakObjectPtr<class ASkillsWorldManager> RegisteredManager;
+};
@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillCrowdCasters.h"
+#include "Async/ParallelFor.h"
+#include "SkillCrowdCasterPawn.h"
+#include "SkillSpatialHash.h"
+#include "SkillsTreeStats.h"
+
+int32 FSkillCrowdCasters::Add(ASkillCrowdCasterPawn* Caster, int32 TargetSlot, float Time)
+{
+    int32 Handle;
+    if (FreeHandles.Num() > 0) Handle = FreeHandles.Pop(false);
+    else Handle = HandleToIndex.Add(INDEX_NONE);
+
+    const int32 Index = Casters.Add(Caster);
+    HandleToIndex[Handle] = Index;
+    IndexToHandle.Add(Handle);
+
+    const float ThinkInterval = FMath::Max(Caster->GetThinkInterval(), 0.f);
+    SkillsComponents.Add(Caster->GetSkillsComponent());
+    TargetSlots.Add(TargetSlot);
+    Ranges.Add(Caster->GetCastRange());
+    ThinkIntervals.Add(ThinkInterval);
+    Teams.Add(Caster->GetTeam());
+    CastSkillNums.Add(INDEX_NONE);
+    CastTargets.Add(INDEX_NONE);
+
+    //A random phase so casters which spawned together don't all think in the same frame
+    NextThinkTimes.Add(Time + FMath::FRand() * ThinkInterval);
+
+    if (TargetSlot != INDEX_NONE)
+    {
+        if (TargetSlot >= TeamByTargetSlot.Num()) TeamByTargetSlot.SetNumZeroed(TargetSlot + 1);
+        TeamByTargetSlot[TargetSlot] = Caster->GetTeam();
+    }
+
+    return Handle;
+}
+
+void FSkillCrowdCasters::Remove(int32 Handle)
+{
+    if (!HandleToIndex.IsValidIndex(Handle) || HandleToIndex[Handle] == INDEX_NONE) return;
+
+    RemoveAtIndex(HandleToIndex[Handle]);
+    HandleToIndex[Handle] = INDEX_NONE;
+    FreeHandles.Add(Handle);
+}
+
+void FSkillCrowdCasters::RemoveAtIndex(int32 Index)
+{
+    //The slot goes back to the grid - whoever gets it next is not on our team
+    if (TeamByTargetSlot.IsValidIndex(TargetSlots[Index])) TeamByTargetSlot[TargetSlots[Index]] = 0;
+
+    //Swap the last caster in the freed slot so the arrays stay dense
+    const int32 LastIndex = Casters.Num() - 1;
+    if (Index != LastIndex) HandleToIndex[IndexToHandle[LastIndex]] = Index;
+
+    IndexToHandle.RemoveAtSwap(Index, 1, false);
+    Casters.RemoveAtSwap(Index, 1, false);
+    SkillsComponents.RemoveAtSwap(Index, 1, false);
+    TargetSlots.RemoveAtSwap(Index, 1, false);
+    Ranges.RemoveAtSwap(Index, 1, false);
+    ThinkIntervals.RemoveAtSwap(Index, 1, false);
+    NextThinkTimes.RemoveAtSwap(Index, 1, false);
+    Teams.RemoveAtSwap(Index, 1, false);
+    CastSkillNums.RemoveAtSwap(Index, 1, false);
+    CastTargets.RemoveAtSwap(Index, 1, false);
+}
+
+SIZE_T FSkillCrowdCasters::GetAllocatedSize() const
+{
+    return Casters.GetAllocatedSize() + SkillsComponents.GetAllocatedSize() + TargetSlots.GetAllocatedSize() + Ranges.GetAllocatedSize()
+        + ThinkIntervals.GetAllocatedSize() + NextThinkTimes.GetAllocatedSize() + Teams.GetAllocatedSize()
+        + CastSkillNums.GetAllocatedSize() + CastTargets.GetAllocatedSize() + TeamByTargetSlot.GetAllocatedSize()
+        + IndexToHandle.GetAllocatedSize() + HandleToIndex.GetAllocatedSize() + FreeHandles.GetAllocatedSize();
+}
+
+void FSkillCrowdCasters::ThinkRange(int32 Start, int32 End, float Time)
+{
+    //A few candidates so a target of our own team doesn't hide the next enemy
+    TArray<int32, TInlineAllocator<16>> Nearest;
+
+    for (int32 i = Start; i < End; i++)
+    {
+        CastSkillNums[i] = INDEX_NONE;
+        if (Time < NextThinkTimes[i]) continue;
+
+        NextThinkTimes[i] = Time + ThinkIntervals[i];
+
+        //The skill first - it is two loads per slot, the target query is the expensive part
+        const USkillsComponent* SkillsComponent = SkillsComponents[i];
+        const int32 NumSkills = SkillsComponent->SkillsArray.Num();
+
+        int32 SkillNum = 0;
+        while (SkillNum < NumSkills && !SkillsComponent->CanCastSkill(SkillNum, Time)) SkillNum++;
+        if (SkillNum == NumSkills || TargetSlots[i] == INDEX_NONE) continue;
+
+        Targets->QueryNearest(Targets->GetLocation(TargetSlots[i]), Ranges[i], 4, Nearest, Casters[i]);
+        for (int32 Slot : Nearest)
+        {
+            const uint8 TargetTeam = TeamByTargetSlot.IsValidIndex(Slot) ? TeamByTargetSlot[Slot] : 0;
+            if (Teams[i] != 0 && TargetTeam == Teams[i]) continue;
+
+            CastSkillNums[i] = SkillNum;
+            CastTargets[i] = Slot;
+            break;
+        }
+    }
+}
+
+void FSkillCrowdCasters::Update(float Time)
+{
+    NumCasts = 0;
+
+    const int32 NumCasters = Casters.Num();
+    if (NumCasters == 0 || !Targets) return;
+
+    {
+        SCOPE_CYCLE_COUNTER(STAT_SkillsCrowdThink);
+
+        //The components and the grid only get read here - casts change them on the game thread afterwards
+        const int32 NumChunks = FMath::DivideAndRoundUp(NumCasters, ChunkSize);
+        ParallelFor(NumChunks, [this, NumCasters, Time](int32 Chunk)
+        {
+            const int32 Start = Chunk * ChunkSize;
+            ThinkRange(Start, FMath::Min(Start + ChunkSize, NumCasters), Time);
+        }, NumChunks < 2);
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_SkillsCrowdCast);
+
+    for (int32 i = 0; i < NumCasters; i++)
+    {
+        if (CastSkillNums[i] == INDEX_NONE) continue;
+
+        if (Casters[i]->CastSkillAt(CastSkillNums[i], Targets->GetLocation(CastTargets[i]))) NumCasts++;
+    }
+
+    INC_DWORD_STAT_BY(STAT_SkillsCrowdCasts, NumCasts);
+}
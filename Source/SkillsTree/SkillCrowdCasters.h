@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ASkillCrowdCasterPawn;
+class USkillsComponent;
+class FSkillSpatialHash;
+
+/*Decides the casts of every crowd caster of a world in one pass instead of one tick per pawn.
+The casters are stored as structure of arrays. Each caster thinks every ThinkInterval seconds with its own phase,
+so the work spreads evenly over the frames. Thinking picks the first castable skill and the nearest skill target
+of another team, in parallel chunks which only read the skills components and the target grid. The casts then
+get fired on the game thread through the casters' skills components, just like a player's shots.
+Casters are addressed by stable handles and must unregister before they get destroyed (ie in EndPlay)*/
+class SKILLSTREE_API FSkillCrowdCasters
+{
+public:
+	/*Registers the given caster and returns its handle - the caster has to be a skill target already*/
+	int32 Add(ASkillCrowdCasterPawn* Caster, int32 TargetSlot, float Time);
+
+	/*Unregisters the caster of the given handle - the handle becomes invalid*/
+	void Remove(int32 Handle);
+
+	/*Lets every caster whose think time came think and fires the casts they decided on - game thread only*/
+	void Update(float Time);
+
+	/*Returns the number of registered casters*/
+	int32 Num() const { return Casters.Num(); }
+
+	/*Returns the casts fired by the last Update*/
+	int32 GetNumCasts() const { return NumCasts; }
+
+	/*Returns the memory used by the caster state*/
+	SIZE_T GetAllocatedSize() const;
+
+	/*The amount of casters each parallel task thinks for*/
+	int32 ChunkSize = 256;
+
+	/*Where the casters find their targets - nobody casts without it*/
+	const FSkillSpatialHash* Targets = nullptr;
+
+private:
+	/*Decides the casts of the casters in [Start, End) - only writes to their own entries*/
+	void ThinkRange(int32 Start, int32 End, float Time);
+
+	void RemoveAtIndex(int32 Index);
+
+	//Dense caster state - one entry per caster
+	TArray<ASkillCrowdCasterPawn*> Casters;
+	TArray<const USkillsComponent*> SkillsComponents;
+	TArray<int32> TargetSlots;
+	TArray<float> Ranges;
+	TArray<float> ThinkIntervals;
+	TArray<float> NextThinkTimes;
+	TArray<uint8> Teams;
+
+	//The decision of the last think - INDEX_NONE when the caster doesn't cast
+	TArray<int32> CastSkillNums;
+	TArray<int32> CastTargets;
+
+	/*The team of each slot of the target grid - 0 for targets which are not crowd casters*/
+	TArray<uint8> TeamByTargetSlot;
+
+	//Handle indirection
+	TArray<int32> IndexToHandle;
+	TArray<int32> HandleToIndex;
+	TArray<int32> FreeHandles;
+
+	int32 NumCasts = 0;
+};
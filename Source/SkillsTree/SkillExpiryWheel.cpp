@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillExpiryWheel.h"
+
+FSkillExpiryWheel::FSkillExpiryWheel()
+{
+    for (int32& Head : Buckets) Head = INDEX_NONE;
+}
+
+int32 FSkillExpiryWheel::Schedule(ASkill* Skill, float Delay)
+{
+    int32 Handle;
+    if (FreeEntries.Num() > 0) Handle = FreeEntries.Pop(false);
+    else Handle = Entries.AddDefaulted();
+
+    //At least one tick so we never land in the bucket that was already processed
+    const int32 Ticks = FMath::Clamp(FMath::CeilToInt(Delay / TickInterval), 1, (int32)MaxTicks);
+
+    FEntry& Entry = Entries[Handle];
+    Entry.Skill = Skill;
+    Entry.ExpireTick = CurrentTick + Ticks;
+    Link(Handle);
+
+    NumPending++;
+    return Handle;
+}
+
+void FSkillExpiryWheel::Cancel(int32 Handle)
+{
+    if (!Entries.IsValidIndex(Handle) || Entries[Handle].Bucket == INDEX_NONE) return;
+
+    Unlink(Handle);
+    Entries[Handle].Skill = nullptr;
+    FreeEntries.Add(Handle);
+    NumPending--;
+}
+
+void FSkillExpiryWheel::Link(int32 Handle)
+{
+    FEntry& Entry = Entries[Handle];
+
+    const uint32 Delta = Entry.ExpireTick - CurrentTick;
+    Entry.Bucket = (Delta < LevelZeroSize) ?
+        (int32)(Entry.ExpireTick & (LevelZeroSize - 1)) :
+        LevelZeroSize + (int32)((Entry.ExpireTick >> LevelZeroBits) % LevelOneSize);
+
+    Entry.Prev = INDEX_NONE;
+    Entry.Next = Buckets[Entry.Bucket];
+    if (Entry.Next != INDEX_NONE) Entries[Entry.Next].Prev = Handle;
+    Buckets[Entry.Bucket] = Handle;
+}
+
+void FSkillExpiryWheel::Unlink(int32 Handle)
+{
+    FEntry& Entry = Entries[Handle];
+
+    if (Entry.Prev != INDEX_NONE) Entries[Entry.Prev].Next = Entry.Next;
+    else Buckets[Entry.Bucket] = Entry.Next;
+    if (Entry.Next != INDEX_NONE) Entries[Entry.Next].Prev = Entry.Prev;
+
+    Entry.Bucket = Entry.Prev = Entry.Next = INDEX_NONE;
+}
+
+void FSkillExpiryWheel::Advance(float DeltaTime, TArray<ASkill*>& OutExpired)
+{
+    Accumulator += DeltaTime;
+    while (Accumulator >= TickInterval)
+    {
+        Accumulator -= TickInterval;
+        Step(OutExpired);
+    }
+}
+
+void FSkillExpiryWheel::Step(TArray<ASkill*>& OutExpired)
+{
+    CurrentTick++;
+
+    //The first level wrapped around - move the entries of the next 256 ticks down
+    if ((CurrentTick & (LevelZeroSize - 1)) == 0)
+    {
+        const int32 Bucket = LevelZeroSize + (int32)((CurrentTick >> LevelZeroBits) % LevelOneSize);
+        int32 Handle = Buckets[Bucket];
+        Buckets[Bucket] = INDEX_NONE;
+
+        while (Handle != INDEX_NONE)
+        {
+            const int32 Next = Entries[Handle].Next;
+            Link(Handle);
+            Handle = Next;
+        }
+    }
+
+    const int32 Bucket = (int32)(CurrentTick & (LevelZeroSize - 1));
+    int32 Handle = Buckets[Bucket];
+    Buckets[Bucket] = INDEX_NONE;
+
+    while (Handle != INDEX_NONE)
+    {
+        FEntry& Entry = Entries[Handle];
+        const int32 Next = Entry.Next;
+
+        OutExpired.Add(Entry.Skill);
+        Entry.Skill = nullptr;
+        Entry.Bucket = Entry.Prev = Entry.Next = INDEX_NONE;
+        FreeEntries.Add(Handle);
+        NumPending--;
+
+        Handle = Next;
+    }
+}
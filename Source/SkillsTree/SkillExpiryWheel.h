@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ASkill;
+
+/*Hierarchical timing wheel which expires skill projectiles in batches.
+Time is quantized in ticks of TickInterval seconds. The first level has one bucket per tick for the
+next 256 ticks, the second level has one bucket per 256 ticks and gets cascaded into the first level
+whenever the first level wraps around. Schedule and Cancel are O(1) (intrusive lists over a pooled
+entry array), Advance only touches the buckets of the elapsed ticks*/
+class SKILLSTREE_API FSkillExpiryWheel
+{
+public:
+	FSkillExpiryWheel();
+
+	/*Schedules the skill to expire in Delay seconds and returns the handle of the expiry*/
+	int32 Schedule(ASkill* Skill, float Delay);
+
+	/*Cancels the expiry of the given handle*/
+	void Cancel(int32 Handle);
+
+	/*Advances the wheel by DeltaTime and appends every skill which expired to OutExpired*/
+	void Advance(float DeltaTime, TArray<ASkill*>& OutExpired);
+
+	/*Returns the number of pending expiries*/
+	int32 Num() const { return NumPending; }
+
+	/*Returns the memory used by the entries*/
+	SIZE_T GetAllocatedSize() const { return Entries.GetAllocatedSize() + FreeEntries.GetAllocatedSize(); }
+
+	/*The duration of a tick in seconds*/
+	float TickInterval = 1.f / 60.f;
+
+private:
+	enum
+	{
+		LevelZeroBits = 8,
+		LevelZeroSize = 1 << LevelZeroBits,
+		LevelOneSize = 64,
+		NumBuckets = LevelZeroSize + LevelOneSize,
+		MaxTicks = LevelZeroSize * LevelOneSize - 1
+	};
+
+	struct FEntry
+	{
+		ASkill* Skill = nullptr;
+		uint32 ExpireTick = 0;
+		int32 Bucket = INDEX_NONE;
+		int32 Prev = INDEX_NONE;
+		int32 Next = INDEX_NONE;
+	};
+
+	/*Puts the entry in the bucket matching its expire tick*/
+	void Link(int32 Entry);
+
+	/*Takes the entry out of its bucket*/
+	void Unlink(int32 Entry);
+
+	/*Advances the wheel by a single tick*/
+	void Step(TArray<ASkill*>& OutExpired);
+
+	TArray<FEntry> Entries;
+	TArray<int32> FreeEntries;
+	int32 Buckets[NumBuckets];
+
+	uint32 CurrentTick = 0;
+	float Accumulator = 0.f;
+	int32 NumPending = 0;
+};
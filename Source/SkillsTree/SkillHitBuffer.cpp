@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillHitBuffer.h"
+#include "SkillsWorldManager.h"
+
+FSkillHitBuffer::FSkillHitBuffer()
+{
+    Records.SetNumUninitialized(256);
+}
+
+bool FSkillHitBuffer::Append(const FSkillHitRecord& Record)
+{
+    const int32 Index = NumAppended.Increment() - 1;
+    if (Index >= Records.Num()) return false;
+
+    Records[Index] = Record;
+    return true;
+}
+
+TArrayView<FSkillHitRecord> FSkillHitBuffer::SortAndGet()
+{
+    const int32 Num = FMath::Min(NumAppended.GetValue(), Records.Num());
+
+    //Same type and level next to each other so consumers can work in batches
+    Sort(Records.GetData(), Num, [](const FSkillHitRecord& A, const FSkillHitRecord& B)
+    {
+        return (A.SkillType != B.SkillType) ? (A.SkillType < B.SkillType) : (A.Level < B.Level);
+    });
+
+    return TArrayView<FSkillHitRecord>(Records.GetData(), Num);
+}
+
+void FSkillHitBuffer::Reset()
+{
+    //Only grows between frames so appending never has to reallocate
+    const int32 NumDropped = GetNumDropped();
+    if (NumDropped > 0) Records.SetNumUninitialized(FMath::RoundUpToPowerOfTwo(NumAppended.GetValue()));
+
+    NumAppended.Reset();
+}
+
+void FSkillHitTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+    if (Manager && !Manager->IsPendingKill()) Manager->ProcessSkillHits();
+}
+
+FString FSkillHitTickFunction::DiagnosticMessage()
+{
+    return Manager ? Manager->GetFullName() + TEXT("[ProcessSkillHits]") : TEXT("FSkillHitTickFunction");
+}
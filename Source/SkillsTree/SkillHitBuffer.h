@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Skill.h"
+#include "SkillHitBuffer.generated.h"
+
+/*Compact record of a skill hit - the pointers are only valid during the frame of the hit*/
+struct FSkillHitRecord
+{
+	/*The projectile which hit something*/
+	ASkill* Skill;
+
+	/*The actor that got hit*/
+	AActor* Target;
+
+	/*The pawn which fired the skill*/
+	APawn* Instigator;
+
+	FVector Location;
+
+	FVector Normal;
+
+	ESkillType SkillType;
+
+	uint8 Level;
+};
+
+/*Per frame append buffer of skill hits.
+Appending only bumps an atomic counter and writes into preallocated storage so hits can get recorded
+from any thread. Consuming happens once per frame on the game thread*/
+class SKILLSTREE_API FSkillHitBuffer
+{
+public:
+	FSkillHitBuffer();
+
+	/*Records a hit - returns false if the buffer of this frame is full*/
+	bool Append(const FSkillHitRecord& Record);
+
+	/*Sorts the hits of this frame by skill type and level and returns them - game thread only*/
+	TArrayView<FSkillHitRecord> SortAndGet();
+
+	/*Forgets the hits of this frame - grows the storage if hits got dropped*/
+	void Reset();
+
+	/*Returns the number of hits that got dropped since the last reset*/
+	int32 GetNumDropped() const { return FMath::Max(NumAppended.GetValue() - Records.Num(), 0); }
+
+	/*Returns the memory used by the preallocated records*/
+	SIZE_T GetAllocatedSize() const { return Records.GetAllocatedSize(); }
+
+private:
+	TArray<FSkillHitRecord> Records;
+
+	FThreadSafeCounter NumAppended;
+};
+
+/*Tick function which consumes the hits of the frame after physics*/
+USTRUCT()
+struct FSkillHitTickFunction : public FTickFunction
+{
+	GENERATED_USTRUCT_BODY()
+
+	/*The manager whose hits get processed*/
+	class ASkillsWorldManager* Manager = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FSkillHitTickFunction> : public TStructOpsTypeTraitsBase2<FSkillHitTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillImpactFXPool.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Particles/ParticleSystem.h"
+#include "SkillsTreeStats.h"
+
+void FSkillImpactFXPool::Init(AActor* Owner, int32 PoolSize)
+{
+    Emitters.Reserve(PoolSize);
+    for (int32 i = 0; i < PoolSize; i++)
+    {
+        UParticleSystemComponent* Emitter = NewObject<UParticleSystemComponent>(Owner);
+        Emitter->bAutoActivate = false;
+        Emitter->bAutoDestroy = false;
+        Emitter->SetAbsolute(true, true, true);
+        Emitter->RegisterComponent();
+        Emitters.Add(Emitter);
+    }
+}
+
+void FSkillImpactFXPool::Request(UParticleSystem* FX, const FVector& Location, const FRotator& Rotation)
+{
+    if (!FX || Emitters.Num() == 0) return;
+
+    FRequest& Impact = Requests[Requests.AddUninitialized()];
+    Impact.FX = FX;
+    Impact.Location = Location;
+    Impact.Rotation = Rotation;
+    Impact.DistanceSq = 0.f;
+}
+
+UParticleSystemComponent* FSkillImpactFXPool::NextEmitter()
+{
+    for (int32 i = 0; i < Emitters.Num(); i++)
+    {
+        UParticleSystemComponent* Emitter = Emitters[NextIndex];
+        NextIndex = (NextIndex + 1) % Emitters.Num();
+        if (!Emitter->IsActive()) return Emitter;
+    }
+
+    //Everything is playing - the next one in the ring is the oldest
+    UParticleSystemComponent* Emitter = Emitters[NextIndex];
+    NextIndex = (NextIndex + 1) % Emitters.Num();
+    return Emitter;
+}
+
+void FSkillImpactFXPool::GetViewLocations(UWorld* World, TArray<FVector>& OutViewLocations)
+{
+    OutViewLocations.Reset();
+    for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+    {
+        APlayerController* PlayerController = It->Get();
+        if (!PlayerController || !PlayerController->IsLocalController()) continue;
+
+        FVector ViewLocation;
+        FRotator ViewRotation;
+        PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+        OutViewLocations.Add(ViewLocation);
+    }
+}
+
+void FSkillImpactFXPool::Flush(UWorld* World)
+{
+    if (Requests.Num() == 0) return;
+
+    GetViewLocations(World, ViewLocations);
+
+    //Without viewers (ie automation) every impact is equally significant
+    if (ViewLocations.Num() > 0)
+    {
+        for (FRequest& Impact : Requests)
+        {
+            Impact.DistanceSq = MAX_flt;
+            for (const FVector& ViewLocation : ViewLocations) Impact.DistanceSq = FMath::Min(Impact.DistanceSq, FVector::DistSquared(Impact.Location, ViewLocation));
+        }
+        Requests.Sort([](const FRequest& A, const FRequest& B) { return A.DistanceSq < B.DistanceSq; });
+    }
+
+    const float CullDistanceSq = FMath::Square(CullDistance);
+    const float DowngradeDistanceSq = FMath::Square(DowngradeDistance);
+    int32 NumPlayed = 0;
+
+    for (const FRequest& Impact : Requests)
+    {
+        if (Impact.DistanceSq > CullDistanceSq || NumPlayed >= Budget)
+        {
+            INC_DWORD_STAT(STAT_SkillsImpactFXCulled);
+            continue;
+        }
+
+        UParticleSystemComponent* Emitter = NextEmitter();
+        Emitter->SetWorldLocationAndRotation(Impact.Location, Impact.Rotation);
+        Emitter->SetTemplate(Impact.FX);
+
+        //Mid range impacts play their cheapest LOD
+        const bool bDowngrade = Impact.DistanceSq > DowngradeDistanceSq && Impact.FX->LODDistances.Num() > 1;
+        Emitter->LODMethod = bDowngrade ? PARTICLESYSTEMLODMETHOD_DirectSet : Impact.FX->LODMethod.GetValue();
+        Emitter->ActivateSystem(true);
+        if (bDowngrade)
+        {
+            Emitter->SetLODLevel(Impact.FX->LODDistances.Num() - 1);
+            INC_DWORD_STAT(STAT_SkillsImpactFXDowngraded);
+        }
+
+        NumPlayed++;
+    }
+
+    INC_DWORD_STAT_BY(STAT_SkillsImpactFXPlayed, NumPlayed);
+    Requests.Reset();
+}
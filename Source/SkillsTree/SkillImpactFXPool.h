@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "SkillImpactFXPool.generated.h"
+
+/*A ring of pre-warmed emitters which plays the impact FX of every skill in the world.
+Impacts get requested during the frame and flushed once: they're ranked by their distance to the
+local viewers, far away ones get culled, mid range ones play at their lowest LOD and only Budget
+impacts start per frame. When the ring is exhausted the oldest emitter gets recycled*/
+USTRUCT()
+struct SKILLSTREE_API FSkillImpactFXPool
+{
+	GENERATED_BODY()
+
+	/*Creates the emitters on the given actor*/
+	void Init(AActor* Owner, int32 PoolSize);
+
+	/*Queues an impact for the next flush*/
+	void Request(UParticleSystem* FX, const FVector& Location, const FRotator& Rotation);
+
+	/*Plays the most significant impacts of this frame and forgets the rest*/
+	void Flush(UWorld* World);
+
+	/*Returns the number of emitters*/
+	int32 Num() const { return Emitters.Num(); }
+
+	/*Fills OutViewLocations with the view points of the world's local players*/
+	static void GetViewLocations(UWorld* World, TArray<FVector>& OutViewLocations);
+
+	/*The most impacts that start per frame*/
+	int32 Budget = 16;
+
+	/*Impacts further away from every viewer get culled*/
+	float CullDistance = 8000.f;
+
+	/*Impacts further away from every viewer play at their lowest LOD*/
+	float DowngradeDistance = 3000.f;
+
+private:
+	struct FRequest
+	{
+		UParticleSystem* FX;
+
+		FVector Location;
+
+		FRotator Rotation;
+
+		/*Squared distance to the nearest viewer*/
+		float DistanceSq;
+	};
+
+	/*Returns the next emitter to play on - prefers idle emitters*/
+	UParticleSystemComponent* NextEmitter();
+
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> Emitters;
+
+	int32 NextIndex = 0;
+
+	TArray<FRequest> Requests;
+
+	/*Viewer locations of the current flush - kept around so flushing doesn't allocate*/
+	TArray<FVector> ViewLocations;
+};
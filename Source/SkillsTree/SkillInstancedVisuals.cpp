@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillInstancedVisuals.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Skill.h"
+#include "SkillImpactFXPool.h"
+#include "SkillsTreeStats.h"
+
+void FSkillInstancedVisuals::Init(AActor* InOwner)
+{
+    Owner = InOwner;
+}
+
+int32 FSkillInstancedVisuals::FindOrAddComponent(UStaticMesh* Mesh)
+{
+    if (const int32* Index = ComponentIndices.Find(Mesh)) return *Index;
+
+    //Pure visuals - no collision, no shadows, placed in world space
+    UInstancedStaticMeshComponent* Component = NewObject<UInstancedStaticMeshComponent>(Owner);
+    Component->SetStaticMesh(Mesh);
+    Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+    Component->SetCastShadow(false);
+    Component->SetAbsolute(true, true, true);
+    Component->RegisterComponent();
+
+    const int32 Index = Components.Add(Component);
+    NumUsedInstances.Add(0);
+    NextInstance.Add(0);
+    ComponentIndices.Add(Mesh, Index);
+    return Index;
+}
+
+int32 FSkillInstancedVisuals::Add(ASkill* Skill)
+{
+    UStaticMesh* Mesh = Skill->GetLightweightMesh();
+    if (!Owner || !Mesh) return INDEX_NONE;
+
+    SkillComponents.Add(FindOrAddComponent(Mesh));
+    return Skills.Add(Skill);
+}
+
+void FSkillInstancedVisuals::Remove(int32 Handle)
+{
+    if (!Skills.IsValidIndex(Handle)) return;
+
+    //The last skill moves into the freed slot
+    Skills.RemoveAtSwap(Handle, 1, false);
+    SkillComponents.RemoveAtSwap(Handle, 1, false);
+    if (Skills.IsValidIndex(Handle)) Skills[Handle]->VisualHandle = Handle;
+}
+
+void FSkillInstancedVisuals::Update(UWorld* World)
+{
+    if (!Owner) return;
+
+    SCOPE_CYCLE_COUNTER(STAT_SkillsUpdateVisuals);
+
+    //The nearest skills keep their particles - without viewers (ie automation) the first ones do
+    Ranking.Reset();
+    FSkillImpactFXPool::GetViewLocations(World, ViewLocations);
+    for (int32 i = 0; i < Skills.Num(); i++)
+    {
+        float DistanceSq = (ViewLocations.Num() > 0) ? MAX_flt : 0.f;
+        const FVector Location = Skills[i]->GetActorLocation();
+        for (const FVector& ViewLocation : ViewLocations) DistanceSq = FMath::Min(DistanceSq, FVector::DistSquared(Location, ViewLocation));
+        Ranking.Emplace(DistanceSq, i);
+    }
+    if (ViewLocations.Num() > 0 && Skills.Num() > ParticleBudget) Ranking.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key < B.Key; });
+
+    FMemory::Memzero(NextInstance.GetData(), NextInstance.Num() * sizeof(int32));
+    NumInstanced = 0;
+
+    for (int32 Rank = 0; Rank < Ranking.Num(); Rank++)
+    {
+        const int32 SkillIndex = Ranking[Rank].Value;
+        ASkill* Skill = Skills[SkillIndex];
+        const bool bParticles = Rank < ParticleBudget;
+        Skill->SetParticlesEnabled(bParticles);
+        if (bParticles) continue;
+
+        const int32 ComponentIndex = SkillComponents[SkillIndex];
+        UInstancedStaticMeshComponent* Component = Components[ComponentIndex];
+        const FTransform Transform(Skill->GetActorRotation(), Skill->GetActorLocation(), Skill->GetLightweightScale());
+
+        //Instances only ever get added - unused ones get parked below instead of removed
+        const int32 Instance = NextInstance[ComponentIndex]++;
+        if (Instance < Component->GetInstanceCount()) Component->UpdateInstanceTransform(Instance, Transform, true, false, true);
+        else Component->AddInstanceWorldSpace(Transform);
+
+        NumInstanced++;
+    }
+
+    for (int32 ComponentIndex = 0; ComponentIndex < Components.Num(); ComponentIndex++)
+    {
+        UInstancedStaticMeshComponent* Component = Components[ComponentIndex];
+
+        //Instances which got freed this frame shrink to nothing
+        const FTransform Parked(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector);
+        for (int32 Instance = NextInstance[ComponentIndex]; Instance < NumUsedInstances[ComponentIndex]; Instance++) Component->UpdateInstanceTransform(Instance, Parked, true, false, true);
+
+        if (NextInstance[ComponentIndex] > 0 || NumUsedInstances[ComponentIndex] > 0) Component->MarkRenderStateDirty();
+        NumUsedInstances[ComponentIndex] = NextInstance[ComponentIndex];
+    }
+}
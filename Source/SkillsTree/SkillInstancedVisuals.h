@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "SkillInstancedVisuals.generated.h"
+
+class ASkill;
+
+/*Draws the in-flight projectiles of lightweight skills with one instanced mesh component per lightweight mesh.
+Once per frame the projectiles get ranked by their distance to the local viewers: the nearest ParticleBudget
+keep their own particle component, every other one becomes an instance of its mesh's component. Instance
+transforms get written in one batch and the render state is dirtied once per component*/
+USTRUCT()
+struct SKILLSTREE_API FSkillInstancedVisuals
+{
+	GENERATED_BODY()
+
+	/*Instanced components get created on the given actor*/
+	void Init(AActor* InOwner);
+
+	/*Starts drawing the given skill - returns its handle or INDEX_NONE if the skill has no lightweight mesh*/
+	int32 Add(ASkill* Skill);
+
+	/*Stops drawing the skill of the given handle*/
+	void Remove(int32 Handle);
+
+	/*Ranks the skills, hands out the particle components and writes the instance transforms*/
+	void Update(UWorld* World);
+
+	/*Returns the number of instanced components - one per lightweight mesh that was drawn so far*/
+	int32 GetNumComponents() const { return Components.Num(); }
+
+	/*Returns the number of skills drawn as instances in the last update*/
+	int32 GetNumInstanced() const { return NumInstanced; }
+
+	/*Returns the number of skills drawn by their own particle component in the last update*/
+	int32 GetNumParticles() const { return Skills.Num() - NumInstanced; }
+
+	/*The amount of nearest skills which keep their particle component*/
+	int32 ParticleBudget = 16;
+
+private:
+	/*Returns the index of the component of the given mesh - creates it on first use*/
+	int32 FindOrAddComponent(UStaticMesh* Mesh);
+
+	UPROPERTY()
+	AActor* Owner = nullptr;
+
+	/*One per lightweight mesh - the components keep their meshes loaded*/
+	UPROPERTY()
+	TArray<UInstancedStaticMeshComponent*> Components;
+
+	/*The index of each mesh's component*/
+	TMap<const UStaticMesh*, int32> ComponentIndices;
+
+	/*Instances of each component which were in use after the last update - the rest are parked*/
+	TArray<int32> NumUsedInstances;
+
+	/*The drawn skills and the index of their component - compacted with swap-removes*/
+	TArray<ASkill*> Skills;
+	TArray<int32> SkillComponents;
+
+	int32 NumInstanced = 0;
+
+	//Scratch space of Update
+	TArray<TPair<float, int32>> Ranking;
+	TArray<int32> NextInstance;
+	TArray<FVector> ViewLocations;
+};
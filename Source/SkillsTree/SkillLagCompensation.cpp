@@ -0,0 +1,243 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillLagCompensation.h"
+#include "SkillsTree.h"
+#include "Components/CapsuleComponent.h"
+
+//Empty history entries sit far outside any world - their distance never passes the overlap test
+static const float EmptyCoordinate = 1.e18f;
+
+void FSkillLagCompensation::Init(int32 InCapacity, int32 InHistorySize)
+{
+    Capacity = FMath::Max(InCapacity, 1);
+    HistorySize = FMath::Max(InHistorySize, 2);
+    NumFrames = 0;
+    NewestFrame = INDEX_NONE;
+    NumUsedSlots = 0;
+    NumRegistered = 0;
+    bWarnedFull = false;
+
+    FrameTimes.SetNumZeroed(HistorySize);
+    CenterX.Init(EmptyCoordinate, HistorySize * Capacity);
+    CenterY.Init(EmptyCoordinate, HistorySize * Capacity);
+    CenterZ.Init(EmptyCoordinate, HistorySize * Capacity);
+    HalfHeight.Init(0.f, HistorySize * Capacity);
+    Radius.Init(0.f, HistorySize * Capacity);
+
+    Capsules.Reset(Capacity);
+    FreeSlots.Reset();
+    OverlapMask.SetNumZeroed(Capacity);
+    SweepFractions.SetNumZeroed(Capacity);
+}
+
+int32 FSkillLagCompensation::Register(UCapsuleComponent* Capsule)
+{
+    if (!Capsule || !IsInitialized()) return INDEX_NONE;
+
+    int32 Slot;
+    if (FreeSlots.Num() > 0) Slot = FreeSlots.Pop(false);
+    else if (Capsules.Num() < Capacity) Slot = Capsules.AddDefaulted();
+    else
+    {
+        //Skills of remote shooters can't hit this capsule where they saw it
+        if (!bWarnedFull) UE_LOG(LogSkillsTree, Warning, TEXT("The lag compensation history is full (%d capsules) - %s doesn't get rewound"), Capacity, *Capsule->GetPathName());
+        bWarnedFull = true;
+        return INDEX_NONE;
+    }
+
+    Capsules[Slot] = Capsule;
+    NumUsedSlots = FMath::Max(NumUsedSlots, Slot + 1);
+    NumRegistered++;
+    return Slot;
+}
+
+void FSkillLagCompensation::Unregister(int32 Slot)
+{
+    if (!Capsules.IsValidIndex(Slot) || !Capsules[Slot].IsValid()) return;
+
+    //A new capsule in this slot must not inherit the old one's history
+    for (int32 Frame = 0; Frame < HistorySize; Frame++) ClearSlot(Frame, Slot);
+
+    Capsules[Slot] = nullptr;
+    FreeSlots.Add(Slot);
+    NumRegistered--;
+}
+
+void FSkillLagCompensation::ClearSlot(int32 Frame, int32 Slot)
+{
+    const int32 Index = Frame * Capacity + Slot;
+    CenterX[Index] = CenterY[Index] = CenterZ[Index] = EmptyCoordinate;
+    HalfHeight[Index] = Radius[Index] = 0.f;
+}
+
+void FSkillLagCompensation::Record(float Time)
+{
+    if (!IsInitialized()) return;
+
+    NewestFrame = (NewestFrame + 1) % HistorySize;
+    NumFrames = FMath::Min(NumFrames + 1, HistorySize);
+    FrameTimes[NewestFrame] = Time;
+
+    const int32 Row = NewestFrame * Capacity;
+    for (int32 Slot = 0; Slot < NumUsedSlots; Slot++)
+    {
+        const UCapsuleComponent* Capsule = Capsules[Slot].Get();
+        if (!Capsule || !Capsule->IsCollisionEnabled())
+        {
+            ClearSlot(NewestFrame, Slot);
+            continue;
+        }
+
+        const FVector Center = Capsule->GetComponentLocation();
+        CenterX[Row + Slot] = Center.X;
+        CenterY[Row + Slot] = Center.Y;
+        CenterZ[Row + Slot] = Center.Z;
+        HalfHeight[Row + Slot] = Capsule->GetScaledCapsuleHalfHeight_WithoutHemisphere();
+        Radius[Row + Slot] = Capsule->GetScaledCapsuleRadius();
+    }
+}
+
+void FSkillLagCompensation::FindFrames(float Time, int32& OutOlder, int32& OutNewer, float& OutAlpha) const
+{
+    OutOlder = OutNewer = NewestFrame;
+    OutAlpha = 0.f;
+    if (Time >= FrameTimes[NewestFrame]) return;
+
+    //Rewinds only go back a few frames - walking back from the newest one beats a search of the ring
+    for (int32 Step = 1; Step < NumFrames; Step++)
+    {
+        const int32 Frame = (NewestFrame - Step + HistorySize) % HistorySize;
+        OutOlder = Frame;
+        if (FrameTimes[Frame] > Time)
+        {
+            OutNewer = Frame;
+            continue;
+        }
+
+        const float Span = FrameTimes[OutNewer] - FrameTimes[Frame];
+        OutAlpha = (Span > KINDA_SMALL_NUMBER) ? FMath::Clamp((Time - FrameTimes[Frame]) / Span, 0.f, 1.f) : 0.f;
+        return;
+    }
+
+    //Older than the history - the oldest frame is the best we have
+    OutNewer = OutOlder;
+}
+
+int32 FSkillLagCompensation::OverlapSphere(float Time, const FVector& Center, float SphereRadius, TArray<int32, TInlineAllocator<8>>& OutSlots)
+{
+    TArray<float, TInlineAllocator<8>> Fractions;
+    return SweepSphere(Time, Center, Center, SphereRadius, OutSlots, Fractions);
+}
+
+int32 FSkillLagCompensation::SweepSphere(float Time, const FVector& Start, const FVector& End, float SphereRadius, TArray<int32, TInlineAllocator<8>>& OutSlots, TArray<float, TInlineAllocator<8>>& OutFractions)
+{
+    if (NumFrames == 0 || NumRegistered == 0) return 0;
+
+    int32 Older, Newer;
+    float Alpha;
+    FindFrames(Time, Older, Newer, Alpha);
+
+    const float* RESTRICT AX = CenterX.GetData() + Older * Capacity;
+    const float* RESTRICT AY = CenterY.GetData() + Older * Capacity;
+    const float* RESTRICT AZ = CenterZ.GetData() + Older * Capacity;
+    const float* RESTRICT AH = HalfHeight.GetData() + Older * Capacity;
+    const float* RESTRICT AR = Radius.GetData() + Older * Capacity;
+    const float* RESTRICT BX = CenterX.GetData() + Newer * Capacity;
+    const float* RESTRICT BY = CenterY.GetData() + Newer * Capacity;
+    const float* RESTRICT BZ = CenterZ.GetData() + Newer * Capacity;
+    const float* RESTRICT BH = HalfHeight.GetData() + Newer * Capacity;
+    const float* RESTRICT BR = Radius.GetData() + Newer * Capacity;
+    uint8* RESTRICT Mask = OverlapMask.GetData();
+    float* RESTRICT Fraction = SweepFractions.GetData();
+
+    const FVector Delta = End - Start;
+    const float LengthSquared = Delta.SizeSquared();
+    const float InvLengthSquared = (LengthSquared > SMALL_NUMBER) ? 1.f / LengthSquared : 0.f;
+
+    //Lerp the two frames and find the closest points of the sweep and each capsule's segment - clamps instead of branches so it gets auto-vectorized
+    for (int32 Slot = 0; Slot < NumUsedSlots; Slot++)
+    {
+        const float CX = AX[Slot] + (BX[Slot] - AX[Slot]) * Alpha;
+        const float CY = AY[Slot] + (BY[Slot] - AY[Slot]) * Alpha;
+        const float CZ = AZ[Slot] + (BZ[Slot] - AZ[Slot]) * Alpha;
+        const float H = AH[Slot] + (BH[Slot] - AH[Slot]) * Alpha;
+        const float R = AR[Slot] + (BR[Slot] - AR[Slot]) * Alpha + SphereRadius;
+
+        //The upright segment runs from CZ - H to CZ + H
+        const float RX = Start.X - CX;
+        const float RY = Start.Y - CY;
+        const float RZ = Start.Z - (CZ - H);
+        const float SegmentSquared = 4.f * H * H;
+        const float B = 2.f * H * Delta.Z;
+        const float C = Delta.X * RX + Delta.Y * RY + Delta.Z * RZ;
+        const float F = 2.f * H * RZ;
+        const float Denom = LengthSquared * SegmentSquared - B * B;
+
+        //Closest point of the sweep to the infinite line, then of the clamped capsule segment back onto the sweep
+        const float S = (Denom > SMALL_NUMBER) ? FMath::Clamp((B * F - C * SegmentSquared) / Denom, 0.f, 1.f) : 0.f;
+        const float T = (SegmentSquared > SMALL_NUMBER) ? FMath::Clamp((B * S + F) / SegmentSquared, 0.f, 1.f) : 0.f;
+        const float ClosestS = FMath::Clamp((B * T - C) * InvLengthSquared, 0.f, 1.f);
+
+        const float DX = RX + Delta.X * ClosestS;
+        const float DY = RY + Delta.Y * ClosestS;
+        const float DZ = RZ + Delta.Z * ClosestS - 2.f * H * T;
+
+        Mask[Slot] = (DX * DX + DY * DY + DZ * DZ <= R * R) ? 1 : 0;
+        Fraction[Slot] = ClosestS;
+    }
+
+    const int32 NumBefore = OutSlots.Num();
+    for (int32 Slot = 0; Slot < NumUsedSlots; Slot++)
+    {
+        if (!Mask[Slot]) continue;
+
+        OutSlots.Add(Slot);
+        OutFractions.Add(Fraction[Slot]);
+    }
+    return OutSlots.Num() - NumBefore;
+}
+
+void FSkillLagCompensation::GetCapsules(TArray<UPrimitiveComponent*>& OutCapsules) const
+{
+    for (int32 Slot = 0; Slot < NumUsedSlots; Slot++)
+    {
+        if (UCapsuleComponent* Capsule = Capsules[Slot].Get()) OutCapsules.Add(Capsule);
+    }
+}
+
+bool FSkillLagCompensation::Contains(const UPrimitiveComponent* Component) const
+{
+    for (int32 Slot = 0; Slot < NumUsedSlots; Slot++)
+    {
+        if (Capsules[Slot].Get() == Component) return true;
+    }
+    return false;
+}
+
+AActor* FSkillLagCompensation::GetActor(int32 Slot) const
+{
+    const UCapsuleComponent* Capsule = Capsules.IsValidIndex(Slot) ? Capsules[Slot].Get() : nullptr;
+    return Capsule ? Capsule->GetOwner() : nullptr;
+}
+
+bool FSkillLagCompensation::GetCenter(int32 Slot, float Time, FVector& OutCenter) const
+{
+    if (NumFrames == 0 || !Capsules.IsValidIndex(Slot)) return false;
+
+    int32 Older, Newer;
+    float Alpha;
+    FindFrames(Time, Older, Newer, Alpha);
+
+    const int32 A = Older * Capacity + Slot;
+    const int32 B = Newer * Capacity + Slot;
+    if (CenterX[A] == EmptyCoordinate || CenterX[B] == EmptyCoordinate) return false;
+
+    OutCenter = FMath::Lerp(FVector(CenterX[A], CenterY[A], CenterZ[A]), FVector(CenterX[B], CenterY[B], CenterZ[B]), Alpha);
+    return true;
+}
+
+SIZE_T FSkillLagCompensation::GetAllocatedSize() const
+{
+    return FrameTimes.GetAllocatedSize() + CenterX.GetAllocatedSize() * 3 + HalfHeight.GetAllocatedSize() + Radius.GetAllocatedSize()
+        + Capsules.GetAllocatedSize() + FreeSlots.GetAllocatedSize() + OverlapMask.GetAllocatedSize() + SweepFractions.GetAllocatedSize();
+}
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UCapsuleComponent;
+class UPrimitiveComponent;
+
+/*Server side history of the hittable capsules of a world, used to check skill hits against where the
+shooter saw its targets. Every frame the center, half height and radius of each registered capsule get
+stored in a fixed size ring of frames - structure of arrays, one row of Capacity floats per frame - so the
+memory never grows and a rewind only has to lerp two rows. Capsules are treated as upright, like the
+capsules of characters*/
+class SKILLSTREE_API FSkillLagCompensation
+{
+public:
+	/*Allocates the history - clears every registered capsule*/
+	void Init(int32 InCapacity, int32 InHistorySize);
+
+	/*Starts recording the given capsule - returns INDEX_NONE and warns when the history is full*/
+	int32 Register(UCapsuleComponent* Capsule);
+
+	/*Stops recording the capsule of the given slot - its history gets cleared*/
+	void Unregister(int32 Slot);
+
+	/*Stores the capsules as they are at Time - Time must not go backwards*/
+	void Record(float Time);
+
+	/*Appends the slots whose capsule overlapped the given sphere at Time to OutSlots - returns the amount of overlaps*/
+	int32 OverlapSphere(float Time, const FVector& Center, float SphereRadius, TArray<int32, TInlineAllocator<8>>& OutSlots);
+
+	/*Appends the slots whose capsule the sphere touched at Time while moving from Start to End to OutSlots, and where
+	along the move it came closest to each of them (0 is Start, 1 is End) to OutFractions - returns the amount of hits*/
+	int32 SweepSphere(float Time, const FVector& Start, const FVector& End, float SphereRadius, TArray<int32, TInlineAllocator<8>>& OutSlots, TArray<float, TInlineAllocator<8>>& OutFractions);
+
+	/*Appends every registered capsule to OutCapsules*/
+	void GetCapsules(TArray<UPrimitiveComponent*>& OutCapsules) const;
+
+	/*Returns true if the given component is a registered capsule*/
+	bool Contains(const UPrimitiveComponent* Component) const;
+
+	/*Returns the owner of the capsule of the given slot*/
+	AActor* GetActor(int32 Slot) const;
+
+	/*Returns the center of the capsule of the given slot at Time - false if the slot has no history at Time*/
+	bool GetCenter(int32 Slot, float Time, FVector& OutCenter) const;
+
+	/*Returns true if the history is allocated*/
+	bool IsInitialized() const { return Capacity > 0; }
+
+	/*Returns the number of registered capsules*/
+	int32 Num() const { return NumRegistered; }
+
+	/*Returns the memory used by the history*/
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	/*Finds the recorded frames around Time - Alpha blends from OutOlder to OutNewer*/
+	void FindFrames(float Time, int32& OutOlder, int32& OutNewer, float& OutAlpha) const;
+
+	/*Marks the history of a slot in the given frame as empty*/
+	void ClearSlot(int32 Frame, int32 Slot);
+
+	/*The most capsules the history can hold*/
+	int32 Capacity = 0;
+
+	/*The amount of frames in the ring*/
+	int32 HistorySize = 0;
+
+	/*The amount of recorded frames - up to HistorySize*/
+	int32 NumFrames = 0;
+
+	/*The ring index of the last recorded frame*/
+	int32 NewestFrame = INDEX_NONE;
+
+	/*Slots above this never got used - loops stop here*/
+	int32 NumUsedSlots = 0;
+
+	int32 NumRegistered = 0;
+
+	/*True once Register ran out of slots - the warning only gets logged once*/
+	bool bWarnedFull = false;
+
+	TArray<float> FrameTimes;
+
+	//HistorySize rows of Capacity entries
+	TArray<float> CenterX, CenterY, CenterZ;
+	TArray<float> HalfHeight;
+	TArray<float> Radius;
+
+	//One entry per slot
+	TArray<TWeakObjectPtr<UCapsuleComponent>> Capsules;
+	TArray<int32> FreeSlots;
+
+	//Scratch space of SweepSphere
+	TArray<uint8> OverlapMask;
+	TArray<float> SweepFractions;
+};
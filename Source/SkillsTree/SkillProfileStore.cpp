@@ -0,0 +1,377 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillProfileStore.h"
+#include "SkillsTree.h"
+#include "SkillsTreeStats.h"
+#include "Async/Async.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Hash/CityHash.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+//Dedicated servers run on these - the others read the file into a buffer
+#define SKILLS_PROFILE_MMAP (PLATFORM_LINUX || PLATFORM_MAC)
+
+#if SKILLS_PROFILE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    /*The first bytes of the file - the records start at HeaderSize*/
+    struct FSkillProfileFileHeader
+    {
+        uint32 Magic;
+        uint32 Version;
+        uint32 RecordSize;
+        int32 NumRecords;
+    };
+
+    const uint32 ProfileMagic = 0x46505453; //STPF
+    const int64 HeaderSize = 64;
+    const int64 RecordSize = sizeof(FSkillProfileRecord);
+}
+
+/*The file of a store held in memory - the store only reads and writes the memory and tells the file which bytes changed.
+Everything about the layout lives in the store, so mapped and buffered files share the header and record handling*/
+class FSkillProfileFile
+{
+public:
+    virtual ~FSkillProfileFile() {}
+
+    /*Opens (or creates) the file with at least Size bytes - returns the memory holding it, or nullptr on failure*/
+    virtual uint8* Open(const FString& Filename, int64 Size) = 0;
+
+    /*The given bytes of the memory changed - called on the write task*/
+    virtual void Write(int64 Offset, int64 Size) = 0;
+
+    /*Hands the written bytes to the disk - blocks until they are there with bWait*/
+    virtual void Sync(bool bWait) = 0;
+
+    virtual bool IsMapped() const = 0;
+};
+
+namespace
+{
+    /*Reads the file into a buffer and writes the changed bytes through a file handle*/
+    class FSkillProfileBufferedFile : public FSkillProfileFile
+    {
+    public:
+        virtual ~FSkillProfileBufferedFile()
+        {
+            Sync(true);
+        }
+
+        virtual uint8* Open(const FString& Filename, int64 Size) override
+        {
+            FFileHelper::LoadFileToArray(Buffer, *Filename, FILEREAD_Silent);
+            const int64 FileSize = Buffer.Num();
+            if (FileSize < Size) Buffer.AddZeroed(Size - FileSize);
+
+            FileHandle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Filename, true, true));
+            if (!FileHandle.IsValid()) return nullptr;
+
+            //Grows the file like the mapped one does, so a reopen sees the same capacity
+            if (FileSize < Size) Write(FileSize, Size - FileSize);
+            return Buffer.GetData();
+        }
+
+        virtual void Write(int64 Offset, int64 Size) override
+        {
+            FileHandle->Seek(Offset);
+            FileHandle->Write(Buffer.GetData() + Offset, Size);
+        }
+
+        virtual void Sync(bool bWait) override
+        {
+            if (FileHandle.IsValid()) FileHandle->Flush();
+        }
+
+        virtual bool IsMapped() const override { return false; }
+
+    private:
+        TArray<uint8> Buffer;
+        TUniquePtr<IFileHandle> FileHandle;
+    };
+
+#if SKILLS_PROFILE_MMAP
+    /*Maps the file - the memory is the page cache, so there is nothing to write besides syncing*/
+    class FSkillProfileMappedFile : public FSkillProfileFile
+    {
+    public:
+        virtual ~FSkillProfileMappedFile()
+        {
+            if (Data)
+            {
+                msync(Data, Size, MS_SYNC);
+                munmap(Data, Size);
+            }
+            if (FileDescriptor >= 0) close(FileDescriptor);
+        }
+
+        virtual uint8* Open(const FString& Filename, int64 InSize) override
+        {
+            FileDescriptor = open(TCHAR_TO_UTF8(*Filename), O_RDWR | O_CREAT, 0644);
+            if (FileDescriptor < 0) return nullptr;
+
+            //New space reads as zeros - free records have a key of 0
+            struct stat FileStat;
+            if (fstat(FileDescriptor, &FileStat) != 0 || (FileStat.st_size < InSize && ftruncate(FileDescriptor, InSize) != 0)) return nullptr;
+
+            void* Mapping = mmap(nullptr, InSize, PROT_READ | PROT_WRITE, MAP_SHARED, FileDescriptor, 0);
+            if (Mapping == MAP_FAILED) return nullptr;
+
+            Data = (uint8*)Mapping;
+            Size = InSize;
+            return Data;
+        }
+
+        virtual void Write(int64 Offset, int64 InSize) override {}
+
+        virtual void Sync(bool bWait) override
+        {
+            if (Data) msync(Data, Size, bWait ? MS_SYNC : MS_ASYNC);
+        }
+
+        virtual bool IsMapped() const override { return true; }
+
+    private:
+        int32 FileDescriptor = -1;
+        uint8* Data = nullptr;
+        int64 Size = 0;
+    };
+#endif
+}
+
+FSkillProfileStore::~FSkillProfileStore()
+{
+    Close();
+}
+
+uint64 FSkillProfileStore::MakeKey(const FString& PlayerId)
+{
+    const uint64 Key = CityHash64((const char*)*PlayerId, PlayerId.Len() * sizeof(TCHAR));
+    return Key ? Key : 1;
+}
+
+bool FSkillProfileStore::Open(const FString& InFilename, int32 Capacity, bool bInAllowMapping)
+{
+    Close();
+
+    Filename = InFilename;
+    bAllowMapping = bInAllowMapping;
+    IFileManager::Get().MakeDirectory(*FPaths::GetPath(Filename), true);
+
+    //Existing files keep their size - the header tells how many records are in use
+    const int64 FileSize = IFileManager::Get().FileSize(*Filename);
+    if (FileSize >= HeaderSize && Map((FileSize - HeaderSize) / RecordSize))
+    {
+        const FSkillProfileFileHeader* Header = (const FSkillProfileFileHeader*)Data;
+        if (Header->Magic == ProfileMagic && Header->Version == Version && Header->RecordSize == RecordSize && Header->NumRecords >= 0)
+        {
+            NumRecords = (int32)FMath::Min<int64>(Header->NumRecords, RecordCapacity);
+        }
+        else
+        {
+            Unmap();
+            Discard();
+        }
+    }
+
+    if (RecordCapacity < Capacity && !Map(FMath::Max(Capacity, 1)))
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("Could not open the skill profile store %s"), *Filename);
+        Unmap();
+        return false;
+    }
+
+    FSkillProfileFileHeader* Header = (FSkillProfileFileHeader*)Data;
+    Header->Magic = ProfileMagic;
+    Header->Version = Version;
+    Header->RecordSize = RecordSize;
+    Header->NumRecords = NumRecords;
+    File->Write(0, sizeof(FSkillProfileFileHeader));
+
+    //The only pass over the records - every load after this is a lookup
+    RecordIndices.Reserve(NumRecords);
+    for (int32 i = 0; i < NumRecords; i++)
+    {
+        const uint64 Key = GetRecord(i)->Key;
+        if (Key != 0) RecordIndices.Add(Key, i);
+    }
+
+    return true;
+}
+
+void FSkillProfileStore::Close()
+{
+    if (!IsOpen()) return;
+
+    //The batch in flight may have held back the last saves
+    WaitForWrites();
+    Flush();
+    WaitForWrites();
+
+    Unmap();
+    RecordIndices.Reset();
+    NumRecords = 0;
+}
+
+void FSkillProfileStore::Discard()
+{
+    UE_LOG(LogSkillsTree, Warning, TEXT("The skill profile store %s has an unknown layout - moving it aside and starting over"), *Filename);
+    IFileManager::Get().Move(*(Filename + TEXT(".bak")), *Filename, true);
+}
+
+bool FSkillProfileStore::Map(int64 Capacity)
+{
+    Unmap();
+
+    const int64 Size = HeaderSize + Capacity * RecordSize;
+
+#if SKILLS_PROFILE_MMAP
+    if (bAllowMapping) File = MakeUnique<FSkillProfileMappedFile>();
+#endif
+    if (!File.IsValid()) File = MakeUnique<FSkillProfileBufferedFile>();
+
+    Data = File->Open(Filename, Size);
+    if (!Data)
+    {
+        File.Reset();
+        return false;
+    }
+
+    MappedSize = Size;
+    RecordCapacity = Capacity;
+    return true;
+}
+
+void FSkillProfileStore::Unmap()
+{
+    //Syncs and closes the file
+    File.Reset();
+
+    Data = nullptr;
+    MappedSize = 0;
+    RecordCapacity = 0;
+}
+
+bool FSkillProfileStore::IsMapped() const
+{
+    return File.IsValid() && File->IsMapped();
+}
+
+const FSkillProfileRecord* FSkillProfileStore::GetRecord(int32 RecordIndex) const
+{
+    return (const FSkillProfileRecord*)(Data + HeaderSize + RecordIndex * RecordSize);
+}
+
+bool FSkillProfileStore::Load(uint64 Key, FSkillProfileRecord& OutRecord) const
+{
+    SCOPE_CYCLE_COUNTER(STAT_SkillsProfileLoad);
+
+    const int32* RecordIndex = RecordIndices.Find(Key);
+    if (!RecordIndex) return false;
+
+    //The newest copy wins - queued, then being written, then stored
+    if (const FSkillProfileRecord* Queued = Pending.Find(*RecordIndex))
+    {
+        OutRecord = *Queued;
+    }
+    else if (const int32* Position = InFlightIndices.Find(*RecordIndex))
+    {
+        OutRecord = InFlight[*Position].Value;
+    }
+    else
+    {
+        FMemory::Memcpy(&OutRecord, GetRecord(*RecordIndex), RecordSize);
+    }
+    return true;
+}
+
+bool FSkillProfileStore::Save(const FSkillProfileRecord& Record)
+{
+    if (!IsOpen() || Record.Key == 0) return false;
+
+    int32 RecordIndex;
+    if (const int32* Found = RecordIndices.Find(Record.Key))
+    {
+        RecordIndex = *Found;
+    }
+    else
+    {
+        //Growing remaps the file - nothing may be writing to it
+        if (NumRecords >= RecordCapacity)
+        {
+            WaitForWrites();
+            if (!Map(RecordCapacity * 2))
+            {
+                UE_LOG(LogSkillsTree, Error, TEXT("Could not grow the skill profile store %s"), *Filename);
+                return false;
+            }
+        }
+
+        RecordIndex = NumRecords++;
+        RecordIndices.Add(Record.Key, RecordIndex);
+    }
+
+    Pending.Add(RecordIndex, Record);
+    return true;
+}
+
+void FSkillProfileStore::Flush()
+{
+    if (Pending.Num() == 0 || !IsOpen()) return;
+
+    //One batch at a time - the queue keeps growing until the last one is written
+    if (WriteTask.IsValid() && !WriteTask.IsReady()) return;
+
+    SCOPE_CYCLE_COUNTER(STAT_SkillsProfileFlush);
+    INC_DWORD_STAT_BY(STAT_SkillsProfileWrites, Pending.Num());
+
+    InFlight.Reset(Pending.Num());
+    InFlightIndices.Reset();
+    for (const auto& It : Pending)
+    {
+        InFlightIndices.Add(It.Key, InFlight.Add(TPair<int32, FSkillProfileRecord>(It.Key, It.Value)));
+    }
+    Pending.Reset();
+
+    const int32 NumWritten = NumRecords;
+    WriteTask = Async<void>(EAsyncExecution::ThreadPool, [this, NumWritten]() { WriteBatch(NumWritten); });
+}
+
+void FSkillProfileStore::WriteBatch(int32 NumWritten)
+{
+    //Touching mapped pages may fault them in from disk - that is why this is off the game thread.
+    //Loads of the records in flight read InFlight, so the game thread never looks at the bytes being copied
+    for (const TPair<int32, FSkillProfileRecord>& It : InFlight)
+    {
+        const int64 Offset = HeaderSize + It.Key * RecordSize;
+        FMemory::Memcpy(Data + Offset, &It.Value, RecordSize);
+        File->Write(Offset, RecordSize);
+    }
+    ((FSkillProfileFileHeader*)Data)->NumRecords = NumWritten;
+    File->Write(0, sizeof(FSkillProfileFileHeader));
+
+    File->Sync(false);
+}
+
+void FSkillProfileStore::WaitForWrites()
+{
+    if (WriteTask.IsValid()) WriteTask.Wait();
+    WriteTask = TFuture<void>();
+
+    InFlight.Reset();
+    InFlightIndices.Reset();
+}
+
+SIZE_T FSkillProfileStore::GetAllocatedSize() const
+{
+    return RecordIndices.GetAllocatedSize() + Pending.GetAllocatedSize() + InFlight.GetAllocatedSize() + InFlightIndices.GetAllocatedSize();
+}
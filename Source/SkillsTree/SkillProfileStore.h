@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+
+class FSkillProfileFile;
+
+/*The saved skill tree of one player - fixed layout, copied to and from the profile file as is*/
+struct FSkillProfileRecord
+{
+	enum
+	{
+		MaxSlots = 64,
+		MaxNodeWords = 4
+	};
+
+	/*The player the record belongs to - 0 never belongs to anyone*/
+	uint64 Key = 0;
+
+	/*Hash of the skills the levels are indexed by - records of another skills layout don't get applied*/
+	uint32 Schema = 0;
+
+	int32 AvailablePoints = 0;
+
+	uint16 NumSlots = 0;
+
+	uint16 NumNodeWords = 0;
+
+	uint32 Reserved = 0;
+
+	/*The level of each skill slot*/
+	uint8 Levels[MaxSlots];
+
+	/*One bit per learned node of the skill tree*/
+	uint64 UnlockedNodes[MaxNodeWords];
+
+	/*Room for new fields without changing the record size*/
+	uint8 Padding[8];
+
+	FSkillProfileRecord()
+	{
+		FMemory::Memzero(Levels);
+		FMemory::Memzero(UnlockedNodes);
+		FMemory::Memzero(Padding);
+	}
+};
+
+static_assert(sizeof(FSkillProfileRecord) == 128, "The profile file layout depends on the record size - bump FSkillProfileStore::Version when changing it");
+
+/*Local store of the skill trees of every player a server has seen, in one file of fixed size records.
+The file is memory mapped where the platform allows it (the buffer gets read in on the others), so loading
+a player's tree is a hash lookup and a copy. Saves get queued on the game thread and handed to a thread pool
+task in batches - loads see the queued and in flight records, so a player who rejoins right away gets the
+newest tree. One store per file - two processes must not share a file*/
+class SKILLSTREE_API FSkillProfileStore
+{
+public:
+	/*Bumped whenever the header or the record layout changes - files of another version get moved aside*/
+	static const uint32 Version = 1;
+
+	~FSkillProfileStore();
+
+	/*Opens (or creates) the given file with room for at least Capacity records - returns false on failure.
+	Without bAllowMapping the file gets read into a buffer even where it could be mapped*/
+	bool Open(const FString& InFilename, int32 Capacity, bool bAllowMapping = true);
+
+	/*Writes the queued records and closes the file*/
+	void Close();
+
+	/*Returns true between a successful Open and Close*/
+	bool IsOpen() const { return Data != nullptr; }
+
+	/*Copies the record of the given key to OutRecord - returns false if the player has no record*/
+	bool Load(uint64 Key, FSkillProfileRecord& OutRecord) const;
+
+	/*Queues the given record for the next batch - replaces a queued record of the same key*/
+	bool Save(const FSkillProfileRecord& Record);
+
+	/*Hands the queued records to a background write - they stay queued while the last batch is still writing*/
+	void Flush();
+
+	/*Blocks until the last batch is written*/
+	void WaitForWrites();
+
+	/*Returns the number of stored players*/
+	int32 Num() const { return NumRecords; }
+
+	/*Returns the number of records waiting for the next batch*/
+	int32 GetNumPendingWrites() const { return Pending.Num(); }
+
+	/*Returns true if the file is memory mapped rather than read into a buffer*/
+	bool IsMapped() const;
+
+	/*Returns the size of the file in bytes*/
+	uint64 GetFileSize() const { return MappedSize; }
+
+	/*Returns the memory used besides the mapped file*/
+	SIZE_T GetAllocatedSize() const;
+
+	/*Returns the key of the given player id - never 0*/
+	static uint64 MakeKey(const FString& PlayerId);
+
+private:
+	/*Maps the file with room for Capacity records - grows the file if needed*/
+	bool Map(int64 Capacity);
+
+	void Unmap();
+
+	/*Moves a file we can't read out of the way*/
+	void Discard();
+
+	/*Copies the in flight batch into the file - runs on the thread pool*/
+	void WriteBatch(int32 NumWritten);
+
+	/*Returns the stored record of the given index*/
+	const FSkillProfileRecord* GetRecord(int32 RecordIndex) const;
+
+	FString Filename;
+
+	bool bAllowMapping = true;
+
+	/*Keeps the file in memory and writes the changed bytes back - mapped or buffered*/
+	TUniquePtr<FSkillProfileFile> File;
+
+	/*The file in memory - owned by File*/
+	uint8* Data = nullptr;
+
+	uint64 MappedSize = 0;
+
+	/*Records the file has room for*/
+	int64 RecordCapacity = 0;
+
+	int32 NumRecords = 0;
+
+	/*The record index of each key*/
+	TMap<uint64, int32> RecordIndices;
+
+	/*Records waiting for the next batch, by record index*/
+	TMap<int32, FSkillProfileRecord> Pending;
+
+	/*The batch being written - only read by the write task until it is done*/
+	TArray<TPair<int32, FSkillProfileRecord>> InFlight;
+
+	/*The position of each record index in InFlight*/
+	TMap<int32, int32> InFlightIndices;
+
+	TFuture<void> WriteTask;
+};
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillProjectilePool.h"
+#include "Engine/World.h"
+#include "SkillsTreeStats.h"
+
+ASkill* FSkillProjectilePool::SpawnPooledSkill(UWorld* World, UClass* SkillClass, const FTransform& SpawnTransform)
+{
+    INC_DWORD_STAT(STAT_SkillsSpawns);
+
+    ASkill* Skill = World->SpawnActorDeferred<ASkill>(SkillClass, SpawnTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+    if (Skill)
+    {
+        //Pooled skills get activated by the pool instead of their BeginPlay
+        Skill->bIsPooled = true;
+        Skill->FinishSpawning(SpawnTransform);
+    }
+    return Skill;
+}
+
+void FSkillProjectilePool::Prewarm(UWorld* World, TSubclassOf<ASkill> SkillClass, int32 Count)
+{
+    if (!World || !SkillClass) return;
+
+    FSkillPoolBucket& Bucket = Buckets.FindOrAdd(SkillClass);
+    Bucket.FreeSkills.Reserve(Count);
+
+    while (Bucket.FreeSkills.Num() < Count)
+    {
+        ASkill* Skill = SpawnPooledSkill(World, SkillClass, FTransform::Identity);
+        if (!Skill) break;
+
+        Skill->DeactivateSkill();
+        Bucket.FreeSkills.Add(Skill);
+    }
+    Bucket.Stats.NumFree = Bucket.FreeSkills.Num();
+}
+
+ASkill* FSkillProjectilePool::Acquire(UWorld* World, TSubclassOf<ASkill> SkillClass, const FTransform& SpawnTransform, AActor* SkillOwner, APawn* SkillInstigator)
+{
+    if (!World || !SkillClass) return nullptr;
+
+    FSkillPoolBucket& Bucket = Buckets.FindOrAdd(SkillClass);
+
+    ASkill* Skill = nullptr;
+    while (!Skill && Bucket.FreeSkills.Num() > 0)
+    {
+        //Skills may have been destroyed behind our back (ie level teardown)
+        ASkill* Candidate = Bucket.FreeSkills.Pop(false);
+        if (Candidate && !Candidate->IsPendingKill()) Skill = Candidate;
+    }
+
+    if (Skill) Bucket.Stats.Hits++;
+    else
+    {
+        Skill = SpawnPooledSkill(World, SkillClass, SpawnTransform);
+        if (!Skill) return nullptr;
+        Bucket.Stats.Misses++;
+    }
+
+    Skill->SetOwner(SkillOwner);
+    Skill->Instigator = SkillInstigator;
+    Skill->ActivateSkill(SpawnTransform);
+
+    Bucket.Stats.NumActive++;
+    Bucket.Stats.NumFree = Bucket.FreeSkills.Num();
+    Bucket.Stats.HighWaterMark = FMath::Max(Bucket.Stats.HighWaterMark, Bucket.Stats.NumActive);
+
+    NumActive++;
+    HighWaterMark = FMath::Max(HighWaterMark, NumActive);
+    return Skill;
+}
+
+void FSkillProjectilePool::Release(ASkill* Skill)
+{
+    if (!Skill || !Skill->IsSkillActive()) return;
+
+    Skill->DeactivateSkill();
+
+    FSkillPoolBucket& Bucket = Buckets.FindOrAdd(Skill->GetClass());
+    Bucket.FreeSkills.Add(Skill);
+    Bucket.Stats.NumActive = FMath::Max(Bucket.Stats.NumActive - 1, 0);
+    Bucket.Stats.NumFree = Bucket.FreeSkills.Num();
+
+    NumActive = FMath::Max(NumActive - 1, 0);
+}
+
+void FSkillProjectilePool::RemoveDestroyed(ASkill* Skill)
+{
+    if (!Skill || !Skill->IsSkillActive()) return;
+
+    if (FSkillPoolBucket* Bucket = Buckets.Find(Skill->GetClass())) Bucket->Stats.NumActive = FMath::Max(Bucket->Stats.NumActive - 1, 0);
+    NumActive = FMath::Max(NumActive - 1, 0);
+}
+
+void FSkillProjectilePool::ClearFreeSkillFX(const UClass* SkillClass)
+{
+    FSkillPoolBucket* Bucket = Buckets.Find(const_cast<UClass*>(SkillClass));
+    if (!Bucket) return;
+
+    for (ASkill* Skill : Bucket->FreeSkills) Skill->ParticleComp->SetTemplate(nullptr);
+}
+
+FSkillPoolStats FSkillProjectilePool::GetStats(TSubclassOf<ASkill> SkillClass) const
+{
+    const FSkillPoolBucket* Bucket = Buckets.Find(SkillClass);
+    return Bucket ? Bucket->Stats : FSkillPoolStats();
+}
+
+FSkillPoolStats FSkillProjectilePool::GetTotalStats() const
+{
+    FSkillPoolStats Total;
+    Total.HighWaterMark = HighWaterMark;
+    for (const auto& It : Buckets)
+    {
+        const FSkillPoolStats& Stats = It.Value.Stats;
+        Total.Hits += Stats.Hits;
+        Total.Misses += Stats.Misses;
+        Total.NumActive += Stats.NumActive;
+        Total.NumFree += Stats.NumFree;
+    }
+    return Total;
+}
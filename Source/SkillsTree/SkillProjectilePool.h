@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Skill.h"
+#include "SkillProjectilePool.generated.h"
+
+/*Pool counters for a single skill class (or for the whole pool)*/
+USTRUCT(BlueprintType)
+struct FSkillPoolStats
+{
+	GENERATED_BODY()
+
+	/*Acquires that were served from the free list*/
+	UPROPERTY(BlueprintReadOnly, Category = TLSkillsTree)
+	int32 Hits = 0;
+
+	/*Acquires that had to spawn a new actor*/
+	UPROPERTY(BlueprintReadOnly, Category = TLSkillsTree)
+	int32 Misses = 0;
+
+	/*The highest number of skills that were in flight at the same time*/
+	UPROPERTY(BlueprintReadOnly, Category = TLSkillsTree)
+	int32 HighWaterMark = 0;
+
+	/*Skills that are currently in flight*/
+	UPROPERTY(BlueprintReadOnly, Category = TLSkillsTree)
+	int32 NumActive = 0;
+
+	/*Skills that are currently waiting in the pool*/
+	UPROPERTY(BlueprintReadOnly, Category = TLSkillsTree)
+	int32 NumFree = 0;
+};
+
+/*The pooled skills of a single skill class*/
+USTRUCT()
+struct FSkillPoolBucket
+{
+	GENERATED_BODY()
+
+	/*Deactivated skills which are ready to be handed out*/
+	UPROPERTY()
+	TArray<ASkill*> FreeSkills;
+
+	FSkillPoolStats Stats;
+};
+
+/*A pool of skill projectiles keyed by their class. Skills are never destroyed by the pool,
+they get deactivated on release and re-activated on acquire*/
+USTRUCT()
+struct SKILLSTREE_API FSkillProjectilePool
+{
+	GENERATED_BODY()
+
+	/*Spawns deactivated skills until the free list of the given class holds at least Count skills*/
+	void Prewarm(UWorld* World, TSubclassOf<ASkill> SkillClass, int32 Count);
+
+	/*Returns an activated skill - only spawns a new actor when the free list is empty*/
+	ASkill* Acquire(UWorld* World, TSubclassOf<ASkill> SkillClass, const FTransform& SpawnTransform, AActor* SkillOwner, APawn* SkillInstigator);
+
+	/*Deactivates the given skill and puts it back in the free list of its class*/
+	void Release(ASkill* Skill);
+
+	/*Takes a skill which got destroyed while in flight off the active counts - it never comes back through Release*/
+	void RemoveDestroyed(ASkill* Skill);
+
+	/*Clears the particle template of the free skills of the given class so they don't keep its FX loaded*/
+	void ClearFreeSkillFX(const UClass* SkillClass);
+
+	/*Returns the counters of the given class*/
+	FSkillPoolStats GetStats(TSubclassOf<ASkill> SkillClass) const;
+
+	/*Returns the counters of all the classes combined - the high water mark is the peak of all of them together*/
+	FSkillPoolStats GetTotalStats() const;
+
+private:
+	/*Spawns a new pooled skill - the skill will not activate itself on BeginPlay*/
+	ASkill* SpawnPooledSkill(UWorld* World, UClass* SkillClass, const FTransform& SpawnTransform);
+
+	UPROPERTY()
+	TMap<UClass*, FSkillPoolBucket> Buckets;
+
+	/*Skills of every class in flight - the classes peak at different times, so their high water marks don't add up*/
+	int32 NumActive = 0;
+
+	int32 HighWaterMark = 0;
+};
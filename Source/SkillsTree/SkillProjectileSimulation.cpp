@@ -0,0 +1,378 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillProjectileSimulation.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "SkillSpatialHash.h"
+#include "SkillsTreeStats.h"
+
+int32 FSkillProjectileSimulation::Add(ASkill* Skill, const FVector& Location, const FVector& Velocity, float InRadius, float InGravityZ, AActor* SkillOwner, ESkillType SkillType, float Time)
+{
+    int32 Handle;
+    if (FreeHandles.Num() > 0) Handle = FreeHandles.Pop(false);
+    else Handle = HandleToIndex.Add(INDEX_NONE);
+
+    const int32 Index = Skills.Add(Skill);
+    HandleToIndex[Handle] = Index;
+    IndexToHandle.Add(Handle);
+
+    //Spawns between two steps get moved back onto the last step, so the next step only covers the time since the spawn
+    FVector Start = Location;
+    FVector StartVelocity = Velocity;
+    if (FixedStep > 0.f)
+    {
+        const float Lead = FMath::Clamp((float)(Time - StepTime), 0.f, FixedStep * MaxSubsteps);
+        Start -= Velocity * Lead;
+        StartVelocity.Z -= InGravityZ * Lead;
+    }
+
+    PosX.Add(Start.X); PosY.Add(Start.Y); PosZ.Add(Start.Z);
+    PrevX.Add(Start.X); PrevY.Add(Start.Y); PrevZ.Add(Start.Z);
+    StepX.Add(Start.X); StepY.Add(Start.Y); StepZ.Add(Start.Z);
+    VelX.Add(StartVelocity.X); VelY.Add(StartVelocity.Y); VelZ.Add(StartVelocity.Z);
+    GravityZ.Add(InGravityZ);
+    Radius.Add(InRadius);
+    HomingAccel.Add(0.f); HomingRange.Add(0.f);
+    HomingX.Add(0.f); HomingY.Add(0.f); HomingZ.Add(0.f);
+    HomingWeight.Add(0.f);
+    WrittenLocation.Add(Location);
+    Owners.Add(SkillOwner);
+    Types.Add(SkillType);
+    SweepSerials.Add(++LastSweepSerial);
+
+    return Handle;
+}
+
+void FSkillProjectileSimulation::Remove(int32 Handle)
+{
+    if (!HandleToIndex.IsValidIndex(Handle) || HandleToIndex[Handle] == INDEX_NONE) return;
+
+    RemoveAtIndex(HandleToIndex[Handle]);
+    HandleToIndex[Handle] = INDEX_NONE;
+    FreeHandles.Add(Handle);
+}
+
+void FSkillProjectileSimulation::RemoveAtIndex(int32 Index)
+{
+    //Swap the last projectile in the freed slot so the arrays stay dense
+    const int32 LastIndex = Skills.Num() - 1;
+    if (Index != LastIndex) HandleToIndex[IndexToHandle[LastIndex]] = Index;
+    if (HomingRange[Index] > 0.f) NumHoming--;
+
+    IndexToHandle.RemoveAtSwap(Index, 1, false);
+    PosX.RemoveAtSwap(Index, 1, false); PosY.RemoveAtSwap(Index, 1, false); PosZ.RemoveAtSwap(Index, 1, false);
+    PrevX.RemoveAtSwap(Index, 1, false); PrevY.RemoveAtSwap(Index, 1, false); PrevZ.RemoveAtSwap(Index, 1, false);
+    StepX.RemoveAtSwap(Index, 1, false); StepY.RemoveAtSwap(Index, 1, false); StepZ.RemoveAtSwap(Index, 1, false);
+    VelX.RemoveAtSwap(Index, 1, false); VelY.RemoveAtSwap(Index, 1, false); VelZ.RemoveAtSwap(Index, 1, false);
+    GravityZ.RemoveAtSwap(Index, 1, false);
+    Radius.RemoveAtSwap(Index, 1, false);
+    HomingAccel.RemoveAtSwap(Index, 1, false); HomingRange.RemoveAtSwap(Index, 1, false);
+    HomingX.RemoveAtSwap(Index, 1, false); HomingY.RemoveAtSwap(Index, 1, false); HomingZ.RemoveAtSwap(Index, 1, false);
+    HomingWeight.RemoveAtSwap(Index, 1, false);
+    WrittenLocation.RemoveAtSwap(Index, 1, false);
+    Owners.RemoveAtSwap(Index, 1, false);
+    Types.RemoveAtSwap(Index, 1, false);
+    SweepSerials.RemoveAtSwap(Index, 1, false);
+    Skills.RemoveAtSwap(Index, 1, false);
+}
+
+void FSkillProjectileSimulation::SetHoming(int32 Handle, float Acceleration, float Range)
+{
+    if (!HandleToIndex.IsValidIndex(Handle) || HandleToIndex[Handle] == INDEX_NONE) return;
+
+    const int32 Index = HandleToIndex[Handle];
+    const bool bWasHoming = HomingRange[Index] > 0.f;
+    HomingAccel[Index] = FMath::Max(Acceleration, 0.f);
+    HomingRange[Index] = (Acceleration > 0.f) ? FMath::Max(Range, 0.f) : 0.f;
+    HomingWeight[Index] = 0.f;
+    NumHoming += (HomingRange[Index] > 0.f ? 1 : 0) - (bWasHoming ? 1 : 0);
+}
+
+void FSkillProjectileSimulation::Teleport(int32 Handle, const FVector& Location, const FVector& Velocity)
+{
+    if (!HandleToIndex.IsValidIndex(Handle) || HandleToIndex[Handle] == INDEX_NONE) return;
+
+    const int32 Index = HandleToIndex[Handle];
+    PosX[Index] = PrevX[Index] = StepX[Index] = Location.X;
+    PosY[Index] = PrevY[Index] = StepY[Index] = Location.Y;
+    PosZ[Index] = PrevZ[Index] = StepZ[Index] = Location.Z;
+    VelX[Index] = Velocity.X; VelY[Index] = Velocity.Y; VelZ[Index] = Velocity.Z;
+
+    //The pending sweeps still start at the old location - their results are dropped
+    InvalidateSweeps(Index);
+}
+
+FVector FSkillProjectileSimulation::GetLocation(int32 Handle) const
+{
+    if (!HandleToIndex.IsValidIndex(Handle) || HandleToIndex[Handle] == INDEX_NONE) return FVector::ZeroVector;
+
+    const int32 Index = HandleToIndex[Handle];
+    return FVector(PosX[Index], PosY[Index], PosZ[Index]);
+}
+
+SIZE_T FSkillProjectileSimulation::GetAllocatedSize() const
+{
+    return PosX.GetAllocatedSize() * 3 + PrevX.GetAllocatedSize() * 3 + StepX.GetAllocatedSize() * 3 + VelX.GetAllocatedSize() * 3 + GravityZ.GetAllocatedSize() + Radius.GetAllocatedSize()
+        + HomingAccel.GetAllocatedSize() * 2 + HomingX.GetAllocatedSize() * 3 + HomingWeight.GetAllocatedSize()
+        + WrittenLocation.GetAllocatedSize() + Owners.GetAllocatedSize() + Types.GetAllocatedSize() + SweepSerials.GetAllocatedSize() + Skills.GetAllocatedSize()
+        + IndexToHandle.GetAllocatedSize() + HandleToIndex.GetAllocatedSize() + FreeHandles.GetAllocatedSize() + PendingHits.GetAllocatedSize() + StepSweeps.GetAllocatedSize();
+}
+
+void FSkillProjectileSimulation::IntegrateRange(int32 Start, int32 End, float DeltaTime)
+{
+    float* RESTRICT PX = PosX.GetData();
+    float* RESTRICT PY = PosY.GetData();
+    float* RESTRICT PZ = PosZ.GetData();
+    float* RESTRICT OX = StepX.GetData();
+    float* RESTRICT OY = StepY.GetData();
+    float* RESTRICT OZ = StepZ.GetData();
+    float* RESTRICT VX = VelX.GetData();
+    float* RESTRICT VY = VelY.GetData();
+    float* RESTRICT VZ = VelZ.GetData();
+    const float* RESTRICT GZ = GravityZ.GetData();
+
+    //Straight float loops without branches - these get auto-vectorized
+    for (int32 i = Start; i < End; i++)
+    {
+        OX[i] = PX[i];
+        OY[i] = PY[i];
+        OZ[i] = PZ[i];
+    }
+    for (int32 i = Start; i < End; i++)
+    {
+        VZ[i] += GZ[i] * DeltaTime;
+    }
+    if (NumHoming > 0)
+    {
+        const float* RESTRICT HX = HomingX.GetData();
+        const float* RESTRICT HY = HomingY.GetData();
+        const float* RESTRICT HZ = HomingZ.GetData();
+        const float* RESTRICT HA = HomingAccel.GetData();
+        const float* RESTRICT HW = HomingWeight.GetData();
+
+        //Turns towards the target and keeps the speed - projectiles without a target have a weight of 0
+        for (int32 i = Start; i < End; i++)
+        {
+            const float DX = HX[i] - PX[i];
+            const float DY = HY[i] - PY[i];
+            const float DZ = HZ[i] - PZ[i];
+            const float Speed = FMath::Sqrt(VX[i] * VX[i] + VY[i] * VY[i] + VZ[i] * VZ[i]);
+            const float Steer = HA[i] * HW[i] * DeltaTime * FMath::InvSqrt(FMath::Max(DX * DX + DY * DY + DZ * DZ, 1.f));
+
+            const float NX = VX[i] + DX * Steer;
+            const float NY = VY[i] + DY * Steer;
+            const float NZ = VZ[i] + DZ * Steer;
+            const float Scale = Speed * FMath::InvSqrt(FMath::Max(NX * NX + NY * NY + NZ * NZ, SMALL_NUMBER));
+            VX[i] = NX * Scale;
+            VY[i] = NY * Scale;
+            VZ[i] = NZ * Scale;
+        }
+    }
+    for (int32 i = Start; i < End; i++)
+    {
+        PX[i] += VX[i] * DeltaTime;
+        PY[i] += VY[i] * DeltaTime;
+        PZ[i] += VZ[i] * DeltaTime;
+    }
+}
+
+void FSkillProjectileSimulation::AcquireHomingTargets()
+{
+    SCOPE_CYCLE_COUNTER(STAT_SkillsAcquireTargets);
+
+    const int32 NumProjectiles = Skills.Num();
+    const int32 NumChunks = FMath::DivideAndRoundUp(NumProjectiles, ChunkSize);
+    ParallelFor(NumChunks, [this, NumProjectiles](int32 Chunk)
+    {
+        //The grid only gets read here - it is updated after physics, long before the next Simulate
+        TArray<int32, TInlineAllocator<16>> Nearest;
+        const int32 Start = Chunk * ChunkSize;
+        const int32 End = FMath::Min(Start + ChunkSize, NumProjectiles);
+
+        for (int32 i = Start; i < End; i++)
+        {
+            if (HomingRange[i] <= 0.f) continue;
+
+            HomingWeight[i] = 0.f;
+            if (Targets->QueryNearest(FVector(PosX[i], PosY[i], PosZ[i]), HomingRange[i], 1, Nearest, Owners[i]) == 0) continue;
+
+            const FVector Target = Targets->GetLocation(Nearest[0]);
+            HomingX[i] = Target.X;
+            HomingY[i] = Target.Y;
+            HomingZ[i] = Target.Z;
+            HomingWeight[i] = 1.f;
+        }
+    }, NumChunks < 2);
+}
+
+void FSkillProjectileSimulation::Integrate(float DeltaTime)
+{
+    const int32 NumProjectiles = Skills.Num();
+    const int32 NumChunks = FMath::DivideAndRoundUp(NumProjectiles, ChunkSize);
+    ParallelFor(NumChunks, [this, NumProjectiles, DeltaTime](int32 Chunk)
+    {
+        const int32 Start = Chunk * ChunkSize;
+        IntegrateRange(Start, FMath::Min(Start + ChunkSize, NumProjectiles), DeltaTime);
+    }, NumChunks < 2);
+}
+
+void FSkillProjectileSimulation::Simulate(UWorld* World, float DeltaTime)
+{
+    //Results of last frame's sweeps come first - projectiles which hit something stop before integrating
+    if (bAsyncSweeps) ConsumeAsyncSweeps(World);
+
+    if (DeltaTime <= 0.f) return;
+
+    if (NumHoming > 0 && Targets) AcquireHomingTargets();
+
+    //Without a FixedStep the frame is one step
+    int32 NumSteps = 1;
+    float StepDelta = DeltaTime;
+    StepAlpha = 1.f;
+
+    if (FixedStep > 0.f)
+    {
+        //The clock runs even without projectiles so new ones start on the same step boundaries
+        Accumulator += DeltaTime;
+        NumSteps = FMath::FloorToInt(Accumulator / FixedStep);
+        if (NumSteps > MaxSubsteps)
+        {
+            Accumulator -= (NumSteps - MaxSubsteps) * (double)FixedStep;
+            NumSteps = MaxSubsteps;
+        }
+        Accumulator -= NumSteps * (double)FixedStep;
+        StepTime = World->GetTimeSeconds() - Accumulator;
+        StepAlpha = (float)(Accumulator / FixedStep);
+        StepDelta = FixedStep;
+    }
+
+    if (Skills.Num() == 0) return;
+
+    if (NumSteps > 0)
+    {
+        //Where the frame started - async sweeps draw from here until their results are in
+        FMemory::Memcpy(PrevX.GetData(), PosX.GetData(), PosX.Num() * sizeof(float));
+        FMemory::Memcpy(PrevY.GetData(), PosY.GetData(), PosY.Num() * sizeof(float));
+        FMemory::Memcpy(PrevZ.GetData(), PosZ.GetData(), PosZ.Num() * sizeof(float));
+    }
+
+    for (int32 Step = 0; Step < NumSteps && Skills.Num() > 0; Step++)
+    {
+        SCOPE_CYCLE_COUNTER(STAT_SkillsSimulateSubstep);
+        INC_DWORD_STAT(STAT_SkillsSubsteps);
+
+        //Each step gets swept on its own - a frame's steps bent by gravity or homing are not one straight segment
+        Integrate(StepDelta);
+        SweepStep(World);
+    }
+
+    //Frames without a step still move the draw locations along
+    WriteBack(NumSteps > 0);
+}
+
+FVector FSkillProjectileSimulation::GetDrawLocation(int32 Index) const
+{
+    const FVector Location(PosX[Index], PosY[Index], PosZ[Index]);
+    if (FixedStep <= 0.f) return Location;
+
+    return FMath::Lerp(FVector(StepX[Index], StepY[Index], StepZ[Index]), Location, StepAlpha);
+}
+
+FCollisionQueryParams FSkillProjectileSimulation::MakeQueryParams(int32 Index) const
+{
+    FCollisionQueryParams QueryParams(NAME_None, false, Skills[Index]);
+    QueryParams.AddIgnoredActor(Owners[Index]);
+    QueryParams.AddIgnoredComponents(Skills[Index]->GetIgnoredComponents());
+    return QueryParams;
+}
+
+void FSkillProjectileSimulation::StopAtHit(int32 Index, const FHitResult& Hit)
+{
+    PosX[Index] = StepX[Index] = Hit.Location.X;
+    PosY[Index] = StepY[Index] = Hit.Location.Y;
+    PosZ[Index] = StepZ[Index] = Hit.Location.Z;
+    PendingHits.Emplace(Skills[Index], Hit);
+}
+
+void FSkillProjectileSimulation::SweepStep(UWorld* World)
+{
+    for (int32 i = 0; i < Skills.Num(); i++)
+    {
+        ASkill* Skill = Skills[i];
+        const FVector Start(StepX[i], StepY[i], StepZ[i]);
+        const FVector End(PosX[i], PosY[i], PosZ[i]);
+
+        if (bAsyncSweeps)
+        {
+            //Runs on the physics tasks at the end of the frame - consumed on the next Simulate
+            StepSweeps.Add({ IndexToHandle[i], SweepSerials[i], Start, End, Skill->AsyncSweepSimulatedSkill(Start, End, Radius[i], MakeQueryParams(i)) });
+            continue;
+        }
+
+        FHitResult Hit;
+        if (Skill->SweepSimulatedSkill(Start, End, Radius[i], MakeQueryParams(i), Hit)) StopAtHit(i, Hit);
+    }
+
+    //Projectiles which hit leave the simulation before the next step
+    ResolvePendingHits();
+}
+
+void FSkillProjectileSimulation::WriteBack(bool bSwept)
+{
+    const float ToleranceSq = FMath::Square(WriteBackTolerance);
+
+    for (int32 i = 0; i < Skills.Num(); i++)
+    {
+        //Fixed steps get drawn between the last two steps - nothing past the frame's start is known to be clear while its sweeps are pending
+        const FVector DrawLocation = (bSwept && bAsyncSweeps) ? FVector(PrevX[i], PrevY[i], PrevZ[i]) : GetDrawLocation(i);
+
+        //Only touch the actor when the move is actually visible
+        if (FVector::DistSquared(DrawLocation, WrittenLocation[i]) > ToleranceSq)
+        {
+            Skills[i]->SetActorLocation(DrawLocation, false, nullptr, ETeleportType::None);
+            WrittenLocation[i] = DrawLocation;
+        }
+    }
+}
+
+void FSkillProjectileSimulation::ConsumeAsyncSweeps(UWorld* World)
+{
+    FTraceDatum Datum;
+
+    //The sweeps are in step order, so the first hit of a projectile is the one of its earliest step
+    for (const FStepSweep& Sweep : StepSweeps)
+    {
+        const int32 Index = HandleToIndex.IsValidIndex(Sweep.Handle) ? HandleToIndex[Sweep.Handle] : INDEX_NONE;
+        if (Index == INDEX_NONE || SweepSerials[Index] != Sweep.Serial) continue;
+
+        FHitResult Hit;
+        if (!World->QueryTraceData(Sweep.Trace, Datum))
+        {
+            //The trace never ran or its result is gone - we sweep the step here instead of missing the hit
+            if (!Skills[Index]->SweepSimulatedSkill(Sweep.Start, Sweep.End, Radius[Index], MakeQueryParams(Index), Hit)) continue;
+        }
+        else
+        {
+            const FHitResult* BlockingHit = Datum.OutHits.FindByPredicate([](const FHitResult& It) { return It.bBlockingHit; });
+            if (!BlockingHit) continue;
+            Hit = *BlockingHit;
+        }
+
+        //The projectile moved on during the frame the sweep took - put it back where it hit and drop its later steps
+        StopAtHit(Index, Hit);
+        InvalidateSweeps(Index);
+    }
+    StepSweeps.Reset();
+
+    ResolvePendingHits();
+}
+
+void FSkillProjectileSimulation::ResolvePendingHits()
+{
+    //Hits may remove projectiles from the simulation so they get resolved after the loops
+    for (const auto& It : PendingHits)
+    {
+        It.Key->HandleSimulatedHit(It.Value);
+    }
+    PendingHits.Reset();
+}
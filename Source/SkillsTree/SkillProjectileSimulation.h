@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WorldCollision.h"
+#include "Skill.h"
+
+class FSkillSpatialHash;
+
+/*Simulates every batched skill projectile of a world in one pass.
+The projectile state is stored as structure of arrays so the integration loop is a plain
+float loop over contiguous memory which gets split in chunks across the task graph.
+Projectiles are addressed by stable handles - the dense arrays get compacted with swap-removes.
+With a FixedStep the simulation advances in whole steps from an accumulator, so the same inputs give the
+same paths whatever the frame rate - spawns join on the step clock, every step gets its own sweep and
+the actors get placed between the last two steps*/
+class SKILLSTREE_API FSkillProjectileSimulation
+{
+public:
+	/*Registers a projectile which was at Location at the world's Time and returns its handle*/
+	int32 Add(ASkill* Skill, const FVector& Location, const FVector& Velocity, float Radius, float GravityZ, AActor* SkillOwner, ESkillType SkillType, float Time);
+
+	/*Unregisters the projectile of the given handle - the handle becomes invalid*/
+	void Remove(int32 Handle);
+
+	/*Moves every projectile by DeltaTime, sweeps the travelled segments and writes the results back to the actors*/
+	void Simulate(UWorld* World, float DeltaTime);
+
+	/*Steers the given projectile towards the nearest target within Range - 0 turns homing off*/
+	void SetHoming(int32 Handle, float Acceleration, float Range);
+
+	/*Moves the given projectile to a new location and velocity without sweeping*/
+	void Teleport(int32 Handle, const FVector& Location, const FVector& Velocity);
+
+	/*Returns the simulated location of the given projectile*/
+	FVector GetLocation(int32 Handle) const;
+
+	/*Returns the number of simulated projectiles*/
+	int32 Num() const { return Skills.Num(); }
+
+	/*Returns the memory used by the projectile state*/
+	SIZE_T GetAllocatedSize() const;
+
+	/*Projectiles only get moved when they drifted further than this from their last written location*/
+	float WriteBackTolerance = 1.f;
+
+	/*The amount of projectiles each parallel task integrates*/
+	int32 ChunkSize = 512;
+
+	/*When true the sweeps get issued as async traces and their results are consumed on the next frame, step by step.
+	Until then the actors get drawn at the start of their unconfirmed path, so they never show up past a wall*/
+	bool bAsyncSweeps = true;
+
+	/*The duration of a simulation step in seconds - 0 integrates the frame's delta time in one go*/
+	float FixedStep = 0.f;
+
+	/*The most steps per frame - time beyond that gets dropped so a hitch can't snowball*/
+	int32 MaxSubsteps = 8;
+
+	/*Where homing projectiles find their targets - homing is off without it*/
+	const FSkillSpatialHash* Targets = nullptr;
+
+private:
+	/*Integrates velocities and locations of the [Start, End) range - the locations before the step are kept for its sweep*/
+	void IntegrateRange(int32 Start, int32 End, float DeltaTime);
+
+	/*Picks the nearest target of every homing projectile in parallel chunks - once per frame, not per step*/
+	void AcquireHomingTargets();
+
+	/*Integrates every projectile in parallel chunks*/
+	void Integrate(float DeltaTime);
+
+	/*Returns where the actor of the given projectile gets drawn*/
+	FVector GetDrawLocation(int32 Index) const;
+
+	/*Sweeps the segments of the last step - sync sweeps stop their projectiles before the next step - game thread only*/
+	void SweepStep(UWorld* World);
+
+	/*Updates the actors - bSwept tells if this frame issued sweeps whose results are still pending*/
+	void WriteBack(bool bSwept);
+
+	/*Applies the results of the async sweeps of the last frame in step order - sweeps whose result got lost are redone synchronously*/
+	void ConsumeAsyncSweeps(UWorld* World);
+
+	/*Makes the pending async sweeps of the given projectile stale - its path changed since they were issued*/
+	void InvalidateSweeps(int32 Index) { SweepSerials[Index] = ++LastSweepSerial; }
+
+	/*Returns the query params of the sweeps of the given projectile - they ignore the skill and its owner*/
+	FCollisionQueryParams MakeQueryParams(int32 Index) const;
+
+	/*Moves the given projectile back to where it hit and queues the hit*/
+	void StopAtHit(int32 Index, const FHitResult& Hit);
+
+	/*Hands the hits of the last sweeps to their skills*/
+	void ResolvePendingHits();
+
+	void RemoveAtIndex(int32 Index);
+
+	//Dense projectile state - one entry per projectile
+	TArray<float> PosX, PosY, PosZ;
+	TArray<float> PrevX, PrevY, PrevZ;
+	TArray<float> StepX, StepY, StepZ;
+	TArray<float> VelX, VelY, VelZ;
+	TArray<float> GravityZ;
+	TArray<float> Radius;
+	TArray<float> HomingAccel, HomingRange;
+	TArray<float> HomingX, HomingY, HomingZ;
+	TArray<float> HomingWeight;
+	TArray<FVector> WrittenLocation;
+	TArray<AActor*> Owners;
+	TArray<ESkillType> Types;
+	TArray<uint32> SweepSerials;
+	TArray<ASkill*> Skills;
+
+	//Handle indirection
+	TArray<int32> IndexToHandle;
+	TArray<int32> HandleToIndex;
+	TArray<int32> FreeHandles;
+
+	/*The amount of projectiles with a HomingRange - the steering loop is skipped without them*/
+	int32 NumHoming = 0;
+
+	/*Time which didn't make up a whole FixedStep yet - double so long sessions don't drift*/
+	double Accumulator = 0.0;
+
+	/*The world time of the last step - Accumulator seconds before the world's time*/
+	double StepTime = 0.0;
+
+	/*How far the draw locations are between the last two steps*/
+	float StepAlpha = 1.f;
+
+	/*An async sweep of one step of one projectile*/
+	struct FStepSweep
+	{
+		int32 Handle;
+		uint32 Serial;
+		FVector Start;
+		FVector End;
+		FTraceHandle Trace;
+	};
+
+	/*The async sweeps of the last frame in step order*/
+	TArray<FStepSweep> StepSweeps;
+
+	/*Bumped whenever a projectile's pending sweeps become stale*/
+	uint32 LastSweepSerial = 0;
+
+	/*Projectiles that hit something during the last sweep*/
+	TArray<TPair<ASkill*, FHitResult>> PendingHits;
+};
@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillSpatialHash.h"
+#include "GameFramework/Actor.h"
+
+void FSkillSpatialHash::Init(float InCellSize, int32 InNumBuckets)
+{
+    CellSize = FMath::Max(InCellSize, 1.f);
+    InvCellSize = 1.f / CellSize;
+    NumRegistered = 0;
+
+    //A power of two so the hash only needs a mask
+    Buckets.Reset();
+    Buckets.SetNum(FMath::RoundUpToPowerOfTwo(FMath::Max(InNumBuckets, 1)));
+
+    LocX.Reset(); LocY.Reset(); LocZ.Reset();
+    CellX.Reset(); CellY.Reset();
+    Actors.Reset();
+    FreeSlots.Reset();
+}
+
+int32 FSkillSpatialHash::GetBucket(int32 InCellX, int32 InCellY) const
+{
+    const uint32 Hash = ((uint32)InCellX * 73856093u) ^ ((uint32)InCellY * 19349663u);
+    return (int32)(Hash & (uint32)(Buckets.Num() - 1));
+}
+
+int32 FSkillSpatialHash::Register(AActor* Actor)
+{
+    if (!Actor || !IsInitialized()) return INDEX_NONE;
+
+    int32 Slot;
+    if (FreeSlots.Num() > 0)
+    {
+        Slot = FreeSlots.Pop(false);
+    }
+    else
+    {
+        Slot = Actors.AddUninitialized();
+        LocX.AddUninitialized(); LocY.AddUninitialized(); LocZ.AddUninitialized();
+        CellX.AddUninitialized(); CellY.AddUninitialized();
+    }
+
+    const FVector Location = Actor->GetActorLocation();
+    Actors[Slot] = Actor;
+    LocX[Slot] = Location.X; LocY[Slot] = Location.Y; LocZ[Slot] = Location.Z;
+    CellX[Slot] = FMath::FloorToInt(Location.X * InvCellSize);
+    CellY[Slot] = FMath::FloorToInt(Location.Y * InvCellSize);
+    Buckets[GetBucket(CellX[Slot], CellY[Slot])].Add(Slot);
+
+    NumRegistered++;
+    return Slot;
+}
+
+void FSkillSpatialHash::Unregister(int32 Slot)
+{
+    if (!Actors.IsValidIndex(Slot) || !Actors[Slot]) return;
+
+    Buckets[GetBucket(CellX[Slot], CellY[Slot])].RemoveSingleSwap(Slot, false);
+    Actors[Slot] = nullptr;
+    FreeSlots.Add(Slot);
+    NumRegistered--;
+}
+
+void FSkillSpatialHash::Update()
+{
+    for (int32 Slot = 0; Slot < Actors.Num(); Slot++)
+    {
+        const AActor* Actor = Actors[Slot];
+        if (!Actor) continue;
+
+        const FVector Location = Actor->GetActorLocation();
+        LocX[Slot] = Location.X; LocY[Slot] = Location.Y; LocZ[Slot] = Location.Z;
+
+        //Most targets stay in their cell from one frame to the next
+        const int32 NewCellX = FMath::FloorToInt(Location.X * InvCellSize);
+        const int32 NewCellY = FMath::FloorToInt(Location.Y * InvCellSize);
+        if (NewCellX == CellX[Slot] && NewCellY == CellY[Slot]) continue;
+
+        Buckets[GetBucket(CellX[Slot], CellY[Slot])].RemoveSingleSwap(Slot, false);
+        Buckets[GetBucket(NewCellX, NewCellY)].Add(Slot);
+        CellX[Slot] = NewCellX;
+        CellY[Slot] = NewCellY;
+    }
+}
+
+template <typename FunctorType>
+void FSkillSpatialHash::ForEachInCell(int32 InCellX, int32 InCellY, const FVector& Center, float RadiusSq, const AActor* IgnoredActor, FunctorType&& Functor) const
+{
+    for (int32 Slot : Buckets[GetBucket(InCellX, InCellY)])
+    {
+        //Other cells which share the bucket
+        if (CellX[Slot] != InCellX || CellY[Slot] != InCellY || Actors[Slot] == IgnoredActor) continue;
+
+        const float DistanceSq = FMath::Square(LocX[Slot] - Center.X) + FMath::Square(LocY[Slot] - Center.Y) + FMath::Square(LocZ[Slot] - Center.Z);
+        if (DistanceSq <= RadiusSq) Functor(Slot, DistanceSq);
+    }
+}
+
+int32 FSkillSpatialHash::QueryRadius(const FVector& Center, float Radius, TArray<int32, TInlineAllocator<16>>& OutSlots, const AActor* IgnoredActor) const
+{
+    if (!IsInitialized() || NumRegistered == 0) return 0;
+
+    const int32 MinX = FMath::FloorToInt((Center.X - Radius) * InvCellSize);
+    const int32 MaxX = FMath::FloorToInt((Center.X + Radius) * InvCellSize);
+    const int32 MinY = FMath::FloorToInt((Center.Y - Radius) * InvCellSize);
+    const int32 MaxY = FMath::FloorToInt((Center.Y + Radius) * InvCellSize);
+    const float RadiusSq = FMath::Square(Radius);
+
+    int32 NumFound = 0;
+    for (int32 X = MinX; X <= MaxX; X++)
+    {
+        for (int32 Y = MinY; Y <= MaxY; Y++)
+        {
+            ForEachInCell(X, Y, Center, RadiusSq, IgnoredActor, [&OutSlots, &NumFound](int32 Slot, float DistanceSq)
+            {
+                OutSlots.Add(Slot);
+                NumFound++;
+            });
+        }
+    }
+    return NumFound;
+}
+
+int32 FSkillSpatialHash::QueryNearest(const FVector& Center, float MaxRadius, int32 Count, TArray<int32, TInlineAllocator<16>>& OutSlots, const AActor* IgnoredActor) const
+{
+    OutSlots.Reset();
+    if (!IsInitialized() || NumRegistered == 0 || Count <= 0) return 0;
+
+    //The best targets so far, nearest first
+    TArray<TPair<float, int32>, TInlineAllocator<16>> Best;
+    auto Insert = [&Best, Count](int32 Slot, float DistanceSq)
+    {
+        if (Best.Num() == Count && DistanceSq >= Best.Last().Key) return;
+
+        int32 Index = Best.Num();
+        while (Index > 0 && Best[Index - 1].Key > DistanceSq) Index--;
+        Best.Insert(MakeTuple(DistanceSq, Slot), Index);
+        if (Best.Num() > Count) Best.Pop(false);
+    };
+
+    //Rings of cells around the center's cell - ring N covers every target within N cells
+    const int32 CenterX = FMath::FloorToInt(Center.X * InvCellSize);
+    const int32 CenterY = FMath::FloorToInt(Center.Y * InvCellSize);
+    const int32 MaxRing = FMath::FloorToInt(MaxRadius * InvCellSize) + 1;
+    const float RadiusSq = FMath::Square(MaxRadius);
+
+    for (int32 Ring = 0; Ring <= MaxRing; Ring++)
+    {
+        if (Ring == 0)
+        {
+            ForEachInCell(CenterX, CenterY, Center, RadiusSq, IgnoredActor, Insert);
+        }
+        else
+        {
+            for (int32 Offset = -Ring; Offset <= Ring; Offset++)
+            {
+                ForEachInCell(CenterX + Offset, CenterY - Ring, Center, RadiusSq, IgnoredActor, Insert);
+                ForEachInCell(CenterX + Offset, CenterY + Ring, Center, RadiusSq, IgnoredActor, Insert);
+            }
+            for (int32 Offset = -Ring + 1; Offset < Ring; Offset++)
+            {
+                ForEachInCell(CenterX - Ring, CenterY + Offset, Center, RadiusSq, IgnoredActor, Insert);
+                ForEachInCell(CenterX + Ring, CenterY + Offset, Center, RadiusSq, IgnoredActor, Insert);
+            }
+        }
+
+        //Anything in the next ring is at least Ring cells away
+        if (Best.Num() == Count && Best.Last().Key <= FMath::Square(Ring * CellSize)) break;
+    }
+
+    for (const TPair<float, int32>& It : Best) OutSlots.Add(It.Value);
+    return OutSlots.Num();
+}
+
+SIZE_T FSkillSpatialHash::GetAllocatedSize() const
+{
+    SIZE_T Size = Buckets.GetAllocatedSize();
+    for (const auto& Bucket : Buckets) Size += Bucket.GetAllocatedSize();
+
+    return Size + LocX.GetAllocatedSize() * 3 + CellX.GetAllocatedSize() * 2 + Actors.GetAllocatedSize() + FreeSlots.GetAllocatedSize();
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*Uniform grid of the skill targets of a world (characters etc.) for the queries of area of effect and homing skills.
+The grid is infinite - every cell hashes into one of a fixed amount of buckets, so the memory only depends on the
+amount of targets. Each target remembers its cell, which filters the other cells sharing a bucket out of a query
+and lets Update move only the targets which crossed a cell border. Cells are 2D - targets stack up on the ground,
+the distance tests of the queries are 3D.
+Actors must unregister before they get destroyed (ie in EndPlay)*/
+class SKILLSTREE_API FSkillSpatialHash
+{
+public:
+	/*Sets up the buckets - clears every registered target*/
+	void Init(float InCellSize, int32 InNumBuckets);
+
+	/*Adds the given actor to the grid and returns its slot*/
+	int32 Register(AActor* Actor);
+
+	/*Removes the actor of the given slot from the grid*/
+	void Unregister(int32 Slot);
+
+	/*Reads the locations of the targets - only the ones which left their cell get moved in the grid*/
+	void Update();
+
+	/*Appends the slots of the targets within Radius of Center to OutSlots - returns the amount of targets found*/
+	int32 QueryRadius(const FVector& Center, float Radius, TArray<int32, TInlineAllocator<16>>& OutSlots, const AActor* IgnoredActor = nullptr) const;
+
+	/*Fills OutSlots with the up to Count nearest targets within MaxRadius, nearest first - returns the amount of targets found*/
+	int32 QueryNearest(const FVector& Center, float MaxRadius, int32 Count, TArray<int32, TInlineAllocator<16>>& OutSlots, const AActor* IgnoredActor = nullptr) const;
+
+	/*Returns the actor of the given slot*/
+	AActor* GetActor(int32 Slot) const { return Actors[Slot]; }
+
+	/*Returns the location of the given slot as of the last Update*/
+	FVector GetLocation(int32 Slot) const { return FVector(LocX[Slot], LocY[Slot], LocZ[Slot]); }
+
+	/*Returns true if the grid has its buckets*/
+	bool IsInitialized() const { return Buckets.Num() > 0; }
+
+	/*Returns the number of registered targets*/
+	int32 Num() const { return NumRegistered; }
+
+	/*Returns the memory used by the grid*/
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	/*Returns the bucket of the given cell*/
+	int32 GetBucket(int32 CellX, int32 CellY) const;
+
+	/*Calls Functor(Slot, DistanceSq) for every target of the given cell within RadiusSq of Center*/
+	template <typename FunctorType>
+	void ForEachInCell(int32 CellX, int32 CellY, const FVector& Center, float RadiusSq, const AActor* IgnoredActor, FunctorType&& Functor) const;
+
+	float CellSize = 500.f;
+
+	float InvCellSize = 1.f / 500.f;
+
+	int32 NumRegistered = 0;
+
+	/*Slots of the targets in each bucket*/
+	TArray<TArray<int32, TInlineAllocator<4>>> Buckets;
+
+	//One entry per slot
+	TArray<float> LocX, LocY, LocZ;
+	TArray<int32> CellX, CellY;
+	TArray<AActor*> Actors;
+	TArray<int32> FreeSlots;
+};
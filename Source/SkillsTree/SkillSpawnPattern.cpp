@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillSpawnPattern.h"
+
+void FSkillSpawnPattern::AppendRelativeTransforms(TArray<FTransform>& OutTransforms) const
+{
+    OutTransforms.Reserve(OutTransforms.Num() + Count);
+
+    for (int32 i = 0; i < Count; i++)
+    {
+        switch (Shape)
+        {
+            case ESkillSpawnShape::Fan:
+            {
+                //Evenly spread from -Angle/2 to Angle/2 - a single projectile goes straight
+                const float Alpha = (Count > 1) ? (float)i / (Count - 1) : 0.5f;
+                const FRotator Rotation(0.f, FMath::Lerp(-Angle, Angle, Alpha) * 0.5f, 0.f);
+                OutTransforms.Add(FTransform(Rotation, Rotation.Vector() * Radius));
+                break;
+            }
+            case ESkillSpawnShape::Ring:
+            {
+                const float RingAngle = 2.f * PI * i / Count;
+                OutTransforms.Add(FTransform(FVector(0.f, FMath::Cos(RingAngle), FMath::Sin(RingAngle)) * Radius));
+                break;
+            }
+            case ESkillSpawnShape::Cone:
+            {
+                //Golden angle spiral - evenly covers the cone for any count
+                const float GoldenAngle = PI * (3.f - FMath::Sqrt(5.f));
+                const float Polar = FMath::DegreesToRadians(Angle) * FMath::Sqrt((i + 0.5f) / Count);
+                const float Azimuth = GoldenAngle * i;
+                const FVector Direction(FMath::Cos(Polar), FMath::Sin(Polar) * FMath::Cos(Azimuth), FMath::Sin(Polar) * FMath::Sin(Azimuth));
+                OutTransforms.Add(FTransform(Direction.Rotation(), Direction * Radius));
+                break;
+            }
+        }
+    }
+}
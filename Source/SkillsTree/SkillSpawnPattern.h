@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SkillSpawnPattern.generated.h"
+
+/*Spawn transforms of a single volley - inline so firing never touches the heap*/
+typedef TArray<FTransform, TInlineAllocator<32>> FSkillSpawnTransforms;
+
+UENUM(BlueprintType)
+enum class ESkillSpawnShape : uint8
+{
+	/*Projectiles spread horizontally over Angle degrees*/
+	Fan,
+	/*Projectiles placed in a circle of Radius around the aim direction, all facing forward*/
+	Ring,
+	/*Projectiles spread evenly inside a cone with a half angle of Angle degrees*/
+	Cone
+};
+
+/*Describes how the projectiles of one skill level get placed*/
+USTRUCT(BlueprintType)
+struct SKILLSTREE_API FSkillSpawnPattern
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree)
+	ESkillSpawnShape Shape = ESkillSpawnShape::Fan;
+
+	/*The amount of projectiles*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree, meta = (ClampMin = "0"))
+	int32 Count = 1;
+
+	/*Fan: the angle between the outer projectiles - Cone: the half angle of the cone*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree)
+	float Angle = 30.f;
+
+	/*Fan and cone: forward distance from the origin, which spreads the projectiles along the arc - Ring: the radius of the ring.
+	At 0 every projectile of a fan or cone spawns at the origin, on top of the others*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree, meta = (ClampMin = "0"))
+	float Radius = 50.f;
+
+	/*Appends the transforms of the pattern, relative to the pattern origin*/
+	void AppendRelativeTransforms(TArray<FTransform>& OutTransforms) const;
+};
@@ -0,0 +1,248 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillTreeAsset.h"
+#include "SkillsTree.h"
+#include "SkillsComponent.h"
+#include "UObject/UObjectIterator.h"
+
+int32 FCompiledSkillTree::FindNode(FName NodeId) const
+{
+    const int32* Node = NodeById.Find(NodeId);
+    return Node ? *Node : INDEX_NONE;
+}
+
+int32 FCompiledSkillTree::FindNodeBySkill(const UClass* SkillClass) const
+{
+    return SkillClasses.IndexOfByKey(SkillClass);
+}
+
+int32 FCompiledSkillTree::GetTotalCost(int32 Node, int32 Level) const
+{
+    int32 Total = 0;
+    for (int32 i = 0; i < Level; i++) Total += LevelCosts[LevelOffsets[Node] + i];
+    return Total;
+}
+
+bool FCompiledSkillTree::CanLearn(int32 Node, const uint64* Learned) const
+{
+    const uint64* Prerequisites = GetMask(PrerequisiteMasks, Node);
+    const uint64* Exclusive = GetMask(ExclusiveMasks, Node);
+
+    uint64 Missing = 0;
+    uint64 Blocked = 0;
+    for (int32 w = 0; w < NumWords; w++)
+    {
+        Missing |= Prerequisites[w] & ~Learned[w];
+        Blocked |= Exclusive[w] & Learned[w];
+    }
+    return (Missing | Blocked) == 0;
+}
+
+void FCompiledSkillTree::GetUnlockable(const uint64* Learned, uint64* OutMask) const
+{
+    if (NumWords == 0) return;
+
+    //Every node which is not learned yet, minus the padding bits of the last word
+    for (int32 w = 0; w < NumWords; w++) OutMask[w] = ~Learned[w];
+    if (Num() & 63) OutMask[NumWords - 1] &= (1ull << (Num() & 63)) - 1;
+
+    //A missing prerequisite blocks all of its direct dependents at once
+    for (int32 w = 0; w < NumWords; w++)
+    {
+        for (uint64 Missing = ~Learned[w] & HasDependentsMask[w]; Missing; Missing &= Missing - 1)
+        {
+            const uint64* Dependents = GetMask(DependentMasks, w * 64 + (int32)FMath::CountTrailingZeros64(Missing));
+            for (int32 i = 0; i < NumWords; i++) OutMask[i] &= ~Dependents[i];
+        }
+    }
+
+    //A learned node closes its whole branch
+    for (int32 Branch = 0; Branch < NumBranches; Branch++)
+    {
+        const uint64* Members = GetMask(BranchMasks, Branch);
+
+        uint64 Taken = 0;
+        for (int32 w = 0; w < NumWords; w++) Taken |= Members[w] & Learned[w];
+        if (!Taken) continue;
+
+        for (int32 w = 0; w < NumWords; w++) OutMask[w] &= ~Members[w];
+    }
+}
+
+void FCompiledSkillTree::GetRefundMask(int32 Node, const uint64* Learned, uint64* OutMask) const
+{
+    const uint64* Subtree = GetMask(SubtreeMasks, Node);
+    for (int32 w = 0; w < NumWords; w++) OutMask[w] = Subtree[w] & Learned[w];
+
+    SetBit(OutMask, Node);
+}
+
+void USkillTreeAsset::PostLoad()
+{
+    Super::PostLoad();
+
+    Compile();
+}
+
+#if WITH_EDITOR
+void USkillTreeAsset::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+    Super::PostEditChangeProperty(PropertyChangedEvent);
+
+    Compile();
+
+    //The components which use the tree index its nodes and size their masks by it
+    for (TObjectIterator<USkillsComponent> It; It; ++It)
+    {
+        if (It->GetSkillTree() == this) It->RebuildSkillIndex();
+    }
+}
+#endif
+
+const FCompiledSkillTree& USkillTreeAsset::GetCompiledTree()
+{
+    if (!bIsCompiled) Compile();
+    return CompiledTree;
+}
+
+bool USkillTreeAsset::Compile()
+{
+    bIsCompiled = true;
+    CompiledTree = FCompiledSkillTree();
+
+    const int32 NumNodes = Nodes.Num();
+
+    //Resolving the prerequisite names into edges (prerequisite -> dependent)
+    TMap<FName, int32> SourceIndexById;
+    for (int32 i = 0; i < NumNodes; i++)
+    {
+        if (SourceIndexById.Contains(Nodes[i].NodeId))
+        {
+            UE_LOG(LogSkillsTree, Error, TEXT("%s: more than one node is called %s"), *GetName(), *Nodes[i].NodeId.ToString());
+            return false;
+        }
+
+        for (int32 Cost : Nodes[i].LevelCosts)
+        {
+            if (Cost < 0)
+            {
+                UE_LOG(LogSkillsTree, Error, TEXT("%s: node %s has a level which costs less than 0"), *GetName(), *Nodes[i].NodeId.ToString());
+                return false;
+            }
+        }
+
+        SourceIndexById.Add(Nodes[i].NodeId, i);
+    }
+
+    TArray<TArray<int32>> Dependents;
+    Dependents.SetNum(NumNodes);
+    TArray<int32> NumPending;
+    NumPending.SetNumZeroed(NumNodes);
+
+    for (int32 i = 0; i < NumNodes; i++)
+    {
+        for (FName Prerequisite : Nodes[i].Prerequisites)
+        {
+            const int32* Source = SourceIndexById.Find(Prerequisite);
+            if (!Source)
+            {
+                UE_LOG(LogSkillsTree, Warning, TEXT("%s: node %s has an unknown prerequisite %s"), *GetName(), *Nodes[i].NodeId.ToString(), *Prerequisite.ToString());
+                continue;
+            }
+            Dependents[*Source].Add(i);
+            NumPending[i]++;
+        }
+    }
+
+    //Kahn's algorithm - prerequisites always end up before their dependents
+    TArray<int32> Order;
+    Order.Reserve(NumNodes);
+    for (int32 i = 0; i < NumNodes; i++) if (NumPending[i] == 0) Order.Add(i);
+
+    for (int32 Cursor = 0; Cursor < Order.Num(); Cursor++)
+    {
+        for (int32 Dependent : Dependents[Order[Cursor]])
+        {
+            if (--NumPending[Dependent] == 0) Order.Add(Dependent);
+        }
+    }
+
+    if (Order.Num() != NumNodes)
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("%s: the prerequisites of the skill tree contain a cycle"), *GetName());
+        return false;
+    }
+
+    TArray<int32> CompiledIndex;
+    CompiledIndex.SetNumUninitialized(NumNodes);
+    for (int32 i = 0; i < NumNodes; i++) CompiledIndex[Order[i]] = i;
+
+    FCompiledSkillTree& Tree = CompiledTree;
+    Tree.NumWords = FMath::DivideAndRoundUp(NumNodes, 64);
+    Tree.PrerequisiteMasks.SetNumZeroed(NumNodes * Tree.NumWords);
+    Tree.ExclusiveMasks.SetNumZeroed(NumNodes * Tree.NumWords);
+    Tree.SubtreeMasks.SetNumZeroed(NumNodes * Tree.NumWords);
+    Tree.DependentMasks.SetNumZeroed(NumNodes * Tree.NumWords);
+    Tree.HasDependentsMask.SetNumZeroed(Tree.NumWords);
+    Tree.LevelOffsets.Reserve(NumNodes + 1);
+
+    TMap<FName, TArray<int32>> Branches;
+
+    for (int32 Node = 0; Node < NumNodes; Node++)
+    {
+        const FSkillTreeNode& Source = Nodes[Order[Node]];
+
+        Tree.NodeIds.Add(Source.NodeId);
+        Tree.SkillClasses.Add(Source.SkillClass);
+        Tree.NodeById.Add(Source.NodeId, Node);
+
+        Tree.LevelOffsets.Add(Tree.LevelCosts.Num());
+        Tree.LevelCosts.Append(Source.LevelCosts);
+
+        uint64* Prerequisites = Tree.PrerequisiteMasks.GetData() + Node * Tree.NumWords;
+        for (FName Prerequisite : Source.Prerequisites)
+        {
+            if (const int32* SourceIndex = SourceIndexById.Find(Prerequisite)) FCompiledSkillTree::SetBit(Prerequisites, CompiledIndex[*SourceIndex]);
+        }
+
+        if (!Source.ExclusiveBranch.IsNone()) Branches.FindOrAdd(Source.ExclusiveBranch).Add(Node);
+    }
+    Tree.LevelOffsets.Add(Tree.LevelCosts.Num());
+
+    //Every node of a branch excludes the other nodes of that branch
+    Tree.NumBranches = Branches.Num();
+    Tree.BranchMasks.SetNumZeroed(Tree.NumBranches * Tree.NumWords);
+
+    int32 Branch = 0;
+    for (const auto& It : Branches)
+    {
+        uint64* Members = Tree.BranchMasks.GetData() + Branch++ * Tree.NumWords;
+        for (int32 Node : It.Value)
+        {
+            FCompiledSkillTree::SetBit(Members, Node);
+
+            uint64* Exclusive = Tree.ExclusiveMasks.GetData() + Node * Tree.NumWords;
+            for (int32 Other : It.Value) if (Other != Node) FCompiledSkillTree::SetBit(Exclusive, Other);
+        }
+    }
+
+    //Dependents come after their prerequisites so walking backwards gives us complete subtrees
+    for (int32 Node = NumNodes - 1; Node >= 0; Node--)
+    {
+        uint64* Subtree = Tree.SubtreeMasks.GetData() + Node * Tree.NumWords;
+        FCompiledSkillTree::SetBit(Subtree, Node);
+
+        uint64* DirectDependents = Tree.DependentMasks.GetData() + Node * Tree.NumWords;
+        if (Dependents[Order[Node]].Num() > 0) FCompiledSkillTree::SetBit(Tree.HasDependentsMask.GetData(), Node);
+
+        for (int32 Dependent : Dependents[Order[Node]])
+        {
+            FCompiledSkillTree::SetBit(DirectDependents, CompiledIndex[Dependent]);
+
+            const uint64* DependentSubtree = Tree.SubtreeMasks.GetData() + CompiledIndex[Dependent] * Tree.NumWords;
+            for (int32 w = 0; w < Tree.NumWords; w++) Subtree[w] |= DependentSubtree[w];
+        }
+    }
+
+    return true;
+}
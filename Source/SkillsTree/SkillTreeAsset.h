@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Skill.h"
+#include "SkillTreeAsset.generated.h"
+
+/*A single node of a skill tree as authored in the editor*/
+USTRUCT(BlueprintType)
+struct FSkillTreeNode
+{
+	GENERATED_BODY()
+
+	/*Unique name of the node - prerequisites of other nodes reference this name*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree)
+	FName NodeId;
+
+	/*The skill which gets leveled up by this node*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree)
+	TSubclassOf<ASkill> SkillClass;
+
+	/*The skill point cost of each level - the amount of entries is the max level of the node*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree)
+	TArray<int32> LevelCosts;
+
+	/*Nodes which have to be learned before this node can be learned*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree)
+	TArray<FName> Prerequisites;
+
+	/*Nodes of the same branch exclude each other - None means that the node belongs to no branch*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree)
+	FName ExclusiveBranch;
+};
+
+/*A skill tree flattened for bitset evaluation.
+Nodes are stored in topological order and every relation is a bitmask with one bit per node,
+so the queries are a handful of AND/OR ops per 64 nodes*/
+struct SKILLSTREE_API FCompiledSkillTree
+{
+	/*Returns the number of compiled nodes*/
+	int32 Num() const { return NodeIds.Num(); }
+
+	/*Returns the number of uint64 words of every node mask*/
+	int32 GetNumWords() const { return NumWords; }
+
+	/*Returns the id of the given node*/
+	FName GetNodeId(int32 Node) const { return NodeIds[Node]; }
+
+	/*Returns the compiled index of the given node - INDEX_NONE if the tree has no such node*/
+	int32 FindNode(FName NodeId) const;
+
+	/*Returns the compiled index of the first node of the given skill - INDEX_NONE if the tree has no such node*/
+	int32 FindNodeBySkill(const UClass* SkillClass) const;
+
+	/*Returns the max level of the given node*/
+	int32 GetMaxLevel(int32 Node) const { return LevelOffsets[Node + 1] - LevelOffsets[Node]; }
+
+	/*Returns the cost of the given level of the given node (levels start at 1)*/
+	int32 GetLevelCost(int32 Node, int32 Level) const { return LevelCosts[LevelOffsets[Node] + Level - 1]; }
+
+	/*Returns the sum of the costs of the levels 1 to Level of the given node*/
+	int32 GetTotalCost(int32 Node, int32 Level) const;
+
+	/*Returns true if all the prerequisites of the node are learned and no node of its branch is learned*/
+	bool CanLearn(int32 Node, const uint64* Learned) const;
+
+	/*Sets a bit for every node which is not learned yet but could be learned now*/
+	void GetUnlockable(const uint64* Learned, uint64* OutMask) const;
+
+	/*Sets a bit for the given node and every learned node which depends on it*/
+	void GetRefundMask(int32 Node, const uint64* Learned, uint64* OutMask) const;
+
+	FORCEINLINE static bool IsSet(const uint64* Mask, int32 Node) { return (Mask[Node >> 6] & (1ull << (Node & 63))) != 0; }
+	FORCEINLINE static void SetBit(uint64* Mask, int32 Node) { Mask[Node >> 6] |= (1ull << (Node & 63)); }
+	FORCEINLINE static void ClearBit(uint64* Mask, int32 Node) { Mask[Node >> 6] &= ~(1ull << (Node & 63)); }
+
+private:
+	friend class USkillTreeAsset;
+
+	const uint64* GetMask(const TArray<uint64>& Masks, int32 Node) const { return Masks.GetData() + Node * NumWords; }
+
+	int32 NumWords = 0;
+
+	TArray<FName> NodeIds;
+	TArray<const UClass*> SkillClasses;
+	TMap<FName, int32> NodeById;
+
+	/*Per node - the nodes which have to be learned first*/
+	TArray<uint64> PrerequisiteMasks;
+
+	/*Per node - the other nodes of its branch*/
+	TArray<uint64> ExclusiveMasks;
+
+	/*Per node - the node itself and every node which depends on it (directly or not)*/
+	TArray<uint64> SubtreeMasks;
+
+	/*Per node - the nodes which list it as a prerequisite*/
+	TArray<uint64> DependentMasks;
+
+	/*One mask - the nodes which are the prerequisite of at least one other node*/
+	TArray<uint64> HasDependentsMask;
+
+	/*Per branch - the nodes of the branch*/
+	TArray<uint64> BranchMasks;
+	int32 NumBranches = 0;
+
+	/*The costs of all the levels of all the nodes - LevelOffsets[Node] is the first level of the node*/
+	TArray<int32> LevelCosts;
+	TArray<int32> LevelOffsets;
+};
+
+/*A skill tree asset - nodes, per level costs, prerequisites and exclusive branches*/
+UCLASS(BlueprintType)
+class SKILLSTREE_API USkillTreeAsset : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/*The nodes of the tree - the order doesn't matter*/
+	UPROPERTY(EditAnywhere, Category = TLSkillsTree)
+	TArray<FSkillTreeNode> Nodes;
+
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	/*Returns the compiled tree - compiles it first if the nodes changed*/
+	const FCompiledSkillTree& GetCompiledTree();
+
+private:
+	/*Flattens the nodes into CompiledTree - returns false (and leaves an empty tree) when the prerequisites have a cycle,
+	two nodes share a NodeId or a level costs less than 0*/
+	bool Compile();
+
+	FCompiledSkillTree CompiledTree;
+
+	bool bIsCompiled = false;
+};
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "SkillVolley.generated.h"
+
+/*Everything a client needs to rebuild one shot of a character - sent once per volley instead of
+replicating every projectile. The spawn pattern is derived from the slot and level, the per
+projectile jitter from the seed, so the server and every client end up with the same transforms*/
+USTRUCT()
+struct FSkillVolley
+{
+	GENERATED_BODY()
+
+	/*The slot of the skill in the firing character's SkillsArray - 16 bits so every slot FSkillsState replicates fits*/
+	UPROPERTY()
+	uint16 SkillNum = 0;
+
+	/*The level the skill was fired with*/
+	UPROPERTY()
+	uint8 Level = 0;
+
+	/*Where the spawn pattern starts*/
+	UPROPERTY()
+	FVector_NetQuantize10 Origin;
+
+	/*The aim direction of the spawn pattern*/
+	UPROPERTY()
+	FVector_NetQuantizeNormal Direction;
+
+	/*The server world time of the shot - clients move the projectiles forward by the time the volley took to arrive*/
+	UPROPERTY()
+	float ServerTime = 0.f;
+
+	/*Seeds the spread of the projectiles*/
+	UPROPERTY()
+	uint16 Seed = 0;
+
+	/*The key of the client shot this volley confirms - 0 when nobody predicted it*/
+	UPROPERTY()
+	uint16 PredictionKey = 0;
+};
+
+/*A volley the owning client fired before the server confirmed it*/
+struct FPredictedSkillVolley
+{
+	/*What the client fired - SkillNum and Level get compared against the server's volley*/
+	FSkillVolley Volley;
+
+	/*The projectiles spawned for the prediction - they may have hit something or been recycled since*/
+	TArray<TWeakObjectPtr<class ASkill>, TInlineAllocator<8>> Skills;
+
+	/*How far each predicted projectile was off when the server's volley arrived*/
+	TArray<FVector, TInlineAllocator<8>> Errors;
+
+	/*FPlatformTime::Seconds of the fire input*/
+	double FireTime = 0.0;
+
+	/*FPlatformTime::Seconds of the server's volley - 0 until it arrived*/
+	double ConfirmTime = 0.0;
+};
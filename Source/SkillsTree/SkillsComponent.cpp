@@ -1,4 +1,11 @@
 #include "SkillsComponent.h"
+#include "SkillsTree.h"
+#include "SkillsWorldManager.h"
+#include "SkillProfileStore.h"
+#include "SkillsTreeStats.h"
+#include "Net/UnrealNetwork.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/Pawn.h"
 
 // Sets default values for this component's properties
 USkillsComponent::USkillsComponent()
@@ -8,65 +15,819 @@ USkillsComponent::USkillsComponent()
     bWantsBeginPlay = true;
     PrimaryComponentTick.bCanEverTick = true;
 
+    //We only tick to deliver change notifications, once everything else ran this frame
+    PrimaryComponentTick.bStartWithTickEnabled = false;
+    PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+    bPointsDirty = false;
+    bSkillsDirty = false;
+    bProfileSaved = false;
+
+    //The skill state is owned by the server
+    SetIsReplicated(true);
+
+    for (int32& Slot : SlotByType) Slot = INDEX_NONE;
 }
 
 // Called when the game starts
 void USkillsComponent::BeginPlay()
 {
+    SCOPE_CYCLE_COUNTER(STAT_SkillsComponentBeginPlay);
+
     Super::BeginPlay();
 
-    //Reseting the level of each skill
-    for (auto Skill : SkillsArray) Skill->GetDefaultObject<ASkill>()->ResetLevel();
+    //Caching everything we need from the skill classes so lookups don't have to touch them
+    RebuildSkillIndex();
+
+    //Reseting the level of each skill - clients get theirs from the server
+    if (HasSkillsAuthority()) SkillsState.Reset(SkillsArray.Num(), InitialAvailableSkillsPoints);
+
+    //We start with full mana and every charge
+    ManaAtTime = MaxMana;
+    ManaTime = GetCastTime();
 
-    AvailableSkillPoints = InitialAvailableSkillsPoints;
+    //Fill the projectile pool so the first shots don't have to spawn anything
+    SkillsManager = ASkillsWorldManager::Get(this);
+    if (ASkillsWorldManager* Manager = SkillsManager.Get())
+    {
+        for (auto Skill : SkillsArray) Manager->PrewarmSkillPool(Skill, PoolPrewarmCount);
+    }
+
+    //The owner may have been possessed before we began play
+    if (ProfileKey != 0) LoadSkillProfile();
+
+    //Only the local player looks at the skill panel - other pawns never draw their icons
+    const APawn* OwnerPawn = Cast<APawn>(GetOwner());
+    if (OwnerPawn && OwnerPawn->IsLocallyControlled()) RequestSkillIcons();
 }
 
+void USkillsComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    FlushSkillProfile();
+
+    ReleaseSkillIcons();
 
-UTexture* USkillsComponent::GetSkillTexture(int32 SkillNum)
+    if (ASkillsWorldManager* Manager = SkillsManager.Get())
+    {
+        for (auto Skill : StreamedFXClasses) Manager->ReleaseSkillFX(Skill);
+        if (ProfileHandle != INDEX_NONE) Manager->UnregisterSkillProfile(ProfileHandle);
+    }
+    ProfileHandle = INDEX_NONE;
+    StreamedFXClasses.Reset();
+
+    Super::EndPlay(EndPlayReason);
+}
+
+void USkillsComponent::RequestSkillIcons()
 {
-    if (SkillsArray.IsValidIndex(SkillNum))
+    ASkillsWorldManager* Manager = SkillsManager.Get();
+    if (!Manager) return;
+
+    ReleaseSkillIcons();
+    IconsHandle = Manager->RequestSkillIcons(SkillsArray, FStreamableDelegate::CreateUObject(this, &USkillsComponent::OnSkillIconsLoaded));
+}
+
+void USkillsComponent::ReleaseSkillIcons()
+{
+    if (IconsHandle.IsValid()) IconsHandle->ReleaseHandle();
+    IconsHandle.Reset();
+}
+
+void USkillsComponent::OnSkillIconsLoaded()
+{
+    //GetSkillTexture returns the textures now - every slot has to be redrawn
+    MarkSkillsDirty();
+}
+
+void USkillsComponent::BindSkillProfile(uint64 InProfileKey)
+{
+    ProfileKey = InProfileKey;
+    if (HasBegunPlay()) LoadSkillProfile();
+}
+
+void USkillsComponent::LoadSkillProfile()
+{
+    ASkillsWorldManager* Manager = SkillsManager.Get();
+    if (!Manager || ProfileKey == 0 || !HasSkillsAuthority()) return;
+
+    //The manager saves us if the world ends before we do
+    if (ProfileHandle == INDEX_NONE) ProfileHandle = Manager->RegisterSkillProfile(this);
+
+    FSkillProfileRecord Record;
+    if (Manager->LoadSkillProfile(ProfileKey, Record) && ImportSkillProfile(Record)) return;
+
+    //New players get their fresh tree saved with the next delivery
+    MarkPointsDirty();
+}
+
+void USkillsComponent::SaveSkillProfile()
+{
+    ASkillsWorldManager* Manager = SkillsManager.Get();
+    if (!Manager || ProfileKey == 0 || !HasSkillsAuthority()) return;
+
+    FSkillProfileRecord Record;
+    if (!ExportSkillProfile(Record)) return;
+
+    Manager->SaveSkillProfile(Record);
+    bProfileSaved = true;
+}
+
+void USkillsComponent::FlushSkillProfile()
+{
+    //Changes of this frame didn't get delivered yet
+    if (bPointsDirty || !bProfileSaved) SaveSkillProfile();
+}
+
+bool USkillsComponent::ExportSkillProfile(FSkillProfileRecord& OutRecord) const
+{
+    if (SkillsState.Levels.Num() > FSkillProfileRecord::MaxSlots || SkillsState.UnlockedNodes.Num() > FSkillProfileRecord::MaxNodeWords)
     {
-        return SkillsArray[SkillNum]->GetDefaultObject<ASkill>()->GetSkillTexture();
+        UE_LOG(LogSkillsTree, Warning, TEXT("%s has more skills than a profile record holds - its tree doesn't get saved"), *GetPathName());
+        return false;
     }
-    return nullptr;
+
+    OutRecord.Key = ProfileKey;
+    OutRecord.Schema = ProfileSchema;
+    OutRecord.AvailablePoints = SkillsState.AvailablePoints;
+    OutRecord.NumSlots = (uint16)SkillsState.Levels.Num();
+    OutRecord.NumNodeWords = (uint16)SkillsState.UnlockedNodes.Num();
+    FMemory::Memcpy(OutRecord.Levels, SkillsState.Levels.GetData(), SkillsState.Levels.Num());
+    FMemory::Memcpy(OutRecord.UnlockedNodes, SkillsState.UnlockedNodes.GetData(), SkillsState.UnlockedNodes.Num() * sizeof(uint64));
+    return true;
 }
 
-int32 USkillsComponent::GetSkillLevel(int32 SkillNum)
+bool USkillsComponent::ImportSkillProfile(const FSkillProfileRecord& Record)
 {
-    if (SkillsArray.IsValidIndex(SkillNum))
+    if (Record.Schema != ProfileSchema || Record.NumSlots != SkillsState.Levels.Num() || Record.NumNodeWords != SkillsState.UnlockedNodes.Num())
+    {
+        UE_LOG(LogSkillsTree, Warning, TEXT("The saved skill profile of %s belongs to other skills - starting over"), *GetPathName());
+        return false;
+    }
+
+    if (Record.AvailablePoints < 0)
     {
-        return SkillsArray[SkillNum]->GetDefaultObject<ASkill>()->GetLevel();
+        UE_LOG(LogSkillsTree, Warning, TEXT("The saved skill profile of %s has negative skill points - starting over"), *GetPathName());
+        return false;
     }
-    return 0;
+
+    //Same layout as our state - the levels only get clamped to what the slots allow today
+    for (int32 i = 0; i < Record.NumSlots; i++) SkillsState.Levels[i] = FMath::Min(Record.Levels[i], SkillSlots[i].MaxLevel);
+    SkillsState.AvailablePoints = Record.AvailablePoints;
+
+    //The saved bits may belong to nodes which moved since - the levels say what is learned
+    RebuildUnlockedNodes();
+
+    //The store has this tree already - the listeners get notified without saving it back
+    MarkSkillsDirty();
+    bProfileSaved = true;
+    return true;
 }
 
-ASkill* USkillsComponent::GetSkillByType(ESkillType SkillType)
+void USkillsComponent::UpdateStreamedFX()
 {
-    for (auto It : SkillsArray)
+    ASkillsWorldManager* Manager = SkillsManager.Get();
+    if (!Manager) return;
+
+    TArray<TSubclassOf<ASkill>, TInlineAllocator<16>> LearnedClasses;
+    for (int32 i = 0; i < SkillSlots.Num(); i++)
+    {
+        if (SkillsState.GetLevel(i) > 0 && SkillSlots[i].SkillClass) LearnedClasses.AddUnique(SkillSlots[i].SkillClass);
+    }
+
+    for (int32 i = StreamedFXClasses.Num() - 1; i >= 0; i--)
+    {
+        if (LearnedClasses.Contains(StreamedFXClasses[i])) continue;
+
+        Manager->ReleaseSkillFX(StreamedFXClasses[i]);
+        StreamedFXClasses.RemoveAtSwap(i, 1, false);
+    }
+
+    for (auto Skill : LearnedClasses)
     {
-        ASkill* Skill = It->GetDefaultObject<ASkill>();
-        if (Skill->GetSkillType() == SkillType) return Skill;
+        if (StreamedFXClasses.Contains(Skill)) continue;
+
+        Manager->AcquireSkillFX(Skill);
+        StreamedFXClasses.Add(Skill);
     }
-    return nullptr;
+}
+
+
+void USkillsComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+    Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+    //Other players see our levels through the volleys we fire - only the owner needs the whole tree
+    DOREPLIFETIME_CONDITION(USkillsComponent, SkillsState, COND_OwnerOnly);
+}
+
+void USkillsComponent::OnRep_SkillsState()
+{
+    RebuildUnlockedNodes();
+
+    //Only the slots which arrived need a redraw
+    if (SkillsState.ReceivedSlots.Num() != DirtySlots.Num()) MarkSkillsDirty();
+    for (TConstSetBitIterator<> It(SkillsState.ReceivedSlots); It; ++It) MarkSlotDirty(It.GetIndex());
+    MarkPointsDirty();
+
+    SkillsState.ReceivedSlots.Empty();
+}
+
+void USkillsComponent::RebuildUnlockedNodes()
+{
+    SkillsState.UnlockedNodes.SetNumZeroed(CompiledTree ? CompiledTree->GetNumWords() : 0);
+    FMemory::Memzero(SkillsState.UnlockedNodes.GetData(), SkillsState.UnlockedNodes.Num() * sizeof(uint64));
+
+    for (int32 i = 0; i < SkillSlots.Num(); i++)
+    {
+        if (SkillSlots[i].TreeNode != INDEX_NONE && SkillsState.GetLevel(i) > 0) FCompiledSkillTree::SetBit(SkillsState.UnlockedNodes.GetData(), SkillSlots[i].TreeNode);
+    }
+}
+
+void USkillsComponent::ServerAdvanceSkillLevel_Implementation(int32 SkillNum)
+{
+    AdvanceSkillLevelAtSlot(SkillNum);
+}
+
+bool USkillsComponent::ServerAdvanceSkillLevel_Validate(int32 SkillNum)
+{
+    //A well behaved client only sends the slots it has - anything else drops the connection
+    return SkillsArray.IsValidIndex(SkillNum);
+}
+
+void USkillsComponent::ServerRefundSkillSubtree_Implementation(int32 SkillNum)
+{
+    RefundSkillSubtree(SkillNum);
+}
+
+bool USkillsComponent::ServerRefundSkillSubtree_Validate(int32 SkillNum)
+{
+    return SkillsArray.IsValidIndex(SkillNum);
+}
+
+void USkillsComponent::ServerResetSkillPoints_Implementation()
+{
+    ResetSkillPoints();
+}
+
+bool USkillsComponent::ServerResetSkillPoints_Validate()
+{
+    return true;
+}
+
+void USkillsComponent::BeginDestroy()
+{
+    DEC_MEMORY_STAT_BY(STAT_SkillsSlotTablesMemory, GetSlotTablesAllocatedSize());
+
+    Super::BeginDestroy();
+}
+
+void USkillsComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+    Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+    DeliverSkillNotifications();
+}
+
+void USkillsComponent::DeliverSkillNotifications()
+{
+    //Every change marks the points - nothing to send otherwise
+    if (!bPointsDirty) return;
+
+    //Learned skills start streaming their FX so they're ready by the time they get fired
+    UpdateStreamedFX();
+
+    //Listeners may change the skills again - those changes go out next frame
+    const bool bSkillsChanged = bSkillsDirty;
+    Swap(DirtySlots, DeliveredSlots);
+
+    //The bits got cleared after the last delivery - only a new slot count allocates
+    if (DirtySlots.Num() != SkillsArray.Num()) DirtySlots.Init(false, SkillsArray.Num());
+    bSkillsDirty = false;
+    bPointsDirty = false;
+    SetComponentTickEnabled(false);
+
+    //One save per frame with changes - the store batches them further
+    if (ProfileKey != 0 && !bProfileSaved) SaveSkillProfile();
+
+    if (bSkillsChanged)
+    {
+        OnSkillsChanged.Broadcast();
+    }
+    else
+    {
+        for (TConstSetBitIterator<> It(DeliveredSlots); It; ++It)
+        {
+            OnSkillSlotChanged.Broadcast(It.GetIndex(), SkillsState.GetLevel(It.GetIndex()));
+        }
+    }
+
+    OnSkillPointsChanged.Broadcast(SkillsState.AvailablePoints);
+
+    //Cleared in place so the next delivery swaps it back in without allocating
+    FMemory::Memzero(DeliveredSlots.GetData(), FMath::DivideAndRoundUp(DeliveredSlots.Num(), NumBitsPerDWORD) * sizeof(uint32));
+}
+
+void USkillsComponent::MarkSlotDirty(int32 SkillNum)
+{
+    if (DirtySlots.IsValidIndex(SkillNum)) DirtySlots[SkillNum] = true;
+    MarkPointsDirty();
+}
+
+void USkillsComponent::MarkPointsDirty()
+{
+    bPointsDirty = true;
+    bProfileSaved = false;
+    if (!IsComponentTickEnabled()) SetComponentTickEnabled(true);
+}
+
+void USkillsComponent::MarkSkillsDirty()
+{
+    bSkillsDirty = true;
+    MarkPointsDirty();
+}
+
+#if WITH_EDITOR
+void USkillsComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+    Super::PostEditChangeProperty(PropertyChangedEvent);
+
+    //Edits inside an array element or struct report the inner property - the member is the one of this class
+    const FName MemberName = PropertyChangedEvent.MemberProperty ? PropertyChangedEvent.MemberProperty->GetFName() : PropertyChangedEvent.GetPropertyName();
+    if (MemberName == GET_MEMBER_NAME_CHECKED(USkillsComponent, SkillsArray) || MemberName == GET_MEMBER_NAME_CHECKED(USkillsComponent, SkillTree)) RebuildSkillIndex();
+}
+#endif
+
+void USkillsComponent::RebuildSkillIndex()
+{
+    SCOPE_CYCLE_COUNTER(STAT_SkillsRebuildIndex);
+    DEC_MEMORY_STAT_BY(STAT_SkillsSlotTablesMemory, GetSlotTablesAllocatedSize());
+
+    SkillSlots.Reset(SkillsArray.Num());
+    SlotByClass.Reset();
+    SlotById.Reset();
+    for (int32& Slot : SlotByType) Slot = INDEX_NONE;
+
+    CompiledTree = SkillTree ? &SkillTree->GetCompiledTree() : nullptr;
+    SlotByNode.Init(INDEX_NONE, CompiledTree ? CompiledTree->Num() : 0);
+    SpawnPatternTransforms.Reset();
+    SpawnPatternOffsets.Reset();
+    CastLimits.Reset();
+
+    for (int32 i = 0; i < SkillsArray.Num(); i++)
+    {
+        FSkillSlotInfo& Info = SkillSlots[SkillSlots.AddDefaulted()];
+        Info.CastLimitsOffset = CastLimits.Add(FSkillCastLimits::Unlearned());
+        if (!SkillsArray[i]) continue;
+
+        ASkill* Skill = SkillsArray[i]->GetDefaultObject<ASkill>();
+        Info.SkillClass = SkillsArray[i];
+        Info.DefaultSkill = Skill;
+        Info.Texture = Skill->GetSkillTextureAsset();
+        Info.SkillType = Skill->GetSkillType();
+        Info.MaxLevel = (uint8)FMath::Clamp(Skill->GetMaxLevel(), 0, 255);
+        Info.bOverrideMuzzleOffset = Skill->OverridesMuzzleOffset();
+        Info.MuzzleOffset = Skill->GetMuzzleOffset();
+        Info.SpreadJitter = Skill->GetSpreadJitter();
+        Info.InitialSpeed = Skill->GetInitialSpeed();
+
+        //The first match wins, just like the linear search did
+        int32& TypeSlot = SlotByType[(uint8)Info.SkillType];
+        if (TypeSlot == INDEX_NONE) TypeSlot = i;
+        if (!SlotByClass.Contains(Info.SkillClass)) SlotByClass.Add(Info.SkillClass, i);
+        if (!SlotById.Contains(Skill->GetSkillId())) SlotById.Add(Skill->GetSkillId(), i);
+
+        //The tree overrides the max level of the skill
+        const int32 TreeNode = CompiledTree ? CompiledTree->FindNodeBySkill(Info.SkillClass) : INDEX_NONE;
+        if (TreeNode != INDEX_NONE && SlotByNode[TreeNode] == INDEX_NONE)
+        {
+            Info.TreeNode = TreeNode;
+            Info.MaxLevel = (uint8)FMath::Clamp(CompiledTree->GetMaxLevel(TreeNode), 0, 255);
+            SlotByNode[TreeNode] = i;
+        }
+
+        //Precomputing the spawn pattern of every level so firing only has to compose transforms
+        Info.PatternOffset = SpawnPatternOffsets.Num();
+        for (int32 Level = 0; Level <= Info.MaxLevel; Level++)
+        {
+            SpawnPatternOffsets.Add(SpawnPatternTransforms.Num());
+            if (Level > 0) Skill->GetSpawnPattern(Level).AppendRelativeTransforms(SpawnPatternTransforms);
+        }
+        SpawnPatternOffsets.Add(SpawnPatternTransforms.Num());
+
+        //Same for the cooldown, charges and cost so cast checks are two loads and a compare
+        for (int32 Level = 1; Level <= Info.MaxLevel; Level++) CastLimits.Add(FSkillCastLimits(Skill->GetCastRules(Level)));
+    }
+
+    //Saved profiles are indexed like SkillsArray and the tree - other skills, max levels or tree nodes make them someone else's
+    ProfileSchema = CompiledTree ? (uint32)CompiledTree->Num() : 0;
+    for (int32 Node = 0; CompiledTree && Node < CompiledTree->Num(); Node++) ProfileSchema = FCrc::StrCrc32(*CompiledTree->GetNodeId(Node).ToString(), ProfileSchema);
+    for (int32 i = 0; i < SkillsArray.Num(); i++)
+    {
+        ProfileSchema = FCrc::StrCrc32(SkillsArray[i] ? *SkillsArray[i]->GetPathName() : TEXT("None"), ProfileSchema);
+        ProfileSchema = FCrc::MemCrc32(&SkillSlots[i].MaxLevel, sizeof(SkillSlots[i].MaxLevel), ProfileSchema);
+    }
+
+    //Keep the learned levels of the slots which still exist
+    SkillsState.Levels.SetNumZeroed(SkillsArray.Num());
+    ChargesFullTimes.SetNumZeroed(SkillsArray.Num());
+    RebuildUnlockedNodes();
+
+    //Levels only take as many bits on the wire as the highest max level needs
+    uint8 MaxLevel = 1;
+    for (const FSkillSlotInfo& Info : SkillSlots) MaxLevel = FMath::Max(MaxLevel, Info.MaxLevel);
+    SkillsState.LevelBits = (uint8)FMath::CeilLogTwo(MaxLevel + 1);
+
+    DirtySlots.Init(false, SkillsArray.Num());
+    MarkSkillsDirty();
+
+    INC_MEMORY_STAT_BY(STAT_SkillsSlotTablesMemory, GetSlotTablesAllocatedSize());
+}
+
+SIZE_T USkillsComponent::GetSlotTablesAllocatedSize() const
+{
+    return SkillSlots.GetAllocatedSize() + SlotByClass.GetAllocatedSize() + SlotById.GetAllocatedSize() + SpawnPatternTransforms.GetAllocatedSize() + SpawnPatternOffsets.GetAllocatedSize() + SlotByNode.GetAllocatedSize() + CastLimits.GetAllocatedSize() + ChargesFullTimes.GetAllocatedSize();
+}
+
+void USkillsComponent::SetSkills(const TArray<TSubclassOf<ASkill>>& NewSkills)
+{
+    SkillsArray = NewSkills;
+    RebuildSkillIndex();
+
+    //The icons of the old skills are no use to the panel
+    if (IconsHandle.IsValid()) RequestSkillIcons();
+    SkillsState.Reset(SkillsArray.Num(), InitialAvailableSkillsPoints);
+    FMemory::Memzero(ChargesFullTimes.GetData(), ChargesFullTimes.Num() * sizeof(float));
+}
+
+bool USkillsComponent::TryCastSkill(int32 SkillNum, float Time, float Tolerance)
+{
+    if (!CanCastSkill(SkillNum, Time + FMath::Max(Tolerance, 0.f)))
+    {
+        INC_DWORD_STAT(STAT_SkillsRejectedCasts);
+        return false;
+    }
+
+    //The spent charge comes back after the ones which are already recharging
+    const FSkillCastLimits& Limits = GetCastLimits(SkillNum);
+    ChargesFullTimes[SkillNum] = FMath::Max(ChargesFullTimes[SkillNum], Time) + Limits.Cooldown;
+
+    ManaAtTime = GetMana(Time) - Limits.ManaCost;
+    ManaTime = Time;
+    return true;
+}
+
+float USkillsComponent::GetCastTime() const
+{
+    const UWorld* World = GetWorld();
+    return World ? World->GetTimeSeconds() : 0.f;
+}
+
+float USkillsComponent::GetCurrentMana() const
+{
+    return GetMana(GetCastTime());
+}
+
+int32 USkillsComponent::GetSkillCharges(int32 SkillNum) const
+{
+    if (!SkillSlots.IsValidIndex(SkillNum)) return 0;
+
+    const FSkillCastLimits& Limits = GetCastLimits(SkillNum);
+    if (Limits.Cooldown <= 0.f) return Limits.Charges;
+
+    //Every started cooldown still missing is one charge less
+    const float Recharging = FMath::Max(ChargesFullTimes[SkillNum] - GetCastTime(), 0.f);
+    return FMath::Max(Limits.Charges - FMath::CeilToInt(Recharging / Limits.Cooldown), 0);
+}
+
+float USkillsComponent::GetSkillCooldownRemaining(int32 SkillNum) const
+{
+    if (!SkillSlots.IsValidIndex(SkillNum)) return 0.f;
+    return FMath::Max(ChargesFullTimes[SkillNum] - GetCastLimits(SkillNum).ChargeWindow - GetCastTime(), 0.f);
+}
+
+TArrayView<const FTransform> USkillsComponent::GetSpawnPattern(int32 SkillNum, int32 Level) const
+{
+    const FSkillSlotInfo* Info = GetSkillSlotInfo(SkillNum);
+    if (!Info || Info->PatternOffset == INDEX_NONE || Level <= 0 || Level > Info->MaxLevel) return TArrayView<const FTransform>();
+
+    const int32 Start = SpawnPatternOffsets[Info->PatternOffset + Level];
+    const int32 End = SpawnPatternOffsets[Info->PatternOffset + Level + 1];
+    return TArrayView<const FTransform>(SpawnPatternTransforms.GetData() + Start, End - Start);
+}
+
+/*What FVector_NetQuantize10 keeps of a component - tenths of a unit, at most 24 bits of them*/
+static float QuantizeNet10(float Value)
+{
+    const float MaxScaled = (float)(1 << 24);
+    return FMath::RoundToInt(FMath::Clamp(Value * 10.f, -MaxScaled, MaxScaled - 1.f)) / 10.f;
+}
+
+/*What FVector_NetQuantizeNormal keeps of a component - 16 bits over [-1, 1]*/
+static float QuantizeNetNormal(float Value)
+{
+    const int32 MaxScaled = 32767;
+    return FMath::RoundToInt(FMath::Clamp(Value, -1.f, 1.f) * MaxScaled) * (1.f / MaxScaled);
+}
+
+void USkillsComponent::QuantizeVolley(FSkillVolley& Volley)
+{
+    //Same rounding as the net serializers, without writing the values out and reading them back
+    Volley.Origin = FVector(QuantizeNet10(Volley.Origin.X), QuantizeNet10(Volley.Origin.Y), QuantizeNet10(Volley.Origin.Z));
+    Volley.Direction = FVector(QuantizeNetNormal(Volley.Direction.X), QuantizeNetNormal(Volley.Direction.Y), QuantizeNetNormal(Volley.Direction.Z));
+}
+
+static_assert(FSkillsState::MaxNetSlots <= MAX_uint16 + 1, "FSkillVolley::SkillNum must hold every slot a skills state replicates");
+
+FSkillVolley USkillsComponent::MakeVolley(int32 SkillNum, int32 Level, const FTransform& Origin) const
+{
+    FSkillVolley Volley;
+    Volley.SkillNum = (uint16)SkillNum;
+    Volley.Level = (uint8)FMath::Clamp(Level, 0, 255);
+    Volley.Origin = Origin.GetLocation();
+    Volley.Direction = Origin.GetRotation().GetForwardVector();
+    Volley.Seed = (uint16)FMath::Rand();
+
+    //Clients only get the quantized origin and direction - the shooter has to fire from the very same ones
+    QuantizeVolley(Volley);
+
+    const AGameStateBase* GameState = GetWorld()->GetGameState();
+    Volley.ServerTime = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+
+    return Volley;
+}
+
+void USkillsComponent::GetSpawnTransforms(const FSkillVolley& Volley, float CatchUpTime, FSkillSpawnTransforms& OutTransforms) const
+{
+    SCOPE_CYCLE_COUNTER(STAT_SkillsGetSpawnTransforms);
+
+    OutTransforms.Reset();
+
+    //The pattern is empty for level 0 - the skill is not learned so there is nothing to fire
+    const TArrayView<const FTransform> Pattern = GetSpawnPattern(Volley.SkillNum, Volley.Level);
+    const FSkillSlotInfo* Info = GetSkillSlotInfo(Volley.SkillNum);
+    if (Pattern.Num() == 0 || !Info) return;
+
+    const FTransform Origin(Volley.Direction.Rotation(), Volley.Origin);
+    FRandomStream Spread(Volley.Seed);
+
+    FCollisionQueryParams CatchUpParams(NAME_None, false, GetOwner());
+
+    for (const FTransform& RelativeTransform : Pattern)
+    {
+        FTransform SpawnTransform = RelativeTransform * Origin;
+
+        //Rolled in the same order everywhere so every client gets the server's spread
+        if (Info->SpreadJitter > 0.f)
+        {
+            const FRotator Jitter(Spread.FRandRange(-Info->SpreadJitter, Info->SpreadJitter), Spread.FRandRange(-Info->SpreadJitter, Info->SpreadJitter), 0.f);
+            SpawnTransform.SetRotation(SpawnTransform.GetRotation() * Jitter.Quaternion());
+        }
+
+        if (CatchUpTime > 0.f && Info->DefaultSkill)
+        {
+            //The server's projectile stopped at the first wall on the way - ours must not start behind it
+            const FVector Start = SpawnTransform.GetLocation();
+            const FVector End = Start + SpawnTransform.GetRotation().GetForwardVector() * Info->InitialSpeed * CatchUpTime;
+
+            FHitResult Hit;
+            const bool bBlocked = Info->DefaultSkill->SweepSkillInWorld(GetWorld(), Start, End, Info->DefaultSkill->GetCollisionRadius(), CatchUpParams, Hit);
+            SpawnTransform.SetTranslation(bBlocked ? Hit.Location : End);
+        }
+
+        OutTransforms.Add(SpawnTransform);
+    }
+}
+
+float USkillsComponent::GetVolleyCatchUpTime(const FSkillVolley& Volley, float MaxCatchUp) const
+{
+    //Clients get the volley late - the projectiles start where the server ones are by now
+    const AGameStateBase* GameState = GetWorld()->GetGameState();
+    if (HasSkillsAuthority() || !GameState) return 0.f;
+
+    return FMath::Clamp(GameState->GetServerWorldTimeSeconds() - Volley.ServerTime, 0.f, MaxCatchUp);
+}
+
+void USkillsComponent::FireVolley(const FSkillVolley& Volley, float CatchUpTime, bool bCosmetic, FPredictedSkillVolley* Prediction, float LagCompensationTime)
+{
+    if (!SkillsArray.IsValidIndex(Volley.SkillNum)) return;
+
+    TSubclassOf<ASkill> SkillBP = SkillsArray[Volley.SkillNum];
+
+    ASkillsWorldManager* Manager = SkillsManager.Get();
+    if (!SkillBP || !Manager) return;
+
+    FSkillSpawnTransforms SpawnTransforms;
+    GetSpawnTransforms(Volley, CatchUpTime, SpawnTransforms);
+    if (SpawnTransforms.Num() == 0) return;
+
+    //Only volleys which spawn something count as shots
+    Manager->PrefetchSkillFX(SkillBP);
+    INC_DWORD_STAT(STAT_SkillsShots);
+
+    AActor* SkillOwner = GetOwner();
+    APawn* SkillInstigator = Cast<APawn>(SkillOwner);
+
+    for (int32 i = 0; i < SpawnTransforms.Num(); i++)
+    {
+        //Skills are handed out by the world's pool instead of being spawned on every shot
+        ASkill* Skill = Manager->AcquireSkill(SkillBP, SpawnTransforms[i], SkillOwner, SkillInstigator);
+        if (!Skill) continue;
+
+        Skill->SetLevel(Volley.Level);
+        Skill->SetCosmetic(bCosmetic);
+        if (LagCompensationTime > 0.f) Skill->StartLagCompensation(LagCompensationTime);
+
+        if (Prediction)
+        {
+            Skill->SetPredictionKey(Volley.PredictionKey);
+            Prediction->Skills.Add(Skill);
+        }
+    }
+}
+
+UTexture* USkillsComponent::GetSkillTexture(int32 SkillNum)
+{
+    return SkillSlots.IsValidIndex(SkillNum) ? SkillSlots[SkillNum].Texture.Get() : nullptr;
+}
+
+int32 USkillsComponent::GetSkillLevel(int32 SkillNum)
+{
+    return SkillsState.GetLevel(SkillNum);
+}
+
+ASkill* USkillsComponent::GetSkillByType(ESkillType SkillType)
+{
+    SCOPE_CYCLE_COUNTER(STAT_SkillsLookup);
+
+    const int32 SkillNum = GetSkillSlotByType(SkillType);
+    return (SkillNum != INDEX_NONE) ? SkillSlots[SkillNum].DefaultSkill : nullptr;
+}
+
+int32 USkillsComponent::GetSkillSlot(const ASkill* Skill) const
+{
+    SCOPE_CYCLE_COUNTER(STAT_SkillsLookup);
+
+    const int32* SkillNum = Skill ? SlotByClass.Find(Skill->GetClass()) : nullptr;
+    return SkillNum ? *SkillNum : INDEX_NONE;
+}
+
+int32 USkillsComponent::GetSkillSlotById(FName SkillId) const
+{
+    SCOPE_CYCLE_COUNTER(STAT_SkillsLookup);
+
+    const int32* SkillNum = SlotById.Find(SkillId);
+    return SkillNum ? *SkillNum : INDEX_NONE;
 }
 
 int32 USkillsComponent::AdvanceSkillLevel(ASkill* SkillToLevelUp)
 {
-    if (SkillToLevelUp && AvailableSkillPoints > 0 && !SkillToLevelUp->IsMaxLevel())
+    return AdvanceSkillLevelAtSlot(GetSkillSlot(SkillToLevelUp));
+}
+
+int32 USkillsComponent::GetNextLevelCost(int32 SkillNum) const
+{
+    if (!SkillsState.Levels.IsValidIndex(SkillNum) || !SkillSlots.IsValidIndex(SkillNum)) return INDEX_NONE;
+
+    const int32 Level = SkillsState.Levels[SkillNum];
+    const FSkillSlotInfo& Info = SkillSlots[SkillNum];
+    if (Level >= Info.MaxLevel) return INDEX_NONE;
+
+    //Skills outside of a tree cost one point per level
+    if (Info.TreeNode == INDEX_NONE) return 1;
+
+    //Prerequisites and branches only gate the first level
+    if (Level == 0 && !CompiledTree->CanLearn(Info.TreeNode, SkillsState.UnlockedNodes.GetData())) return INDEX_NONE;
+
+    return CompiledTree->GetLevelCost(Info.TreeNode, Level + 1);
+}
+
+int32 USkillsComponent::AdvanceSkillLevelAtSlot(int32 SkillNum)
+{
+    SCOPE_CYCLE_COUNTER(STAT_SkillsLevelUp);
+
+    //Unknown skills resolve to INDEX_NONE, which the server would reject by dropping the connection
+    if (!SkillsArray.IsValidIndex(SkillNum)) return 0;
+
+    //The server decides - our level changes once the new state replicates
+    if (!HasSkillsAuthority())
+    {
+        ServerAdvanceSkillLevel(SkillNum);
+        return SkillsState.GetLevel(SkillNum);
+    }
+
+    const int32 Cost = GetNextLevelCost(SkillNum);
+    if (Cost == INDEX_NONE || Cost > SkillsState.AvailablePoints) return SkillsState.GetLevel(SkillNum);
+
+    SkillsState.AvailablePoints -= Cost;
+
+    const int32 TreeNode = SkillSlots[SkillNum].TreeNode;
+    if (TreeNode != INDEX_NONE) FCompiledSkillTree::SetBit(SkillsState.UnlockedNodes.GetData(), TreeNode);
+
+    MarkSlotDirty(SkillNum);
+    return ++SkillsState.Levels[SkillNum];
+}
+
+bool USkillsComponent::CanLearnSkill(int32 SkillNum) const
+{
+    const int32 Cost = GetNextLevelCost(SkillNum);
+    return Cost != INDEX_NONE && Cost <= SkillsState.AvailablePoints;
+}
+
+void USkillsComponent::GetUnlockableSkills(TArray<int32>& OutSkillNums) const
+{
+    OutSkillNums.Reset();
+
+    for (int32 i = 0; i < SkillSlots.Num(); i++)
+    {
+        //Tree nodes are collected from the bitmask below
+        if (SkillSlots[i].TreeNode == INDEX_NONE && SkillsState.Levels[i] == 0 && SkillSlots[i].MaxLevel > 0) OutSkillNums.Add(i);
+    }
+
+    if (!CompiledTree) return;
+
+    TArray<uint64, TInlineAllocator<16>> Unlockable;
+    Unlockable.SetNumUninitialized(CompiledTree->GetNumWords());
+    CompiledTree->GetUnlockable(SkillsState.UnlockedNodes.GetData(), Unlockable.GetData());
+
+    for (int32 Word = 0; Word < Unlockable.Num(); Word++)
+    {
+        for (uint64 Bits = Unlockable[Word]; Bits; Bits &= Bits - 1)
+        {
+            const int32 Node = Word * 64 + (int32)FMath::CountTrailingZeros64(Bits);
+            if (SlotByNode[Node] != INDEX_NONE) OutSkillNums.Add(SlotByNode[Node]);
+        }
+    }
+}
+
+int32 USkillsComponent::RefundSkillSubtree(int32 SkillNum)
+{
+    SCOPE_CYCLE_COUNTER(STAT_SkillsResetPoints);
+
+    if (!SkillsState.Levels.IsValidIndex(SkillNum) || !SkillSlots.IsValidIndex(SkillNum)) return 0;
+
+    if (!HasSkillsAuthority())
+    {
+        ServerRefundSkillSubtree(SkillNum);
+        return 0;
+    }
+
+    int32 Refunded = 0;
+    const int32 TreeNode = SkillSlots[SkillNum].TreeNode;
+
+    if (TreeNode == INDEX_NONE)
     {
-        AvailableSkillPoints--;
-        SkillToLevelUp->AdvanceLevel();
-        return SkillToLevelUp->GetLevel();
+        //Unlearned slots have nothing to refund - no notification, no profile save
+        if (SkillsState.Levels[SkillNum] == 0) return 0;
+
+        Refunded = SkillsState.Levels[SkillNum];
+        SkillsState.Levels[SkillNum] = 0;
+        MarkSlotDirty(SkillNum);
     }
-    else if (SkillToLevelUp) return SkillToLevelUp->GetLevel();
-    else return 0;
+    else
+    {
+        TArray<uint64, TInlineAllocator<16>> RefundMask;
+        RefundMask.SetNumUninitialized(CompiledTree->GetNumWords());
+        CompiledTree->GetRefundMask(TreeNode, SkillsState.UnlockedNodes.GetData(), RefundMask.GetData());
+
+        for (int32 Word = 0; Word < RefundMask.Num(); Word++)
+        {
+            SkillsState.UnlockedNodes[Word] &= ~RefundMask[Word];
+
+            for (uint64 Bits = RefundMask[Word]; Bits; Bits &= Bits - 1)
+            {
+                const int32 Node = Word * 64 + (int32)FMath::CountTrailingZeros64(Bits);
+                const int32 NodeSlot = SlotByNode[Node];
+                if (NodeSlot == INDEX_NONE || SkillsState.Levels[NodeSlot] == 0) continue;
+
+                Refunded += CompiledTree->GetTotalCost(Node, SkillsState.Levels[NodeSlot]);
+                SkillsState.Levels[NodeSlot] = 0;
+                MarkSlotDirty(NodeSlot);
+            }
+        }
+    }
+
+    if (Refunded == 0) return 0;
+
+    SkillsState.AvailablePoints += Refunded;
+    MarkPointsDirty();
+    return Refunded;
 }
 
 void USkillsComponent::ResetSkillPoints()
 {
-    AvailableSkillPoints = InitialAvailableSkillsPoints;
-    for (auto It : SkillsArray)
+    SCOPE_CYCLE_COUNTER(STAT_SkillsResetPoints);
+
+    if (!HasSkillsAuthority())
     {
-        It->GetDefaultObject<ASkill>()->ResetLevel();
+        ServerResetSkillPoints();
+        return;
     }
+
+    //Only the learned slots change
+    for (int32 i = 0; i < SkillsState.Levels.Num(); i++)
+    {
+        if (SkillsState.Levels[i] != 0) MarkSlotDirty(i);
+    }
+    MarkPointsDirty();
+
+    SkillsState.Reset(SkillsArray.Num(), InitialAvailableSkillsPoints);
 }
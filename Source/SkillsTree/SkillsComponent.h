@@ -4,15 +4,79 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "Engine/StreamableManager.h"
 #include "Skill.h"
+#include "SkillsState.h"
+#include "SkillCastRules.h"
+#include "SkillVolley.h"
+#include "SkillTreeAsset.h"
 #include "SkillsComponent.generated.h"
 
 
+/*Everything the hot paths need to know about a skill slot - cached so lookups never touch the skill classes*/
+USTRUCT()
+struct FSkillSlotInfo
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TSubclassOf<ASkill> SkillClass;
+
+	/*The default object of SkillClass - returned by GetSkillByType*/
+	UPROPERTY()
+	ASkill* DefaultSkill = nullptr;
+
+	UPROPERTY()
+	TAssetPtr<UTexture> Texture;
+
+	ESkillType SkillType = ESkillType::WaterBall;
+
+	uint8 MaxLevel = 0;
+
+	/*The compiled node of the skill in the owner's skill tree - INDEX_NONE if the skill is not part of the tree*/
+	int32 TreeNode = INDEX_NONE;
+
+	/*True when the skill spawns at its own muzzle offset*/
+	bool bOverrideMuzzleOffset = false;
+
+	/*The skill's muzzle offset relative to the firing character*/
+	FTransform MuzzleOffset;
+
+	/*The random spread of each projectile in degrees*/
+	float SpreadJitter = 0.f;
+
+	/*The speed the skill gets fired with*/
+	float InitialSpeed = 0.f;
+
+	/*Where the level 0 entry of the skill starts in the owner's spawn pattern offsets - INDEX_NONE for empty slots*/
+	int32 PatternOffset = INDEX_NONE;
+
+	/*Where the level 0 entry of the skill starts in the owner's cast limits*/
+	int32 CastLimitsOffset = INDEX_NONE;
+};
+
+/*Called at most once per frame for every slot whose level changed*/
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnSkillSlotChanged, int32, SkillNum, int32, NewLevel);
+
+/*Called at most once per frame when the available skill points changed*/
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnSkillPointsChanged, int32, AvailablePoints);
+
+/*Called at most once per frame when SkillsArray got replaced - every slot should be redrawn*/
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnSkillsChanged);
+
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class SKILLSTREE_API USkillsComponent : public UActorComponent
 {
 	GENERATED_BODY()
 
+    friend class ASkillsWorldManager;
+
+    /*The cast limit tests set levels and limits without skill assets*/
+    friend class FSkillsTreeCastLimitsTest;
+
+    /*The benchmark scenarios give their skills a points budget*/
+    friend class USkillsTreeBenchmarkCommandlet;
+
 public:
     // Sets default values for this component's properties
     USkillsComponent();
@@ -20,31 +84,295 @@ public:
     // Called when the game starts
     virtual void BeginPlay() override;
 
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+    virtual void BeginDestroy() override;
+
+    virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+    // Delivers the change notifications of this frame - only ticks while something is dirty
+    virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+#if WITH_EDITOR
+    virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
     /*An array which contains all the available skills*/
     UPROPERTY(EditAnywhere)
     TArray<TSubclassOf<ASkill>> SkillsArray;
 
-    /*Returns the texture of the given skill's index (searches SkillsArray)*/
+    /*Returns the texture of the given skill's index - null until the icons streamed in (see RequestSkillIcons)*/
     UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
     UTexture* GetSkillTexture(int32 SkillNum);
 
+    /*Returns the level of the given skill's index - 0 means that the skill is not learned*/
     UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
     int32 GetSkillLevel(int32 SkillNum);
 
     /*Returns the first matching skill from SkillsArray*/
     UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
     ASkill* GetSkillByType(ESkillType SkillType);
-    
+
+    /*Returns the index of the given skill in SkillsArray - INDEX_NONE if the skill is not in the array*/
+    int32 GetSkillSlot(const ASkill* Skill) const;
+
+    /*Returns the index of the first skill of the given type - INDEX_NONE if there is none*/
+    FORCEINLINE int32 GetSkillSlotByType(ESkillType SkillType) const { return (SkillType < ESkillType::MAX) ? SlotByType[(uint8)SkillType] : INDEX_NONE; }
+
+    /*Returns the index of the skill with the given id (see ASkill::GetSkillId) - INDEX_NONE if there is none*/
+    int32 GetSkillSlotById(FName SkillId) const;
+
+    /*Returns the cached info of the given skill's index*/
+    const FSkillSlotInfo* GetSkillSlotInfo(int32 SkillNum) const { return SkillSlots.IsValidIndex(SkillNum) ? &SkillSlots[SkillNum] : nullptr; }
+
+    /*Returns the precomputed spawn transforms (relative to the muzzle) of the given skill's index and level*/
+    TArrayView<const FTransform> GetSpawnPattern(int32 SkillNum, int32 Level) const;
+
+    /*Returns the volley the given skill's index fires from Origin - already quantized like it goes over the wire*/
+    FSkillVolley MakeVolley(int32 SkillNum, int32 Level, const FTransform& Origin) const;
+
+    /*Rounds the origin and direction of the volley to what its net serialization keeps*/
+    static void QuantizeVolley(FSkillVolley& Volley);
+
+    /*Fills OutTransforms with the world transforms of the projectiles of the given volley, CatchUpTime seconds into their flight*/
+    void GetSpawnTransforms(const FSkillVolley& Volley, float CatchUpTime, FSkillSpawnTransforms& OutTransforms) const;
+
+    /*Returns how long the server's projectiles of the given volley are flying already, up to MaxCatchUp seconds*/
+    float GetVolleyCatchUpTime(const FSkillVolley& Volley, float MaxCatchUp) const;
+
+    /*Spawns the projectiles of a volley from the world's pool, owned by our owner - cosmetic volleys never apply damage.
+    Predicted volleys get their projectiles tagged and collected. Projectiles with a LagCompensationTime get their hits
+    checked against where the shooter saw its targets*/
+    void FireVolley(const FSkillVolley& Volley, float CatchUpTime, bool bCosmetic, FPredictedSkillVolley* Prediction = nullptr, float LagCompensationTime = 0.f);
+
+    /*Returns true if the given skill's index is learned, has a charge left and we have the mana for it at Time (world seconds)*/
+    FORCEINLINE bool CanCastSkill(int32 SkillNum, float Time) const
+    {
+        if (!SkillSlots.IsValidIndex(SkillNum)) return false;
+
+        //Both checks always run - no branch to mispredict for casters which poll readiness every frame
+        const FSkillCastLimits& Limits = GetCastLimits(SkillNum);
+        const bool bHasCharge = Time >= ChargesFullTimes[SkillNum] - Limits.ChargeWindow;
+        const bool bHasMana = GetMana(Time) >= Limits.ManaCost;
+        return bHasCharge & bHasMana;
+    }
+
+    /*Spends a charge and the mana of the given skill's index at Time if it can be cast at Time + Tolerance - returns false otherwise.
+    The tolerance only widens the check, so casts accepted early don't push the next cooldown or the mana regeneration back*/
+    bool TryCastSkill(int32 SkillNum, float Time, float Tolerance = 0.f);
+
+    /*Returns the mana at Time (world seconds) - mana regenerates lazily, nothing ticks for it*/
+    FORCEINLINE float GetMana(float Time) const { return FMath::Min(ManaAtTime + (Time - ManaTime) * ManaRegenRate, MaxMana); }
+
+    /*Returns the current mana*/
+    UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
+    float GetCurrentMana() const;
+
+    /*Returns the charges the given skill's index has right now - 0 for unlearned skills*/
+    UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
+    int32 GetSkillCharges(int32 SkillNum) const;
+
+    /*Returns the seconds until the given skill's index has a charge again - 0 if it has one*/
+    UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
+    float GetSkillCooldownRemaining(int32 SkillNum) const;
+
+    /*Replaces the available skills - unlearns everything and rebuilds the lookup tables*/
+    UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
+    void SetSkills(const TArray<TSubclassOf<ASkill>>& NewSkills);
+
+    /*Rebuilds the lookup tables from SkillsArray - call this after modifying SkillsArray directly*/
+    void RebuildSkillIndex();
+
+    /*Returns the skill tree of the skills - null when SkillsArray has no tree*/
+    USkillTreeAsset* GetSkillTree() const { return SkillTree; }
+
+    /*Returns the skill points which can still be spent*/
+    UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
+    int32 GetAvailableSkillPoints() const { return SkillsState.AvailablePoints; }
+
+    /*Widgets bind here instead of polling GetSkillLevel - changes of a frame get coalesced*/
+    UPROPERTY(BlueprintAssignable, Category = TLSkillsTree)
+    FOnSkillSlotChanged OnSkillSlotChanged;
+
+    /*Widgets bind here instead of polling GetAvailableSkillPoints*/
+    UPROPERTY(BlueprintAssignable, Category = TLSkillsTree)
+    FOnSkillPointsChanged OnSkillPointsChanged;
+
+    /*Widgets bind here to rebuild their slots when SkillsArray changes*/
+    UPROPERTY(BlueprintAssignable, Category = TLSkillsTree)
+    FOnSkillsChanged OnSkillsChanged;
+
+    /*Sends the pending change notifications right away instead of at the end of the frame*/
+    void DeliverSkillNotifications();
+
+    /*Streams in the textures of every skill - locally controlled owners request them on BeginPlay and when they get possessed.
+    OnSkillsChanged fires once they're loaded*/
+    UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
+    void RequestSkillIcons();
+
+    /*Lets the textures go - call it when the skill panel closes*/
+    UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
+    void ReleaseSkillIcons();
+
+    /*Loads the saved tree of the given player (see FSkillProfileStore::MakeKey) and saves every change from now on - server only*/
+    void BindSkillProfile(uint64 InProfileKey);
+
+    /*Copies the learned levels, points and tree nodes to OutRecord - false if they don't fit in a record*/
+    bool ExportSkillProfile(struct FSkillProfileRecord& OutRecord) const;
+
+    /*Replaces the learned levels, points and tree nodes - false if the record was saved for other skills*/
+    bool ImportSkillProfile(const struct FSkillProfileRecord& Record);
+
 private:
-    /*The Available Skill Points which can be spent in total*/
-    int32 AvailableSkillPoints;
+    /*The learned levels and the available skill points of this character - owned by the server, replicated to the owning client*/
+    UPROPERTY(ReplicatedUsing = OnRep_SkillsState)
+    FSkillsState SkillsState;
+
+    UFUNCTION()
+    void OnRep_SkillsState();
+
+    /*True unless we are the client copy of a replicated owner - components without owner own their state*/
+    bool HasSkillsAuthority() const { return !GetOwner() || GetOwner()->HasAuthority(); }
+
+    /*Sets the unlocked tree nodes from the learned levels*/
+    void RebuildUnlockedNodes();
+
+    UFUNCTION(Server, Reliable, WithValidation)
+    void ServerAdvanceSkillLevel(int32 SkillNum);
+
+    UFUNCTION(Server, Reliable, WithValidation)
+    void ServerRefundSkillSubtree(int32 SkillNum);
+
+    UFUNCTION(Server, Reliable, WithValidation)
+    void ServerResetSkillPoints();
+
+    /*Cached info of each skill, indexed like SkillsArray*/
+    UPROPERTY(Transient)
+    TArray<FSkillSlotInfo> SkillSlots;
+
+    /*The first slot of each skill type*/
+    int32 SlotByType[(uint8)ESkillType::MAX];
+
+    /*The slot of each skill class*/
+    TMap<const UClass*, int32> SlotByClass;
+
+    /*The slot of each skill id*/
+    TMap<FName, int32> SlotById;
+
+    /*The relative spawn transforms of every level of every slot*/
+    TArray<FTransform> SpawnPatternTransforms;
+
+    /*Where each level of each slot starts in SpawnPatternTransforms - every slot has MaxLevel + 2 entries*/
+    TArray<int32> SpawnPatternOffsets;
+
+    /*The cooldown, charges and cost of every level of every slot - every slot has MaxLevel + 1 entries*/
+    TArray<FSkillCastLimits> CastLimits;
+
+    /*The time each slot has all its charges back - the charges in between get derived from it*/
+    TArray<float> ChargesFullTimes;
+
+    /*The mana at ManaTime - only written by casts*/
+    float ManaAtTime = 0.f;
+
+    float ManaTime = 0.f;
+
+    /*Returns the cast limits of the current level of the given slot - the slot has to be valid*/
+    FORCEINLINE const FSkillCastLimits& GetCastLimits(int32 SkillNum) const
+    {
+        const FSkillSlotInfo& Info = SkillSlots[SkillNum];
+        return CastLimits[Info.CastLimitsOffset + FMath::Min<int32>(SkillsState.GetLevel(SkillNum), Info.MaxLevel)];
+    }
+
+    /*Returns the world time the cast limits get evaluated at*/
+    float GetCastTime() const;
+
+    /*The compiled skill tree - null when there is no skill tree*/
+    const FCompiledSkillTree* CompiledTree = nullptr;
+
+    /*The slot of each compiled tree node - INDEX_NONE for nodes without a slot*/
+    TArray<int32> SlotByNode;
+
+    /*One bit per slot whose level changed since the last delivery*/
+    TBitArray<> DirtySlots;
+
+    /*The dirty slots of the delivery in progress - swapped with DirtySlots so listeners can mark slots for the next one*/
+    TBitArray<> DeliveredSlots;
+
+    uint8 bPointsDirty : 1;
+
+    uint8 bSkillsDirty : 1;
+
+    /*True while the tree is the one the profile store has - set by saves and imports, cleared by the next change*/
+    uint8 bProfileSaved : 1;
+
+    /*Queues the notification of the given slot (and the points) for the end of the frame*/
+    void MarkSlotDirty(int32 SkillNum);
+
+    /*Queues the points notification for the end of the frame*/
+    void MarkPointsDirty();
+
+    /*Queues a full refresh for the end of the frame*/
+    void MarkSkillsDirty();
+
+    /*The manager which streams our assets*/
+    TWeakObjectPtr<class ASkillsWorldManager> SkillsManager;
+
+    /*Keeps the requested icons loaded*/
+    TSharedPtr<FStreamableHandle> IconsHandle;
+
+    /*The skills whose FX we hold a reference to - the learned ones*/
+    TArray<TSubclassOf<ASkill>> StreamedFXClasses;
+
+    /*Requests the FX of newly learned skills and releases the ones of unlearned skills*/
+    void UpdateStreamedFX();
+
+    void OnSkillIconsLoaded();
+
+    /*Returns the memory used by the lookup tables and spawn patterns*/
+    SIZE_T GetSlotTablesAllocatedSize() const;
+
+    /*The saved profile this tree belongs to - 0 when the tree is not saved*/
+    uint64 ProfileKey = 0;
+
+    /*Hash of the skills in SkillsArray - profiles saved for other skills don't get loaded*/
+    uint32 ProfileSchema = 0;
+
+    /*Handle in the world's profile components - INDEX_NONE when the tree is not saved*/
+    int32 ProfileHandle = INDEX_NONE;
+
+    /*Applies the saved profile of ProfileKey if there is one*/
+    void LoadSkillProfile();
+
+    /*Queues the tree for the world's profile store*/
+    void SaveSkillProfile();
+
+    /*Queues the tree for the world's profile store if it changed since the last save*/
+    void FlushSkillProfile();
+
+    /*Returns the point cost of the next level of the given slot - INDEX_NONE if the slot can't be leveled up right now*/
+    int32 GetNextLevelCost(int32 SkillNum) const;
 
 public:
 
-    /*Returns the new level of the skill*/
+    /*Returns the new level of the skill - clients ask the server and get the current level back*/
     UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
     int32 AdvanceSkillLevel(ASkill* SkillToLevelUp);
 
+    /*Same as AdvanceSkillLevel but for the skill of the given index - returns the new level*/
+    int32 AdvanceSkillLevelAtSlot(int32 SkillNum);
+
+    /*Returns true if the given skill's index can be leveled up right now (points, max level, prerequisites and branches)*/
+    UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
+    bool CanLearnSkill(int32 SkillNum) const;
+
+    /*Fills OutSkillNums with the indices of the skills which are not learned yet but could be learned now*/
+    UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
+    void GetUnlockableSkills(TArray<int32>& OutSkillNums) const;
+
+    /*Unlearns the given skill's index and every learned skill which depends on it - returns the refunded points*/
+    UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
+    int32 RefundSkillSubtree(int32 SkillNum);
+
     /*Resets the skill points and unlearns all the skills*/
     UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
     void ResetSkillPoints();
@@ -55,4 +383,20 @@ protected:
     UPROPERTY(EditDefaultsOnly)
     int32 InitialAvailableSkillsPoints;
 
+    /*Optional skill tree - adds level costs, prerequisites and exclusive branches to the skills of SkillsArray*/
+    UPROPERTY(EditDefaultsOnly)
+    USkillTreeAsset* SkillTree;
+
+    /*The amount of projectiles of each skill that get spawned in the world's pool on BeginPlay*/
+    UPROPERTY(EditDefaultsOnly)
+    int32 PoolPrewarmCount = 6;
+
+    /*The mana when starting the game and the most mana we can have*/
+    UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "0"))
+    float MaxMana = 100.f;
+
+    /*Mana regenerated per second*/
+    UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "0"))
+    float ManaRegenRate = 10.f;
+
 };
\ No newline at end of file
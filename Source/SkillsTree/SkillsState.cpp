@@ -0,0 +1,175 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillsState.h"
+
+/*What a connection acknowledged last - the base of the next delta*/
+class FSkillsStateDeltaBase : public INetDeltaBaseState
+{
+public:
+    FSkillsStateDeltaBase(const TArray<uint8>& InLevels, int32 InAvailablePoints) : Levels(InLevels), AvailablePoints(InAvailablePoints) {}
+
+    virtual bool IsStateEqual(INetDeltaBaseState* OtherState) override
+    {
+        const FSkillsStateDeltaBase* Other = static_cast<const FSkillsStateDeltaBase*>(OtherState);
+        return Other && Other->AvailablePoints == AvailablePoints && Other->Levels == Levels;
+    }
+
+    TArray<uint8> Levels;
+
+    int32 AvailablePoints;
+};
+
+bool FSkillsState::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+    if (DeltaParms.Writer)
+    {
+        FBitWriter& Writer = *DeltaParms.Writer;
+        const FSkillsStateDeltaBase* OldState = static_cast<const FSkillsStateDeltaBase*>(DeltaParms.OldState);
+
+        //Nothing acknowledged yet (or the slots changed) - everything goes out
+        const bool bFull = !OldState || OldState->Levels.Num() != Levels.Num();
+        const bool bPointsChanged = bFull || OldState->AvailablePoints != AvailablePoints;
+
+        TArray<int32, TInlineAllocator<64>> DirtySlots;
+        if (!bFull)
+        {
+            for (int32 i = 0; i < Levels.Num(); i++)
+            {
+                if (Levels[i] != OldState->Levels[i]) DirtySlots.Add(i);
+            }
+            if (DirtySlots.Num() == 0 && !bPointsChanged) return false;
+        }
+
+        *DeltaParms.NewState = MakeShareable(new FSkillsStateDeltaBase(Levels, AvailablePoints));
+
+        const uint32 MaxLevelValue = 1u << FMath::Clamp<uint32>(LevelBits, 1, 8);
+        Writer.WriteBit(bFull);
+        uint32 LevelBitsValue = FMath::Clamp<uint32>(LevelBits, 1, 8) - 1;
+        Writer.SerializeInt(LevelBitsValue, 8);
+
+        //Deltas carry the slot count as well so a client whose slots differ notices instead of misreading the indices
+        uint32 NumSlots = Levels.Num();
+        Writer.SerializeIntPacked(NumSlots);
+
+        if (bFull)
+        {
+            for (uint8 Level : Levels)
+            {
+                uint32 LevelValue = FMath::Min<uint32>(Level, MaxLevelValue - 1);
+                Writer.SerializeInt(LevelValue, MaxLevelValue);
+            }
+        }
+        else
+        {
+            //A list of indices is cheaper than a mask when only a few slots changed
+            const uint32 IndexBits = FMath::CeilLogTwo(Levels.Num());
+            const bool bSparse = DirtySlots.Num() * IndexBits < (uint32)Levels.Num();
+            Writer.WriteBit(bSparse);
+
+            if (bSparse)
+            {
+                uint32 NumDirty = DirtySlots.Num();
+                Writer.SerializeIntPacked(NumDirty);
+                for (int32 Slot : DirtySlots)
+                {
+                    uint32 SlotValue = Slot;
+                    uint32 LevelValue = FMath::Min<uint32>(Levels[Slot], MaxLevelValue - 1);
+                    Writer.SerializeInt(SlotValue, Levels.Num());
+                    Writer.SerializeInt(LevelValue, MaxLevelValue);
+                }
+            }
+            else
+            {
+                for (int32 i = 0; i < Levels.Num(); i++)
+                {
+                    const bool bDirty = Levels[i] != OldState->Levels[i];
+                    Writer.WriteBit(bDirty);
+                    if (!bDirty) continue;
+
+                    uint32 LevelValue = FMath::Min<uint32>(Levels[i], MaxLevelValue - 1);
+                    Writer.SerializeInt(LevelValue, MaxLevelValue);
+                }
+            }
+        }
+
+        Writer.WriteBit(bPointsChanged);
+        if (bPointsChanged)
+        {
+            uint32 Points = FMath::Max(AvailablePoints, 0);
+            Writer.SerializeIntPacked(Points);
+        }
+
+        return !Writer.IsError();
+    }
+
+    if (DeltaParms.Reader)
+    {
+        FBitReader& Reader = *DeltaParms.Reader;
+
+        const bool bFull = Reader.ReadBit() != 0;
+        const uint32 MaxLevelValue = 1u << (Reader.ReadInt(8) + 1);
+
+        uint32 NumSlots = 0;
+        Reader.SerializeIntPacked(NumSlots);
+
+        //A full state sets the slot count - the server's SetSkills may have changed it. Deltas are relative to the count the client has
+        if (Reader.IsError() || NumSlots > MaxNetSlots || (!bFull && NumSlots != (uint32)Levels.Num()))
+        {
+            Reader.SetError();
+            return false;
+        }
+
+        if (bFull)
+        {
+            Levels.SetNumZeroed(NumSlots);
+            ReceivedSlots.Init(true, Levels.Num());
+            for (uint8& Level : Levels) Level = (uint8)Reader.ReadInt(MaxLevelValue);
+        }
+        else
+        {
+            ReceivedSlots.Init(false, Levels.Num());
+
+            if (Reader.ReadBit())
+            {
+                uint32 NumDirty = 0;
+                Reader.SerializeIntPacked(NumDirty);
+                if (NumDirty > NumSlots)
+                {
+                    Reader.SetError();
+                    return false;
+                }
+
+                for (uint32 i = 0; i < NumDirty && !Reader.IsError(); i++)
+                {
+                    const int32 Slot = Reader.ReadInt(Levels.Num());
+                    const uint8 Level = (uint8)Reader.ReadInt(MaxLevelValue);
+                    if (!Levels.IsValidIndex(Slot)) continue;
+
+                    Levels[Slot] = Level;
+                    ReceivedSlots[Slot] = true;
+                }
+            }
+            else
+            {
+                for (int32 i = 0; i < Levels.Num(); i++)
+                {
+                    if (!Reader.ReadBit()) continue;
+
+                    Levels[i] = (uint8)Reader.ReadInt(MaxLevelValue);
+                    ReceivedSlots[i] = true;
+                }
+            }
+        }
+
+        if (Reader.ReadBit())
+        {
+            uint32 Points = 0;
+            Reader.SerializeIntPacked(Points);
+            AvailablePoints = (int32)Points;
+        }
+
+        return !Reader.IsError();
+    }
+
+    return true;
+}
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "SkillsState.generated.h"
+
+/*The learned skills of a single character - one byte per skill slot plus the points budget.
+Replicates with a custom delta serializer: only the slots which changed since the state the client
+acknowledged last get sent, each level packed to LevelBits bits*/
+USTRUCT(BlueprintType)
+struct SKILLSTREE_API FSkillsState
+{
+	GENERATED_BODY()
+
+	/*The most slots a received state may have - anything above is a corrupt stream*/
+	enum { MaxNetSlots = 1024 };
+
+	/*The level of each skill, indexed by its slot in the owner's SkillsArray - 0 means not learned*/
+	UPROPERTY()
+	TArray<uint8> Levels;
+
+	/*The skill points which can still be spent*/
+	UPROPERTY()
+	int32 AvailablePoints = 0;
+
+	/*One bit per node of the owner's skill tree - set when the node is learned. Not replicated, clients rebuild it from the levels*/
+	UPROPERTY(NotReplicated)
+	TArray<uint64> UnlockedNodes;
+
+	/*The amount of bits a level needs on the wire - derived from the highest max level of the owner's skills*/
+	UPROPERTY(NotReplicated)
+	uint8 LevelBits = 8;
+
+	/*Set by the last received update - one bit per slot whose level arrived*/
+	TBitArray<> ReceivedSlots;
+
+	/*Returns the level of the given slot - 0 for invalid slots*/
+	FORCEINLINE int32 GetLevel(int32 Slot) const { return Levels.IsValidIndex(Slot) ? Levels[Slot] : 0; }
+
+	/*Unlearns every skill and sets the points budget*/
+	void Reset(int32 NumSlots, int32 Points)
+	{
+		Levels.SetNumZeroed(NumSlots);
+		FMemory::Memzero(Levels.GetData(), Levels.Num());
+		FMemory::Memzero(UnlockedNodes.GetData(), UnlockedNodes.Num() * sizeof(uint64));
+		AvailablePoints = Points;
+	}
+
+	/*Writes the changes since the last acknowledged state or reads them back*/
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+};
+
+template<>
+struct TStructOpsTypeTraits<FSkillsState> : public TStructOpsTypeTraitsBase2<FSkillsState>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true
+	};
+};
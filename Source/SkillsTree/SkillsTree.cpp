@@ -1,7 +1,66 @@
 // Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
 
 #include "SkillsTree.h"
+#include "SkillsTreeStats.h"
 #include "Modules/ModuleManager.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, SkillsTree, "SkillsTree" );
+
+DEFINE_LOG_CATEGORY(LogSkillsTree);
+
+DEFINE_STAT(STAT_SkillsFire);
+DEFINE_STAT(STAT_SkillsGetSpawnTransforms);
+DEFINE_STAT(STAT_SkillsAcquire);
+DEFINE_STAT(STAT_SkillsOnHit);
+DEFINE_STAT(STAT_SkillsSkillBeginPlay);
+DEFINE_STAT(STAT_SkillsComponentBeginPlay);
+DEFINE_STAT(STAT_SkillsRebuildIndex);
+DEFINE_STAT(STAT_SkillsLevelUp);
+DEFINE_STAT(STAT_SkillsResetPoints);
+DEFINE_STAT(STAT_SkillsLookup);
+DEFINE_STAT(STAT_SkillsSimulate);
+DEFINE_STAT(STAT_SkillsSimulateSubstep);
+DEFINE_STAT(STAT_SkillsExpire);
+DEFINE_STAT(STAT_SkillsProcessHits);
+DEFINE_STAT(STAT_SkillsRewind);
+DEFINE_STAT(STAT_SkillsUpdateVisuals);
+DEFINE_STAT(STAT_SkillsUpdateTargets);
+DEFINE_STAT(STAT_SkillsAcquireTargets);
+DEFINE_STAT(STAT_SkillsSplash);
+DEFINE_STAT(STAT_SkillsProfileLoad);
+DEFINE_STAT(STAT_SkillsProfileFlush);
+DEFINE_STAT(STAT_SkillsCrowdThink);
+DEFINE_STAT(STAT_SkillsCrowdCast);
+
+DEFINE_STAT(STAT_SkillsLiveProjectiles);
+DEFINE_STAT(STAT_SkillsSimulatedProjectiles);
+DEFINE_STAT(STAT_SkillsScheduledExpiries);
+DEFINE_STAT(STAT_SkillsInstancedProjectiles);
+DEFINE_STAT(STAT_SkillsParticleProjectiles);
+DEFINE_STAT(STAT_SkillsCrowdCasters);
+DEFINE_STAT(STAT_SkillsShots);
+DEFINE_STAT(STAT_SkillsSpawns);
+DEFINE_STAT(STAT_SkillsHits);
+DEFINE_STAT(STAT_SkillsDroppedHits);
+DEFINE_STAT(STAT_SkillsImpactFXPlayed);
+DEFINE_STAT(STAT_SkillsImpactFXDowngraded);
+DEFINE_STAT(STAT_SkillsImpactFXCulled);
+DEFINE_STAT(STAT_SkillsMispredictions);
+DEFINE_STAT(STAT_SkillsRewoundHits);
+DEFINE_STAT(STAT_SkillsSubsteps);
+DEFINE_STAT(STAT_SkillsProfileWrites);
+DEFINE_STAT(STAT_SkillsRejectedCasts);
+DEFINE_STAT(STAT_SkillsCrowdCasts);
+
+DEFINE_STAT(STAT_SkillsInputToVisibleMs);
+DEFINE_STAT(STAT_SkillsVolleyRoundTripMs);
+
+DEFINE_STAT(STAT_SkillsSlotTablesMemory);
+DEFINE_STAT(STAT_SkillsSimulationMemory);
+DEFINE_STAT(STAT_SkillsExpiryMemory);
+DEFINE_STAT(STAT_SkillsHitBufferMemory);
+DEFINE_STAT(STAT_SkillsLagCompensationMemory);
+DEFINE_STAT(STAT_SkillsTargetHashMemory);
+DEFINE_STAT(STAT_SkillsProfileStoreMemory);
+DEFINE_STAT(STAT_SkillsCrowdMemory);
  
\ No newline at end of file
@@ -7,4 +7,6 @@
 #include "Runtime/UMG/Public/UMGStyle.h"
 #include "Runtime/UMG/Public/Blueprint/UserWidget.h"
 #include "Runtime/UMG/Public/Slate/SObjectWidget.h"
-#include "Runtime/UMG/Public/IUMGModule.h"
\ No newline at end of file
+#include "Runtime/UMG/Public/IUMGModule.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogSkillsTree, Log, All);
@@ -0,0 +1,1505 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillsTreeBenchmarkCommandlet.h"
+#include "SkillsTree.h"
+#include "SkillsTreeCharacter.h"
+#include "SkillCrowdCasterPawn.h"
+#include "SkillsWorldManager.h"
+#include "SkillLagCompensation.h"
+#include "SkillSpatialHash.h"
+#include "SkillProfileStore.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/SpringArmComponent.h"
+#include "HAL/FileManager.h"
+#include "Misc/App.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "UObject/UObjectIterator.h"
+
+double FSkillsBenchmarkSeries::GetPercentile(double Percentile) const
+{
+    if (Samples.Num() == 0) return 0.0;
+
+    TArray<double> Sorted = Samples;
+    Sorted.Sort();
+
+    const int32 Rank = FMath::CeilToInt(Percentile / 100.0 * Sorted.Num()) - 1;
+    return Sorted[FMath::Clamp(Rank, 0, Sorted.Num() - 1)];
+}
+
+TSharedRef<FJsonObject> FSkillsBenchmarkSeries::ToJson() const
+{
+    double Sum = 0.0;
+    for (double Sample : Samples) Sum += Sample;
+
+    TSharedRef<FJsonObject> Json = MakeShareable(new FJsonObject());
+    Json->SetNumberField(TEXT("Mean"), Samples.Num() > 0 ? Sum / Samples.Num() : 0.0);
+    Json->SetNumberField(TEXT("P50"), GetPercentile(50.0));
+    Json->SetNumberField(TEXT("P90"), GetPercentile(90.0));
+    Json->SetNumberField(TEXT("P99"), GetPercentile(99.0));
+    Json->SetNumberField(TEXT("Max"), GetPercentile(100.0));
+    return Json;
+}
+
+USkillsTreeBenchmarkCommandlet::USkillsTreeBenchmarkCommandlet()
+{
+    IsClient = false;
+    IsEditor = false;
+    IsServer = false;
+    LogToConsole = true;
+
+    CharacterClass = FStringClassReference(TEXT("/Game/ThirdPersonCPP/Blueprints/ThirdPersonCharacter.ThirdPersonCharacter_C"));
+    CrowdCasterClass = FStringClassReference(ASkillCrowdCasterPawn::StaticClass());
+    LookupSizes = { 8, 64, 512 };
+    SweepCounts = { 1000, 5000, 10000 };
+}
+
+bool USkillsTreeBenchmarkCommandlet::RunTargetsScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries)
+{
+    if (TargetCount <= 0 || TargetQueries <= 0 || TargetNearest <= 0)
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("The Targets scenario needs targets, queries and a nearest count"));
+        return false;
+    }
+
+    UWorld* World = CreateBenchmarkWorld();
+    if (!World) return false;
+
+    //Cells as big as the query radius, like the manager's default for its largest splash
+    FSkillSpatialHash TargetHash;
+    TargetHash.Init(TargetQueryRadius, 4096);
+
+    //Plain characters so the physics scene holds the same capsules the grid holds
+    const float MapExtent = 10000.f;
+    FRandomStream Random(Seed);
+    FActorSpawnParameters SpawnParams;
+    SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+    TArray<ACharacter*> Targets;
+    TArray<FVector> Velocities;
+    for (int32 i = 0; i < TargetCount; i++)
+    {
+        const FVector Location(Random.FRandRange(-MapExtent, MapExtent), Random.FRandRange(-MapExtent, MapExtent), 96.f);
+        ACharacter* Target = World->SpawnActor<ACharacter>(ACharacter::StaticClass(), Location, FRotator::ZeroRotator, SpawnParams);
+        if (!Target) continue;
+
+        Targets.Add(Target);
+        Velocities.Add(FVector(Random.FRandRange(-600.f, 600.f), Random.FRandRange(-600.f, 600.f), 0.f));
+        TargetHash.Register(Target);
+    }
+
+    FSkillsBenchmarkSeries UpdateMs(TEXT("UpdateMs"));
+    FSkillsBenchmarkSeries GridRadiusMs(TEXT("GridRadiusMs"));
+    FSkillsBenchmarkSeries OverlapRadiusMs(TEXT("OverlapRadiusMs"));
+    FSkillsBenchmarkSeries GridNearestMs(TEXT("GridNearestMs"));
+    FSkillsBenchmarkSeries OverlapNearestMs(TEXT("OverlapNearestMs"));
+    FSkillsBenchmarkSeries GridTargets(TEXT("GridTargets"));
+    FSkillsBenchmarkSeries OverlapTargets(TEXT("OverlapTargets"));
+
+    const FCollisionObjectQueryParams ObjectParams(ECC_Pawn);
+    const FCollisionShape Sphere = FCollisionShape::MakeSphere(TargetQueryRadius);
+    TArray<FOverlapResult> Overlaps;
+    TArray<TPair<float, AActor*>> Sorted;
+    TArray<int32, TInlineAllocator<16>> Slots;
+    TArray<FVector> Centers;
+
+    for (int32 Frame = 0; Frame < NumWarmupFrames + NumFrames; Frame++)
+    {
+        for (int32 i = 0; i < Targets.Num(); i++)
+        {
+            FVector Location = Targets[i]->GetActorLocation() + Velocities[i] * FixedDeltaTime;
+            if (FMath::Abs(Location.X) > MapExtent) Velocities[i].X = -Velocities[i].X;
+            if (FMath::Abs(Location.Y) > MapExtent) Velocities[i].Y = -Velocities[i].Y;
+            Targets[i]->SetActorLocation(Location, false, nullptr, ETeleportType::TeleportPhysics);
+        }
+
+        double Start = FPlatformTime::Seconds();
+        TargetHash.Update();
+        const double UpdateSeconds = FPlatformTime::Seconds() - Start;
+
+        //Projectiles somewhere between the targets - both sides query the same centers
+        Centers.Reset();
+        for (int32 Query = 0; Query < TargetQueries; Query++) Centers.Add(Targets[Random.RandHelper(Targets.Num())]->GetActorLocation() + Random.VRand() * TargetQueryRadius);
+
+        int32 NumGridTargets = 0;
+        Start = FPlatformTime::Seconds();
+        for (const FVector& Center : Centers)
+        {
+            Slots.Reset();
+            NumGridTargets += TargetHash.QueryRadius(Center, TargetQueryRadius, Slots);
+        }
+        const double GridRadiusSeconds = FPlatformTime::Seconds() - Start;
+
+        int32 NumOverlapTargets = 0;
+        Start = FPlatformTime::Seconds();
+        for (const FVector& Center : Centers)
+        {
+            Overlaps.Reset();
+            World->OverlapMultiByObjectType(Overlaps, Center, FQuat::Identity, ObjectParams, Sphere);
+            NumOverlapTargets += Overlaps.Num();
+        }
+        const double OverlapRadiusSeconds = FPlatformTime::Seconds() - Start;
+
+        Start = FPlatformTime::Seconds();
+        for (const FVector& Center : Centers) TargetHash.QueryNearest(Center, TargetQueryRadius, TargetNearest, Slots);
+        const double GridNearestSeconds = FPlatformTime::Seconds() - Start;
+
+        //What a homing projectile has to do without the grid - overlap, then sort by distance
+        Start = FPlatformTime::Seconds();
+        for (const FVector& Center : Centers)
+        {
+            Overlaps.Reset();
+            World->OverlapMultiByObjectType(Overlaps, Center, FQuat::Identity, ObjectParams, Sphere);
+
+            Sorted.Reset();
+            for (const FOverlapResult& Overlap : Overlaps)
+            {
+                AActor* Actor = Overlap.GetActor();
+                if (Actor) Sorted.Emplace(FVector::DistSquared(Actor->GetActorLocation(), Center), Actor);
+            }
+            Sorted.Sort([](const TPair<float, AActor*>& A, const TPair<float, AActor*>& B) { return A.Key < B.Key; });
+            Sorted.SetNum(FMath::Min(Sorted.Num(), TargetNearest), false);
+        }
+        const double OverlapNearestSeconds = FPlatformTime::Seconds() - Start;
+
+        if (Frame < NumWarmupFrames) continue;
+
+        UpdateMs.Samples.Add(UpdateSeconds * 1000.0);
+        GridRadiusMs.Samples.Add(GridRadiusSeconds * 1000.0);
+        OverlapRadiusMs.Samples.Add(OverlapRadiusSeconds * 1000.0);
+        GridNearestMs.Samples.Add(GridNearestSeconds * 1000.0);
+        OverlapNearestMs.Samples.Add(OverlapNearestSeconds * 1000.0);
+        GridTargets.Samples.Add(NumGridTargets);
+        OverlapTargets.Samples.Add(NumOverlapTargets);
+    }
+
+    //The grid tests the target locations, the overlaps the capsules - the overlaps find a few more at the edge
+    Report->SetNumberField(TEXT("Targets"), Targets.Num());
+    Report->SetNumberField(TEXT("QueriesPerFrame"), TargetQueries);
+    Report->SetNumberField(TEXT("QueryRadius"), TargetQueryRadius);
+    Report->SetNumberField(TEXT("Nearest"), TargetNearest);
+    Report->SetNumberField(TEXT("GridBytes"), (double)TargetHash.GetAllocatedSize());
+    Report->SetNumberField(TEXT("Frames"), NumFrames);
+
+    OutSeries = { UpdateMs, GridRadiusMs, OverlapRadiusMs, GridNearestMs, OverlapNearestMs, GridTargets, OverlapTargets };
+
+    DestroyBenchmarkWorld(World);
+    return true;
+}
+
+bool USkillsTreeBenchmarkCommandlet::RunProfilesScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries)
+{
+    if (ProfileCount <= 0 || ProfileBatch <= 0)
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("The Profiles scenario needs profiles and a batch size"));
+        return false;
+    }
+
+    const FString Filename = FPaths::GameSavedDir() / TEXT("Benchmarks") / TEXT("SkillsTree-Profiles.bin");
+    IFileManager::Get().Delete(*Filename, false, true, true);
+
+    //Every player's tree can be rebuilt from its index, so the loads can be checked
+    auto MakeRecord = [this](int32 Player)
+    {
+        FRandomStream Random(Seed + Player);
+        FSkillProfileRecord Record;
+        Record.Key = FSkillProfileStore::MakeKey(FString::Printf(TEXT("Player%d"), Player));
+        Record.Schema = 1;
+        Record.AvailablePoints = Random.RandRange(0, 20);
+        Record.NumSlots = 16;
+        Record.NumNodeWords = 1;
+        for (int32 Slot = 0; Slot < Record.NumSlots; Slot++) Record.Levels[Slot] = (uint8)Random.RandRange(0, 5);
+        Record.UnlockedNodes[0] = ((uint64)Random.GetUnsignedInt() << 32) | Random.GetUnsignedInt();
+        return Record;
+    };
+
+    //Starts small like a fresh server so the growth of the file gets measured too
+    FSkillProfileStore Store;
+    if (!Store.Open(Filename, 4096)) return false;
+
+    FSkillsBenchmarkSeries SaveBatchMs(TEXT("SaveBatchMs"));
+    FSkillsBenchmarkSeries FlushMs(TEXT("FlushMs"));
+    FSkillsBenchmarkSeries LoadBatchMs(TEXT("LoadBatchMs"));
+
+    const double SaveStart = FPlatformTime::Seconds();
+    for (int32 First = 0; First < ProfileCount; First += ProfileBatch)
+    {
+        const int32 Last = FMath::Min(First + ProfileBatch, ProfileCount);
+
+        double Start = FPlatformTime::Seconds();
+        for (int32 Player = First; Player < Last; Player++) Store.Save(MakeRecord(Player));
+        SaveBatchMs.Samples.Add((FPlatformTime::Seconds() - Start) * 1000.0);
+
+        //The game thread's share of the write - the rest happens on the thread pool
+        Start = FPlatformTime::Seconds();
+        Store.Flush();
+        FlushMs.Samples.Add((FPlatformTime::Seconds() - Start) * 1000.0);
+    }
+    Store.WaitForWrites();
+    Store.Flush();
+    Store.WaitForWrites();
+    const double SaveSeconds = FPlatformTime::Seconds() - SaveStart;
+    const uint64 FileBytes = Store.GetFileSize();
+    Store.Close();
+
+    //What a server pays on startup - mapping plus one pass over the keys
+    double Start = FPlatformTime::Seconds();
+    if (!Store.Open(Filename, 4096)) return false;
+    const double OpenSeconds = FPlatformTime::Seconds() - Start;
+
+    FRandomStream Random(Seed);
+    FSkillProfileRecord Loaded;
+    int32 NumMismatches = 0;
+    double LoadSeconds = 0.0;
+
+    for (int32 First = 0; First < ProfileCount; First += ProfileBatch)
+    {
+        const int32 Count = FMath::Min(ProfileBatch, ProfileCount - First);
+
+        //Building the expected records is not part of the measurement
+        TArray<FSkillProfileRecord> Expected;
+        for (int32 i = 0; i < Count; i++) Expected.Add(MakeRecord(Random.RandHelper(ProfileCount)));
+
+        Start = FPlatformTime::Seconds();
+        for (const FSkillProfileRecord& Record : Expected)
+        {
+            if (!Store.Load(Record.Key, Loaded) || FMemory::Memcmp(&Loaded, &Record, sizeof(FSkillProfileRecord)) != 0) NumMismatches++;
+        }
+        const double BatchSeconds = FPlatformTime::Seconds() - Start;
+
+        LoadSeconds += BatchSeconds;
+        LoadBatchMs.Samples.Add(BatchSeconds * 1000.0);
+    }
+
+    Report->SetNumberField(TEXT("Profiles"), Store.Num());
+    Report->SetNumberField(TEXT("Batch"), ProfileBatch);
+    Report->SetNumberField(TEXT("RecordBytes"), sizeof(FSkillProfileRecord));
+    Report->SetNumberField(TEXT("FileBytes"), (double)FileBytes);
+    Report->SetNumberField(TEXT("SaveSeconds"), SaveSeconds);
+    Report->SetNumberField(TEXT("SavesPerSecond"), SaveSeconds > 0.0 ? ProfileCount / SaveSeconds : 0.0);
+    Report->SetNumberField(TEXT("OpenMs"), OpenSeconds * 1000.0);
+    Report->SetNumberField(TEXT("LoadsPerSecond"), LoadSeconds > 0.0 ? ProfileCount / LoadSeconds : 0.0);
+    Report->SetNumberField(TEXT("Mismatches"), NumMismatches);
+
+    OutSeries = { SaveBatchMs, FlushMs, LoadBatchMs };
+
+    Store.Close();
+    IFileManager::Get().Delete(*Filename, false, true, true);
+
+    if (NumMismatches > 0) UE_LOG(LogSkillsTree, Error, TEXT("%d loaded skill profiles didn't match what was saved"), NumMismatches);
+    return NumMismatches == 0;
+}
+
+bool USkillsTreeBenchmarkCommandlet::RunCrowdScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries)
+{
+    UClass* Class = CrowdCasterClass.TryLoadClass<ASkillCrowdCasterPawn>();
+    if (!Class)
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("Could not load the benchmark caster %s"), *CrowdCasterClass.ToString());
+        return false;
+    }
+
+    //Casters without skills of their own fire the ones of the Load scenario's character
+    TArray<TSubclassOf<ASkill>> Skills;
+    if (Class->GetDefaultObject<ASkillCrowdCasterPawn>()->GetSkillsComponent()->SkillsArray.Num() == 0)
+    {
+        UClass* SkillsSource = CharacterClass.TryLoadClass<ASkillsTreeCharacter>();
+        if (SkillsSource) Skills = SkillsSource->GetDefaultObject<ASkillsTreeCharacter>()->GetSkillsComponent()->SkillsArray;
+
+        if (Skills.Num() == 0)
+        {
+            UE_LOG(LogSkillsTree, Error, TEXT("Neither %s nor %s have skills to benchmark"), *Class->GetName(), *CharacterClass.ToString());
+            return false;
+        }
+    }
+
+    UWorld* World = CreateBenchmarkWorld();
+    if (!World) return false;
+
+    //The crowd rolls its think phases and volley seeds with FMath::Rand
+    FMath::RandInit(Seed);
+
+    //Two blocks facing each other - the front ranks are in range of each other, the ones behind still look for targets
+    const int32 NumColumns = FMath::Max(FMath::CeilToInt(FMath::Sqrt((float)FMath::DivideAndRoundUp(CrowdCasterCount, 2))), 1);
+
+    TArray<ASkillCrowdCasterPawn*> Casters;
+    for (int32 i = 0; i < CrowdCasterCount; i++)
+    {
+        const int32 TeamIndex = i % 2;
+        const int32 Rank = i / 2;
+        const float Side = (TeamIndex == 0) ? -1.f : 1.f;
+
+        const FVector Location(Side * (CrowdSpacing + (Rank / NumColumns) * CrowdSpacing), ((Rank % NumColumns) - NumColumns * 0.5f) * CrowdSpacing, 100.f);
+        const FTransform SpawnTransform(FRotator(0.f, (TeamIndex == 0) ? 0.f : 180.f, 0.f), Location);
+
+        ASkillCrowdCasterPawn* Caster = World->SpawnActorDeferred<ASkillCrowdCasterPawn>(Class, SpawnTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+        if (!Caster) continue;
+
+        Caster->SetTeam((uint8)(TeamIndex + 1));
+        if (Skills.Num() > 0)
+        {
+            //The points budget is designer data - enough for every skill to be learned once
+            Caster->GetSkillsComponent()->SkillsArray = Skills;
+            Caster->GetSkillsComponent()->InitialAvailableSkillsPoints = Skills.Num();
+        }
+
+        Caster->FinishSpawning(SpawnTransform);
+        Casters.Add(Caster);
+    }
+
+    ASkillsWorldManager* SkillsManager = ASkillsWorldManager::Get(World);
+    if (!SkillsManager || Casters.Num() == 0)
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("Could not spawn the crowd"));
+        DestroyBenchmarkWorld(World);
+        return false;
+    }
+
+    //Casters learn their skills on BeginPlay - without a single learned skill the crowd would never cast
+    int32 NumLearnedSkills = 0;
+    for (ASkillCrowdCasterPawn* Caster : Casters)
+    {
+        USkillsComponent* SkillsComponent = Caster->GetSkillsComponent();
+        for (int32 SkillNum = 0; SkillNum < SkillsComponent->SkillsArray.Num(); SkillNum++) NumLearnedSkills += SkillsComponent->GetSkillLevel(SkillNum) > 0 ? 1 : 0;
+    }
+
+    if (NumLearnedSkills == 0)
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("The crowd casters didn't learn any skill"));
+        DestroyBenchmarkWorld(World);
+        return false;
+    }
+
+    FSkillsBenchmarkSeries GameThreadMs(TEXT("GameThreadMs"));
+    FSkillsBenchmarkSeries Casts(TEXT("Casts"));
+    FSkillsBenchmarkSeries LiveSkills(TEXT("LiveSkills"));
+    FSkillsBenchmarkSeries LiveActors(TEXT("LiveActors"));
+    FSkillsBenchmarkSeries UsedMemoryMB(TEXT("UsedMemoryMB"));
+
+    FApp::SetDeltaTime(FixedDeltaTime);
+
+    for (int32 Frame = 0; Frame < NumWarmupFrames + NumFrames; Frame++)
+    {
+        //Nothing drives the casters but the world's crowd
+        const double FrameStart = FPlatformTime::Seconds();
+        World->Tick(LEVELTICK_All, FixedDeltaTime);
+        GFrameCounter++;
+        const double FrameSeconds = FPlatformTime::Seconds() - FrameStart;
+
+        if (Frame < NumWarmupFrames) continue;
+
+        GameThreadMs.Samples.Add(FrameSeconds * 1000.0);
+        Casts.Samples.Add(SkillsManager->GetNumCrowdCasts());
+        LiveSkills.Samples.Add(SkillsManager->GetSkillPoolStats(nullptr).NumActive);
+        LiveActors.Samples.Add(World->GetActorCount());
+        UsedMemoryMB.Samples.Add(FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0));
+    }
+
+    Report->SetNumberField(TEXT("Casters"), SkillsManager->GetNumCrowdCasters());
+    Report->SetNumberField(TEXT("LearnedSkills"), NumLearnedSkills);
+    Report->SetNumberField(TEXT("SkillTargets"), SkillsManager->GetNumSkillTargets());
+    Report->SetNumberField(TEXT("CrowdSpacing"), CrowdSpacing);
+    Report->SetNumberField(TEXT("Frames"), NumFrames);
+    Report->SetNumberField(TEXT("WarmupFrames"), NumWarmupFrames);
+    Report->SetNumberField(TEXT("DeltaTime"), FixedDeltaTime);
+    Report->SetNumberField(TEXT("Seed"), Seed);
+
+    OutSeries = { GameThreadMs, Casts, LiveSkills, LiveActors, UsedMemoryMB };
+
+    DestroyBenchmarkWorld(World);
+    return true;
+}
+
+bool USkillsTreeBenchmarkCommandlet::RunSweepsScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries)
+{
+    UClass* Class = CharacterClass.TryLoadClass<ASkillsTreeCharacter>();
+    const TArray<TSubclassOf<ASkill>>* Skills = Class ? &Class->GetDefaultObject<ASkillsTreeCharacter>()->GetSkillsComponent()->SkillsArray : nullptr;
+    if (!Skills || Skills->Num() == 0 || !(*Skills)[0])
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("%s has no skills to benchmark"), *CharacterClass.ToString());
+        return false;
+    }
+
+    const TSubclassOf<ASkill> SkillClass = (*Skills)[0];
+
+    //The managers read the sweep mode on BeginPlay - the config default gets restored at the end
+    ASkillsWorldManager* ManagerDefaults = GetMutableDefault<ASkillsWorldManager>();
+    const bool bConfiguredAsyncSweeps = ManagerDefaults->bAsyncSkillSweeps;
+
+    TArray<TSharedPtr<FJsonValue>> Runs;
+
+    for (int32 Count : SweepCounts)
+    {
+        if (Count <= 0) continue;
+
+        for (int32 Mode = 0; Mode < 2; Mode++)
+        {
+            const bool bAsync = Mode == 1;
+            ManagerDefaults->bAsyncSkillSweeps = bAsync;
+
+            UWorld* World = CreateBenchmarkWorld();
+            if (!World)
+            {
+                ManagerDefaults->bAsyncSkillSweeps = bConfiguredAsyncSweeps;
+                return false;
+            }
+
+            ASkillsWorldManager* SkillsManager = ASkillsWorldManager::Get(World);
+
+            //Plain characters scattered in the volume give the sweeps something to find besides empty cells
+            const float Extent = 5000.f;
+            FRandomStream Random(Seed);
+            FActorSpawnParameters SpawnParams;
+            SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+            for (int32 i = 0; i < SweepTargets; i++)
+            {
+                const FVector Location(Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent, Extent));
+                World->SpawnActor<ACharacter>(ACharacter::StaticClass(), Location, FRotator::ZeroRotator, SpawnParams);
+            }
+
+            FSkillsBenchmarkSeries GameThreadMs(FString::Printf(TEXT("%s%dGameThreadMs"), bAsync ? TEXT("Async") : TEXT("Sync"), Count));
+            FSkillsBenchmarkSeries InFlight(FString::Printf(TEXT("%s%dInFlight"), bAsync ? TEXT("Async") : TEXT("Sync"), Count));
+
+            FApp::SetDeltaTime(FixedDeltaTime);
+
+            for (int32 Frame = 0; Frame < NumWarmupFrames + NumFrames; Frame++)
+            {
+                //Projectiles which hit or expired get replaced so the count in flight stays put
+                for (int32 Missing = Count - SkillsManager->GetNumSimulatedSkills(); Missing > 0; Missing--)
+                {
+                    const FVector Location(Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent, Extent));
+                    if (!SkillsManager->AcquireSkill(SkillClass, FTransform(Random.VRand().Rotation(), Location))) break;
+                }
+
+                //The async traces of a frame run on task threads and get waited for inside the next World->Tick
+                const double FrameStart = FPlatformTime::Seconds();
+                World->Tick(LEVELTICK_All, FixedDeltaTime);
+                GFrameCounter++;
+                const double FrameSeconds = FPlatformTime::Seconds() - FrameStart;
+
+                if (Frame < NumWarmupFrames) continue;
+
+                GameThreadMs.Samples.Add(FrameSeconds * 1000.0);
+                InFlight.Samples.Add(SkillsManager->GetNumSimulatedSkills());
+            }
+
+            TSharedRef<FJsonObject> Run = GameThreadMs.ToJson();
+            Run->SetNumberField(TEXT("Projectiles"), Count);
+            Run->SetBoolField(TEXT("Async"), bAsync);
+            Run->SetNumberField(TEXT("MeanInFlight"), InFlight.ToJson()->GetNumberField(TEXT("Mean")));
+            Runs.Add(MakeShareable(new FJsonValueObject(Run)));
+
+            OutSeries.Add(GameThreadMs);
+            OutSeries.Add(InFlight);
+
+            DestroyBenchmarkWorld(World);
+        }
+    }
+
+    ManagerDefaults->bAsyncSkillSweeps = bConfiguredAsyncSweeps;
+
+    Report->SetArrayField(TEXT("Runs"), Runs);
+    Report->SetStringField(TEXT("SkillClass"), SkillClass->GetName());
+    Report->SetNumberField(TEXT("Targets"), SweepTargets);
+    Report->SetNumberField(TEXT("Frames"), NumFrames);
+    Report->SetNumberField(TEXT("DeltaTime"), FixedDeltaTime);
+    Report->SetNumberField(TEXT("Seed"), Seed);
+    return true;
+}
+
+bool USkillsTreeBenchmarkCommandlet::RunMuzzleScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries)
+{
+    UClass* Class = CharacterClass.TryLoadClass<ASkillsTreeCharacter>();
+    if (!Class)
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("Could not load the benchmark character %s"), *CharacterClass.ToString());
+        return false;
+    }
+
+    FSkillsBenchmarkSeries MuzzleMs(TEXT("MuzzleGameThreadMs"));
+    FSkillsBenchmarkSeries SpringArmMs(TEXT("SpringArmGameThreadMs"));
+
+    FApp::SetDeltaTime(FixedDeltaTime);
+
+    //The first pass is the character as it is, the second one adds back what the character used to create for its skills
+    for (int32 Pass = 0; Pass < 2; Pass++)
+    {
+        const bool bSpringArms = Pass == 1;
+        FSkillsBenchmarkSeries& GameThreadMs = bSpringArms ? SpringArmMs : MuzzleMs;
+
+        UWorld* World = CreateBenchmarkWorld();
+        if (!World) return false;
+
+        FActorSpawnParameters SpawnParams;
+        SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+        const int32 NumColumns = FMath::Max(FMath::CeilToInt(FMath::Sqrt((float)NumCharacters)), 1);
+        const int64 UsedMemoryBefore = FPlatformMemory::GetStats().UsedPhysical;
+
+        TArray<ASkillsTreeCharacter*> Characters;
+        TArray<FVector> Centers;
+        int32 NumComponents = 0;
+        int32 NumTickingComponents = 0;
+        SIZE_T ComponentBytes = 0;
+
+        for (int32 i = 0; i < NumCharacters; i++)
+        {
+            const FVector Location((i % NumColumns) * 300.f, (i / NumColumns) * 300.f, 200.f);
+            ASkillsTreeCharacter* Character = World->SpawnActor<ASkillsTreeCharacter>(Class, Location, FRotator::ZeroRotator, SpawnParams);
+            if (!Character) continue;
+
+            Character->GetCharacterMovement()->SetMovementMode(MOVE_Flying);
+
+            if (bSpringArms)
+            {
+                //Same hierarchy as the removed SkillsRootComp and Level*SpringArm subobjects, with their defaults
+                USceneComponent* SkillsRoot = NewObject<USceneComponent>(Character, TEXT("SkillsRootComp"));
+                SkillsRoot->SetupAttachment(Character->GetRootComponent());
+                SkillsRoot->RegisterComponent();
+
+                for (int32 Arm = 0; Arm < 3; Arm++)
+                {
+                    USpringArmComponent* SpringArm = NewObject<USpringArmComponent>(Character);
+                    SpringArm->SetupAttachment(SkillsRoot);
+                    SpringArm->RegisterComponent();
+                }
+            }
+
+            TInlineComponentArray<UActorComponent*> Components(Character);
+            for (UActorComponent* Component : Components)
+            {
+                NumComponents++;
+                if (Component->IsComponentTickEnabled()) NumTickingComponents++;
+                ComponentBytes += Component->GetClass()->GetStructureSize();
+            }
+
+            Characters.Add(Character);
+            Centers.Add(Location);
+        }
+
+        const int64 UsedMemoryAfter = FPlatformMemory::GetStats().UsedPhysical;
+
+        if (Characters.Num() == 0)
+        {
+            UE_LOG(LogSkillsTree, Error, TEXT("Could not spawn %s"), *Class->GetName());
+            DestroyBenchmarkWorld(World);
+            return false;
+        }
+
+        for (int32 Frame = 0; Frame < NumWarmupFrames + NumFrames; Frame++)
+        {
+            const double FrameStart = FPlatformTime::Seconds();
+
+            //Every character walks a small circle and turns with it, so every attached component updates its transform
+            const float Time = Frame * FixedDeltaTime;
+            for (int32 i = 0; i < Characters.Num(); i++)
+            {
+                const float Angle = Time * 2.f + i;
+                const FVector Location = Centers[i] + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * 50.f;
+                Characters[i]->SetActorLocationAndRotation(Location, FRotator(0.f, FMath::RadiansToDegrees(Angle) + 90.f, 0.f), false, nullptr, ETeleportType::TeleportPhysics);
+            }
+
+            World->Tick(LEVELTICK_All, FixedDeltaTime);
+            GFrameCounter++;
+            const double FrameSeconds = FPlatformTime::Seconds() - FrameStart;
+
+            if (Frame >= NumWarmupFrames) GameThreadMs.Samples.Add(FrameSeconds * 1000.0);
+        }
+
+        const TCHAR* Prefix = bSpringArms ? TEXT("SpringArm") : TEXT("Muzzle");
+        Report->SetNumberField(FString::Printf(TEXT("%sComponentsPerCharacter"), Prefix), (double)NumComponents / Characters.Num());
+        Report->SetNumberField(FString::Printf(TEXT("%sTickingComponentsPerCharacter"), Prefix), (double)NumTickingComponents / Characters.Num());
+        Report->SetNumberField(FString::Printf(TEXT("%sComponentBytesPerCharacter"), Prefix), (double)ComponentBytes / Characters.Num());
+        Report->SetNumberField(FString::Printf(TEXT("%sUsedBytesPerCharacter"), Prefix), (double)(UsedMemoryAfter - UsedMemoryBefore) / Characters.Num());
+        Report->SetNumberField(TEXT("Characters"), Characters.Num());
+
+        DestroyBenchmarkWorld(World);
+    }
+
+    Report->SetNumberField(TEXT("Frames"), NumFrames);
+    Report->SetNumberField(TEXT("WarmupFrames"), NumWarmupFrames);
+    Report->SetNumberField(TEXT("DeltaTime"), FixedDeltaTime);
+
+    OutSeries = { MuzzleMs, SpringArmMs };
+    return true;
+}
+
+bool USkillsTreeBenchmarkCommandlet::RunReplayScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries)
+{
+    UClass* Class = CharacterClass.TryLoadClass<ASkillsTreeCharacter>();
+    const TArray<TSubclassOf<ASkill>>* Skills = Class ? &Class->GetDefaultObject<ASkillsTreeCharacter>()->GetSkillsComponent()->SkillsArray : nullptr;
+    if (!Skills || Skills->Num() == 0 || !(*Skills)[0] || !(*Skills)[0]->GetDefaultObject<ASkill>()->UsesBatchedSimulation())
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("%s has no batched skill to replay"), *CharacterClass.ToString());
+        return false;
+    }
+
+    const TSubclassOf<ASkill> SkillClass = (*Skills)[0];
+    const float Speed = SkillClass->GetDefaultObject<ASkill>()->GetInitialSpeed();
+
+    //The managers read the step on BeginPlay - the config default gets restored at the end
+    ASkillsWorldManager* ManagerDefaults = GetMutableDefault<ASkillsWorldManager>();
+    const float ConfiguredFixedStep = ManagerDefaults->SimulationFixedStep;
+    const float Step = FMath::Max(ReplayFixedStep, KINDA_SMALL_NUMBER);
+    ManagerDefaults->SimulationFixedStep = Step;
+
+    //Half a step past a step boundary, so frame times which add up a little differently still run the same steps
+    const int32 NumSteps = FMath::Max(FMath::FloorToInt(ReplaySeconds / Step), 1);
+    const float Duration = (NumSteps + 0.5f) * Step;
+
+    //The shots of the run - fired during the first half so they all fly for a while
+    const float Extent = 5000.f;
+    FRandomStream Random(Seed);
+    TArray<FTransform> ShotTransforms;
+    TArray<float> ShotTimes;
+    for (int32 i = 0; i < ReplayProjectiles; i++)
+    {
+        const FVector Location(Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent, Extent));
+        ShotTransforms.Add(FTransform(Random.VRand().Rotation(), Location));
+        ShotTimes.Add(Random.FRandRange(0.f, Duration * 0.5f));
+    }
+
+    TArray<int32> ShotOrder;
+    for (int32 i = 0; i < ShotTimes.Num(); i++) ShotOrder.Add(i);
+    ShotOrder.Sort([&ShotTimes](int32 A, int32 B) { return ShotTimes[A] < ShotTimes[B]; });
+
+    TArray<FVector> SteadyLocations;
+    float MaxDeviation = 0.f;
+
+    //The first pass runs at FixedDeltaTime, the second one with frames between half and one and a half of it
+    for (int32 Pass = 0; Pass < 2; Pass++)
+    {
+        const bool bJittered = Pass == 1;
+
+        UWorld* World = CreateBenchmarkWorld();
+        if (!World)
+        {
+            ManagerDefaults->SimulationFixedStep = ConfiguredFixedStep;
+            return false;
+        }
+
+        ASkillsWorldManager* SkillsManager = ASkillsWorldManager::Get(World);
+
+        FSkillsBenchmarkSeries GameThreadMs(bJittered ? TEXT("JitteredGameThreadMs") : TEXT("SteadyGameThreadMs"));
+        FRandomStream FrameRandom(Seed + 1);
+        TArray<ASkill*> Shots;
+        Shots.Init(nullptr, ShotTimes.Num());
+
+        int32 NextShot = 0;
+        double TickedSeconds = 0.0;
+        double TotalMs = 0.0;
+
+        while (World->GetTimeSeconds() < Duration)
+        {
+            //Shots which came due get fired from where they would be by now - the simulation moves them back onto its step clock
+            const float Now = World->GetTimeSeconds();
+            for (; NextShot < ShotOrder.Num() && ShotTimes[ShotOrder[NextShot]] <= Now; NextShot++)
+            {
+                const int32 Shot = ShotOrder[NextShot];
+                FTransform Transform = ShotTransforms[Shot];
+                Transform.AddToTranslation(Transform.GetRotation().GetForwardVector() * Speed * (Now - ShotTimes[Shot]));
+                Shots[Shot] = SkillsManager->AcquireSkill(SkillClass, Transform);
+            }
+
+            //The last frame stops right at the end of the run
+            const float FrameDelta = bJittered ? FixedDeltaTime * FrameRandom.FRandRange(0.5f, 1.5f) : FixedDeltaTime;
+            const float DeltaTime = FMath::Min(FrameDelta, Duration - Now);
+            FApp::SetDeltaTime(DeltaTime);
+
+            const double FrameStart = FPlatformTime::Seconds();
+            World->Tick(LEVELTICK_All, DeltaTime);
+            GFrameCounter++;
+            const double FrameMs = (FPlatformTime::Seconds() - FrameStart) * 1000.0;
+
+            GameThreadMs.Samples.Add(FrameMs);
+            TotalMs += FrameMs;
+            TickedSeconds += DeltaTime;
+        }
+
+        //Where the shots are on the last step - the draw locations depend on the frame times by design
+        int32 NumCompared = 0;
+        for (int32 Shot = 0; Shot < Shots.Num(); Shot++)
+        {
+            const FVector Location = Shots[Shot] ? SkillsManager->GetSimulatedSkillLocation(Shots[Shot]) : FVector::ZeroVector;
+            if (!bJittered)
+            {
+                SteadyLocations.Add(Location);
+                continue;
+            }
+
+            MaxDeviation = FMath::Max(MaxDeviation, FVector::Dist(Location, SteadyLocations[Shot]));
+            NumCompared++;
+        }
+
+        const TCHAR* Prefix = bJittered ? TEXT("Jittered") : TEXT("Steady");
+        Report->SetNumberField(FString::Printf(TEXT("%sFrames"), Prefix), GameThreadMs.Samples.Num());
+        Report->SetNumberField(FString::Printf(TEXT("%sSeconds"), Prefix), TickedSeconds);
+        Report->SetNumberField(FString::Printf(TEXT("%sGameThreadMsPerStep"), Prefix), TotalMs / NumSteps);
+        if (bJittered) Report->SetNumberField(TEXT("Compared"), NumCompared);
+
+        OutSeries.Add(GameThreadMs);
+        DestroyBenchmarkWorld(World);
+    }
+
+    ManagerDefaults->SimulationFixedStep = ConfiguredFixedStep;
+
+    //Both passes ran the same steps on the same inputs - anything above float noise means the frame rate leaked into the simulation
+    if (MaxDeviation > 0.1f) UE_LOG(LogSkillsTree, Warning, TEXT("The replay ended up to %.3f units away from the steady run"), MaxDeviation);
+
+    Report->SetNumberField(TEXT("MaxDeviation"), MaxDeviation);
+    Report->SetStringField(TEXT("SkillClass"), SkillClass->GetName());
+    Report->SetNumberField(TEXT("Projectiles"), ReplayProjectiles);
+    Report->SetNumberField(TEXT("FixedStep"), Step);
+    Report->SetNumberField(TEXT("Steps"), NumSteps);
+    Report->SetNumberField(TEXT("DeltaTime"), FixedDeltaTime);
+    Report->SetNumberField(TEXT("Seed"), Seed);
+    return true;
+}
+
+void USkillsTreeBenchmarkCommandlet::ParseParams(const FString& Params)
+{
+    FParse::Value(*Params, TEXT("Scenario="), Scenario);
+    FParse::Value(*Params, TEXT("Label="), Label);
+    FParse::Value(*Params, TEXT("Characters="), NumCharacters);
+    FParse::Value(*Params, TEXT("Frames="), NumFrames);
+    FParse::Value(*Params, TEXT("WarmupFrames="), NumWarmupFrames);
+    FParse::Value(*Params, TEXT("DeltaTime="), FixedDeltaTime);
+    FParse::Value(*Params, TEXT("FireRate="), FireRate);
+    FParse::Value(*Params, TEXT("LevelRate="), LevelUpRate);
+    FParse::Value(*Params, TEXT("ResetRate="), ResetRate);
+    FParse::Value(*Params, TEXT("GCInterval="), GCInterval);
+    FParse::Value(*Params, TEXT("Seed="), Seed);
+    FParse::Value(*Params, TEXT("LookupIterations="), LookupIterations);
+    FParse::Value(*Params, TEXT("SweepTargets="), SweepTargets);
+    FParse::Value(*Params, TEXT("PanelSlots="), PanelSlots);
+    FParse::Value(*Params, TEXT("PanelChanges="), PanelChangeRate);
+    FParse::Value(*Params, TEXT("Players="), ReplicationPlayers);
+    FParse::Value(*Params, TEXT("MaxLevel="), ReplicationMaxLevel);
+    FParse::Value(*Params, TEXT("RewindQueries="), RewindQueries);
+    FParse::Value(*Params, TEXT("RewindFrames="), RewindFrames);
+    FParse::Value(*Params, TEXT("Targets="), TargetCount);
+    FParse::Value(*Params, TEXT("TargetQueries="), TargetQueries);
+    FParse::Value(*Params, TEXT("TargetRadius="), TargetQueryRadius);
+    FParse::Value(*Params, TEXT("Nearest="), TargetNearest);
+    FParse::Value(*Params, TEXT("Profiles="), ProfileCount);
+    FParse::Value(*Params, TEXT("ProfileBatch="), ProfileBatch);
+    FParse::Value(*Params, TEXT("Casters="), CrowdCasterCount);
+    FParse::Value(*Params, TEXT("CrowdSpacing="), CrowdSpacing);
+    FParse::Value(*Params, TEXT("ReplayProjectiles="), ReplayProjectiles);
+    FParse::Value(*Params, TEXT("ReplaySeconds="), ReplaySeconds);
+    FParse::Value(*Params, TEXT("ReplayStep="), ReplayFixedStep);
+
+    FString ClassPath;
+    if (FParse::Value(*Params, TEXT("CharacterClass="), ClassPath)) CharacterClass = FStringClassReference(ClassPath);
+    if (FParse::Value(*Params, TEXT("CasterClass="), ClassPath)) CrowdCasterClass = FStringClassReference(ClassPath);
+
+    FString Sizes;
+    if (FParse::Value(*Params, TEXT("LookupSizes="), Sizes))
+    {
+        TArray<FString> Tokens;
+        Sizes.ParseIntoArray(Tokens, TEXT(","));
+
+        LookupSizes.Reset();
+        for (const FString& Token : Tokens) LookupSizes.Add(FCString::Atoi(*Token));
+    }
+
+    if (FParse::Value(*Params, TEXT("SweepCounts="), Sizes))
+    {
+        TArray<FString> Tokens;
+        Sizes.ParseIntoArray(Tokens, TEXT(","));
+
+        SweepCounts.Reset();
+        for (const FString& Token : Tokens) SweepCounts.Add(FCString::Atoi(*Token));
+    }
+
+    if (Scenario.IsEmpty()) Scenario = TEXT("Load");
+    NumFrames = FMath::Max(NumFrames, 1);
+    NumWarmupFrames = FMath::Max(NumWarmupFrames, 0);
+    FixedDeltaTime = FMath::Max(FixedDeltaTime, KINDA_SMALL_NUMBER);
+}
+
+int32 USkillsTreeBenchmarkCommandlet::Main(const FString& Params)
+{
+    ParseParams(Params);
+
+    TSharedRef<FJsonObject> Report = MakeShareable(new FJsonObject());
+    Report->SetStringField(TEXT("Scenario"), Scenario);
+    Report->SetStringField(TEXT("Label"), Label);
+    Report->SetStringField(TEXT("Params"), Params);
+    Report->SetStringField(TEXT("Engine"), FEngineVersion::Current().ToString());
+    Report->SetStringField(TEXT("Platform"), FPlatformProperties::PlatformName());
+    Report->SetStringField(TEXT("CPU"), FPlatformMisc::GetCPUBrand());
+    Report->SetNumberField(TEXT("Cores"), FPlatformMisc::NumberOfCores());
+    Report->SetStringField(TEXT("Date"), FDateTime::UtcNow().ToIso8601());
+
+    TArray<FSkillsBenchmarkSeries> Series;
+    bool bSucceeded = false;
+
+    if (Scenario == TEXT("Load")) bSucceeded = RunLoadScenario(Report, Series);
+    else if (Scenario == TEXT("Lookup")) bSucceeded = RunLookupScenario(Report, Series);
+    else if (Scenario == TEXT("Panel")) bSucceeded = RunPanelScenario(Report, Series);
+    else if (Scenario == TEXT("Replication")) bSucceeded = RunReplicationScenario(Report, Series);
+    else if (Scenario == TEXT("Rewind")) bSucceeded = RunRewindScenario(Report, Series);
+    else if (Scenario == TEXT("Targets")) bSucceeded = RunTargetsScenario(Report, Series);
+    else if (Scenario == TEXT("Profiles")) bSucceeded = RunProfilesScenario(Report, Series);
+    else if (Scenario == TEXT("Crowd")) bSucceeded = RunCrowdScenario(Report, Series);
+    else if (Scenario == TEXT("Muzzle")) bSucceeded = RunMuzzleScenario(Report, Series);
+    else if (Scenario == TEXT("Sweeps")) bSucceeded = RunSweepsScenario(Report, Series);
+    else if (Scenario == TEXT("Replay")) bSucceeded = RunReplayScenario(Report, Series);
+    else UE_LOG(LogSkillsTree, Error, TEXT("Unknown benchmark scenario %s (Load, Lookup, Panel, Replication, Rewind, Targets, Profiles, Crowd, Muzzle, Sweeps, Replay)"), *Scenario);
+
+    if (!bSucceeded) return 1;
+
+    FString OutputPath;
+    if (!FParse::Value(*Params, TEXT("Output="), OutputPath))
+    {
+        OutputPath = FPaths::GameSavedDir() / TEXT("Benchmarks") / FString::Printf(TEXT("SkillsTree-%s-%s"), *Scenario, *FDateTime::Now().ToString());
+    }
+
+    return WriteReports(OutputPath, Report, Series) ? 0 : 1;
+}
+
+bool USkillsTreeBenchmarkCommandlet::RunLoadScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries)
+{
+    UClass* Class = CharacterClass.TryLoadClass<ASkillsTreeCharacter>();
+    if (!Class)
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("Could not load the benchmark character %s"), *CharacterClass.ToString());
+        return false;
+    }
+
+    UWorld* World = CreateBenchmarkWorld();
+    if (!World) return false;
+
+    //A ring of characters looking at its center so the projectiles actually hit someone
+    const float RingRadius = FMath::Max(500.f, NumCharacters * 150.f / (2.f * PI));
+
+    FActorSpawnParameters SpawnParams;
+    SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+    TArray<ASkillsTreeCharacter*> Characters;
+    for (int32 i = 0; i < NumCharacters; i++)
+    {
+        const float Angle = 2.f * PI * i / NumCharacters;
+        const FVector Location(RingRadius * FMath::Cos(Angle), RingRadius * FMath::Sin(Angle), 200.f);
+
+        ASkillsTreeCharacter* Character = World->SpawnActor<ASkillsTreeCharacter>(Class, Location, (-Location).Rotation(), SpawnParams);
+        if (!Character) continue;
+
+        //There is no floor in the benchmark world
+        Character->GetCharacterMovement()->SetMovementMode(MOVE_Flying);
+
+        //Level 0 skills can't be fired
+        USkillsComponent* SkillsComponent = Character->GetSkillsComponent();
+        for (int32 SkillNum = 0; SkillNum < SkillsComponent->SkillsArray.Num(); SkillNum++) SkillsComponent->AdvanceSkillLevelAtSlot(SkillNum);
+
+        Characters.Add(Character);
+    }
+
+    if (Characters.Num() == 0 || Characters[0]->GetSkillsComponent()->SkillsArray.Num() == 0)
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("%s has no skills to benchmark"), *Class->GetName());
+        DestroyBenchmarkWorld(World);
+        return false;
+    }
+
+    ASkillsWorldManager* SkillsManager = ASkillsWorldManager::Get(World);
+
+    FSkillsBenchmarkSeries GameThreadMs(TEXT("GameThreadMs"));
+    FSkillsBenchmarkSeries SpawnMs(TEXT("SpawnMs"));
+    FSkillsBenchmarkSeries GCMs(TEXT("GCMs"));
+    //How much the resident memory moved during a frame - page faults and trimming drive it, not the allocation count, so it may go negative
+    FSkillsBenchmarkSeries ResidentDeltaKB(TEXT("ResidentDeltaKB"));
+    FSkillsBenchmarkSeries UsedMemoryMB(TEXT("UsedMemoryMB"));
+    FSkillsBenchmarkSeries LiveActors(TEXT("LiveActors"));
+    FSkillsBenchmarkSeries LiveObjects(TEXT("LiveObjects"));
+    FSkillsBenchmarkSeries LiveSkills(TEXT("LiveSkills"));
+    FSkillsBenchmarkSeries InstancedSkills(TEXT("InstancedSkills"));
+    FSkillsBenchmarkSeries ParticleSkills(TEXT("ParticleSkills"));
+
+    FRandomStream Random(Seed);
+    float FireAccumulator = 0.f;
+    float LevelUpAccumulator = 0.f;
+    float ResetAccumulator = 0.f;
+
+    FApp::SetDeltaTime(FixedDeltaTime);
+
+    for (int32 Frame = 0; Frame < NumWarmupFrames + NumFrames; Frame++)
+    {
+        const int64 UsedMemoryBefore = FPlatformMemory::GetStats().UsedPhysical;
+        const double FrameStart = FPlatformTime::Seconds();
+        double SpawnSeconds = 0.0;
+
+        //The rates are per character so the accumulators advance by the whole crowd
+        FireAccumulator += FireRate * Characters.Num() * FixedDeltaTime;
+        for (; FireAccumulator >= 1.f; FireAccumulator -= 1.f)
+        {
+            ASkillsTreeCharacter* Character = Characters[Random.RandHelper(Characters.Num())];
+            const bool bSecondary = Random.FRand() < 0.5f;
+
+            const double SpawnStart = FPlatformTime::Seconds();
+            Character->Fire(bSecondary);
+            SpawnSeconds += FPlatformTime::Seconds() - SpawnStart;
+        }
+
+        LevelUpAccumulator += LevelUpRate * Characters.Num() * FixedDeltaTime;
+        for (; LevelUpAccumulator >= 1.f; LevelUpAccumulator -= 1.f)
+        {
+            USkillsComponent* SkillsComponent = Characters[Random.RandHelper(Characters.Num())]->GetSkillsComponent();
+            SkillsComponent->AdvanceSkillLevelAtSlot(Random.RandHelper(SkillsComponent->SkillsArray.Num()));
+        }
+
+        ResetAccumulator += ResetRate * Characters.Num() * FixedDeltaTime;
+        for (; ResetAccumulator >= 1.f; ResetAccumulator -= 1.f)
+        {
+            Characters[Random.RandHelper(Characters.Num())]->GetSkillsComponent()->ResetSkillPoints();
+        }
+
+        World->Tick(LEVELTICK_All, FixedDeltaTime);
+        GFrameCounter++;
+
+        const double FrameSeconds = FPlatformTime::Seconds() - FrameStart;
+        const int64 UsedMemoryAfter = FPlatformMemory::GetStats().UsedPhysical;
+
+        double GCSeconds = 0.0;
+        if (GCInterval > 0 && (Frame + 1) % GCInterval == 0)
+        {
+            const double GCStart = FPlatformTime::Seconds();
+            CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+            GCSeconds = FPlatformTime::Seconds() - GCStart;
+        }
+
+        if (Frame < NumWarmupFrames) continue;
+
+        GameThreadMs.Samples.Add(FrameSeconds * 1000.0);
+        SpawnMs.Samples.Add(SpawnSeconds * 1000.0);
+        GCMs.Samples.Add(GCSeconds * 1000.0);
+        ResidentDeltaKB.Samples.Add((UsedMemoryAfter - UsedMemoryBefore) / 1024.0);
+        UsedMemoryMB.Samples.Add(UsedMemoryAfter / (1024.0 * 1024.0));
+        LiveActors.Samples.Add(World->GetActorCount());
+        LiveObjects.Samples.Add(GUObjectArray.GetObjectArrayNumMinusAvailable());
+        LiveSkills.Samples.Add(SkillsManager ? SkillsManager->GetSkillPoolStats(nullptr).NumActive : 0);
+        InstancedSkills.Samples.Add(SkillsManager ? SkillsManager->GetNumInstancedSkills() : 0);
+        ParticleSkills.Samples.Add(SkillsManager ? SkillsManager->GetNumParticleSkills() : 0);
+    }
+
+    Report->SetNumberField(TEXT("Characters"), Characters.Num());
+    Report->SetNumberField(TEXT("Frames"), NumFrames);
+    Report->SetNumberField(TEXT("WarmupFrames"), NumWarmupFrames);
+    Report->SetNumberField(TEXT("DeltaTime"), FixedDeltaTime);
+    Report->SetNumberField(TEXT("FireRate"), FireRate);
+    Report->SetNumberField(TEXT("LevelRate"), LevelUpRate);
+    Report->SetNumberField(TEXT("ResetRate"), ResetRate);
+    Report->SetNumberField(TEXT("Seed"), Seed);
+    Report->SetNumberField(TEXT("InstancedComponents"), SkillsManager ? SkillsManager->GetNumInstancedComponents() : 0);
+
+    OutSeries = { GameThreadMs, SpawnMs, GCMs, ResidentDeltaKB, UsedMemoryMB, LiveActors, LiveObjects, LiveSkills, InstancedSkills, ParticleSkills };
+
+    DestroyBenchmarkWorld(World);
+    return true;
+}
+
+/*Gathers every loaded, concrete skill class*/
+static void GetSkillClasses(TArray<TSubclassOf<ASkill>>& OutSkillClasses)
+{
+    for (TObjectIterator<UClass> It; It; ++It)
+    {
+        if (It->IsChildOf(ASkill::StaticClass()) && !It->HasAnyClassFlags(CLASS_Abstract | CLASS_Deprecated | CLASS_NewerVersionExists)) OutSkillClasses.Add(*It);
+    }
+}
+
+/*Makes a transient subclass of ASkill - every slot of the Lookup scenario needs its own class so its default object can
+carry its own id*/
+static UClass* MakeBenchmarkSkillClass(int32 Index)
+{
+    UClass* Parent = ASkill::StaticClass();
+    UClass* Class = NewObject<UClass>(GetTransientPackage(), FName(TEXT("BenchmarkSkill"), Index + 1), RF_Public | RF_Transient);
+    Class->SetSuperStruct(Parent);
+    Class->ClassFlags |= CLASS_Transient;
+    Class->ClassWithin = Parent->ClassWithin;
+    Class->ClassConfigName = Parent->ClassConfigName;
+
+    //The native constructor and the reference collection get inherited from ASkill
+    Class->Bind();
+    Class->StaticLink(true);
+    Class->AssembleReferenceTokenStream();
+    return Class;
+}
+
+/*The lookup USkillsComponent did before it had lookup tables - a scan over the default object of every slot*/
+static int32 FindSkillSlotByIdLinear(const TArray<TSubclassOf<ASkill>>& SkillsArray, FName SkillId)
+{
+    for (int32 i = 0; i < SkillsArray.Num(); i++)
+    {
+        if (SkillsArray[i] && SkillsArray[i]->GetDefaultObject<ASkill>()->GetSkillId() == SkillId) return i;
+    }
+    return INDEX_NONE;
+}
+
+/*Same for GetSkillByType*/
+static ASkill* FindSkillByTypeLinear(const TArray<TSubclassOf<ASkill>>& SkillsArray, ESkillType SkillType)
+{
+    for (auto Skill : SkillsArray)
+    {
+        if (Skill && Skill->GetDefaultObject<ASkill>()->GetSkillType() == SkillType) return Skill->GetDefaultObject<ASkill>();
+    }
+    return nullptr;
+}
+
+bool USkillsTreeBenchmarkCommandlet::RunLookupScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries)
+{
+    //Enough rounds for stable percentiles
+    const int32 NumRounds = 16;
+    const int32 NumKeys = 64;
+
+    //Keeps the compiler from throwing the lookups away
+    volatile int32 Sink = 0;
+    volatile UPTRINT SkillSink = 0;
+
+    FRandomStream Random(Seed);
+
+    //The largest run needs as many classes as it has slots - the smaller runs use the first ones
+    int32 MaxSize = 0;
+    for (int32 Size : LookupSizes) MaxSize = FMath::Max(MaxSize, Size);
+
+    TArray<TSubclassOf<ASkill>> SkillClasses;
+    for (int32 i = 0; i < MaxSize; i++)
+    {
+        UClass* Class = MakeBenchmarkSkillClass(i);
+        Class->GetDefaultObject<ASkill>()->SkillId = FName(TEXT("BenchmarkSkillId"), i + 1);
+        SkillClasses.Add(Class);
+    }
+
+    USkillsComponent* SkillsComponent = NewObject<USkillsComponent>(GetTransientPackage());
+
+    TArray<TSharedPtr<FJsonValue>> Runs;
+    for (int32 Size : LookupSizes)
+    {
+        if (Size <= 0) continue;
+
+        //Only the last slot has the second type - the scan has to walk every slot to find it
+        TArray<TSubclassOf<ASkill>> Skills(SkillClasses.GetData(), Size);
+        for (int32 i = 0; i < Size; i++) Skills[i]->GetDefaultObject<ASkill>()->SkillType = (i == Size - 1) ? ESkillType::FileBall : ESkillType::WaterBall;
+        SkillsComponent->SetSkills(Skills);
+
+        //Tail keys make the scan walk (nearly) the whole array, misses walk all of it, random keys walk half of it on average
+        TArray<FName> TailKeys, MissKeys, RandomKeys;
+        for (int32 i = 0; i < NumKeys; i++)
+        {
+            TailKeys.Add(Skills[Size - 1 - i % FMath::Max(Size / 4, 1)]->GetDefaultObject<ASkill>()->GetSkillId());
+            MissKeys.Add(FName(TEXT("MissingSkill"), i + 1));
+            RandomKeys.Add(Skills[Random.RandHelper(Size)]->GetDefaultObject<ASkill>()->GetSkillId());
+        }
+
+        const TArray<FName>* KeySets[] = { &TailKeys, &MissKeys, &RandomKeys };
+        const TCHAR* KeySetNames[] = { TEXT("Tail"), TEXT("Miss"), TEXT("Random") };
+        const double NumLookups = (double)LookupIterations * NumKeys;
+
+        TSharedRef<FJsonObject> Run = MakeShareable(new FJsonObject());
+        Run->SetNumberField(TEXT("Skills"), Size);
+
+        for (int32 KeySet = 0; KeySet < ARRAY_COUNT(KeySets); KeySet++)
+        {
+            const TArray<FName>& Keys = *KeySets[KeySet];
+            FSkillsBenchmarkSeries LinearNs(FString::Printf(TEXT("LinearId%s%dNs"), KeySetNames[KeySet], Size));
+            FSkillsBenchmarkSeries IndexedNs(FString::Printf(TEXT("IndexedId%s%dNs"), KeySetNames[KeySet], Size));
+
+            for (int32 Round = 0; Round < NumRounds; Round++)
+            {
+                double Start = FPlatformTime::Seconds();
+                for (int32 i = 0; i < LookupIterations; i++)
+                {
+                    for (FName Key : Keys) Sink = Sink ^ FindSkillSlotByIdLinear(SkillsComponent->SkillsArray, Key);
+                }
+                LinearNs.Samples.Add((FPlatformTime::Seconds() - Start) * 1e9 / NumLookups);
+
+                Start = FPlatformTime::Seconds();
+                for (int32 i = 0; i < LookupIterations; i++)
+                {
+                    for (FName Key : Keys) Sink = Sink ^ SkillsComponent->GetSkillSlotById(Key);
+                }
+                IndexedNs.Samples.Add((FPlatformTime::Seconds() - Start) * 1e9 / NumLookups);
+            }
+
+            Run->SetNumberField(FString::Printf(TEXT("LinearId%sNs"), KeySetNames[KeySet]), LinearNs.GetPercentile(50.0));
+            Run->SetNumberField(FString::Printf(TEXT("IndexedId%sNs"), KeySetNames[KeySet]), IndexedNs.GetPercentile(50.0));
+
+            UE_LOG(LogSkillsTree, Display, TEXT("%d skills, %s ids: linear %.2f ns, indexed %.2f ns per lookup"), Size, KeySetNames[KeySet], LinearNs.GetPercentile(50.0), IndexedNs.GetPercentile(50.0));
+
+            OutSeries.Add(LinearNs);
+            OutSeries.Add(IndexedNs);
+        }
+
+        //GetSkillByType for the type of the last slot - the worst case of the old scan
+        {
+            FSkillsBenchmarkSeries LinearNs(FString::Printf(TEXT("LinearType%dNs"), Size));
+            FSkillsBenchmarkSeries IndexedNs(FString::Printf(TEXT("IndexedType%dNs"), Size));
+
+            for (int32 Round = 0; Round < NumRounds; Round++)
+            {
+                double Start = FPlatformTime::Seconds();
+                for (int32 i = 0; i < LookupIterations * NumKeys; i++) SkillSink = SkillSink ^ (UPTRINT)FindSkillByTypeLinear(SkillsComponent->SkillsArray, ESkillType::FileBall);
+                LinearNs.Samples.Add((FPlatformTime::Seconds() - Start) * 1e9 / NumLookups);
+
+                Start = FPlatformTime::Seconds();
+                for (int32 i = 0; i < LookupIterations * NumKeys; i++) SkillSink = SkillSink ^ (UPTRINT)SkillsComponent->GetSkillByType(ESkillType::FileBall);
+                IndexedNs.Samples.Add((FPlatformTime::Seconds() - Start) * 1e9 / NumLookups);
+            }
+
+            Run->SetNumberField(TEXT("LinearTypeNs"), LinearNs.GetPercentile(50.0));
+            Run->SetNumberField(TEXT("IndexedTypeNs"), IndexedNs.GetPercentile(50.0));
+
+            UE_LOG(LogSkillsTree, Display, TEXT("%d skills, tail type: linear %.2f ns, indexed %.2f ns per lookup"), Size, LinearNs.GetPercentile(50.0), IndexedNs.GetPercentile(50.0));
+
+            OutSeries.Add(LinearNs);
+            OutSeries.Add(IndexedNs);
+        }
+
+        Runs.Add(MakeShareable(new FJsonValueObject(Run)));
+    }
+
+    Report->SetArrayField(TEXT("Lookup"), Runs);
+    Report->SetNumberField(TEXT("KeysPerSet"), NumKeys);
+    Report->SetNumberField(TEXT("LookupIterations"), LookupIterations);
+    return true;
+}
+
+bool USkillsTreeBenchmarkCommandlet::RunPanelScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries)
+{
+    TArray<TSubclassOf<ASkill>> SkillClasses;
+    GetSkillClasses(SkillClasses);
+    if (SkillClasses.Num() == 0 || PanelSlots <= 0)
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("There are no skill classes to benchmark"));
+        return false;
+    }
+
+    TArray<TSubclassOf<ASkill>> Skills;
+    for (int32 i = 0; i < PanelSlots; i++) Skills.Add(SkillClasses[i % SkillClasses.Num()]);
+
+    USkillsComponent* SkillsComponent = NewObject<USkillsComponent>(GetTransientPackage());
+
+    //The points budget is designer data - enough for every slot to level up a few times
+    SkillsComponent->InitialAvailableSkillsPoints = PanelSlots * 4;
+
+    SkillsComponent->SetSkills(Skills);
+    SkillsComponent->OnSkillSlotChanged.AddDynamic(this, &USkillsTreeBenchmarkCommandlet::OnPanelSlotChanged);
+    SkillsComponent->OnSkillPointsChanged.AddDynamic(this, &USkillsTreeBenchmarkCommandlet::OnPanelPointsChanged);
+
+    FSkillsBenchmarkSeries PollMs(TEXT("PollMs"));
+    FSkillsBenchmarkSeries PushMs(TEXT("PushMs"));
+    FSkillsBenchmarkSeries Redraws(TEXT("Redraws"));
+
+    FRandomStream Random(Seed);
+    float ChangeAccumulator = 0.f;
+
+    //Keeps the compiler from throwing the polled values away
+    volatile UPTRINT Sink = 0;
+
+    for (int32 Frame = 0; Frame < NumWarmupFrames + NumFrames; Frame++)
+    {
+        ChangeAccumulator += PanelChangeRate * FixedDeltaTime;
+        for (; ChangeAccumulator >= 1.f; ChangeAccumulator -= 1.f)
+        {
+            const int32 SkillNum = Random.RandHelper(PanelSlots);
+            if (!SkillsComponent->CanLearnSkill(SkillNum)) SkillsComponent->ResetSkillPoints();
+            SkillsComponent->AdvanceSkillLevelAtSlot(SkillNum);
+        }
+
+        //What the property bindings of the panel did every frame - the texture came from the skill's default object
+        double Start = FPlatformTime::Seconds();
+        for (int32 i = 0; i < PanelSlots; i++)
+        {
+            ASkill* DefaultSkill = SkillsComponent->SkillsArray[i]->GetDefaultObject<ASkill>();
+            Sink = Sink ^ (UPTRINT)DefaultSkill->GetSkillTexture() ^ (UPTRINT)SkillsComponent->GetSkillLevel(i);
+        }
+        Sink = Sink ^ (UPTRINT)SkillsComponent->GetAvailableSkillPoints();
+        const double PollSeconds = FPlatformTime::Seconds() - Start;
+
+        //Notifications only go out for the slots which changed
+        NumPanelRedraws = 0;
+        Start = FPlatformTime::Seconds();
+        SkillsComponent->DeliverSkillNotifications();
+        const double PushSeconds = FPlatformTime::Seconds() - Start;
+
+        if (Frame < NumWarmupFrames) continue;
+
+        PollMs.Samples.Add(PollSeconds * 1000.0);
+        PushMs.Samples.Add(PushSeconds * 1000.0);
+        Redraws.Samples.Add(NumPanelRedraws);
+    }
+
+    Report->SetNumberField(TEXT("PanelSlots"), PanelSlots);
+    Report->SetNumberField(TEXT("PanelChanges"), PanelChangeRate);
+    Report->SetNumberField(TEXT("Frames"), NumFrames);
+
+    OutSeries = { PollMs, PushMs, Redraws };
+    return true;
+}
+
+bool USkillsTreeBenchmarkCommandlet::RunReplicationScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries)
+{
+    if (ReplicationPlayers <= 0 || PanelSlots <= 0)
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("The Replication scenario needs players and slots"));
+        return false;
+    }
+
+    const uint8 MaxLevel = (uint8)FMath::Clamp(ReplicationMaxLevel, 1, 255);
+
+    //What the server holds and what each owning client decoded - the bases are what the connections acknowledged
+    TArray<FSkillsState> ServerStates;
+    TArray<FSkillsState> ClientStates;
+    TArray<TSharedPtr<INetDeltaBaseState>> Bases;
+    ServerStates.SetNum(ReplicationPlayers);
+    ClientStates.SetNum(ReplicationPlayers);
+    Bases.SetNum(ReplicationPlayers);
+
+    for (FSkillsState& State : ServerStates)
+    {
+        State.Reset(PanelSlots, PanelSlots * 4);
+        State.LevelBits = (uint8)FMath::CeilLogTwo(MaxLevel + 1);
+    }
+
+    FSkillsBenchmarkSeries BitsPerUpdate(TEXT("BitsPerUpdate"));
+    FSkillsBenchmarkSeries BytesPerPlayerPerSecond(TEXT("BytesPerPlayerPerSecond"));
+    FSkillsBenchmarkSeries SerializeMs(TEXT("SerializeMs"));
+
+    FRandomStream Random(Seed);
+    TArray<float> ChangeAccumulators;
+    ChangeAccumulators.SetNumZeroed(ReplicationPlayers);
+    int32 NumMismatches = 0;
+    int32 FullUpdateBits = 0;
+
+    for (int32 Frame = 0; Frame < NumWarmupFrames + NumFrames; Frame++)
+    {
+        //Level ups and resets like the Panel scenario, for every player
+        for (int32 Player = 0; Player < ReplicationPlayers; Player++)
+        {
+            FSkillsState& State = ServerStates[Player];
+            for (ChangeAccumulators[Player] += PanelChangeRate * FixedDeltaTime; ChangeAccumulators[Player] >= 1.f; ChangeAccumulators[Player] -= 1.f)
+            {
+                const int32 SkillNum = Random.RandHelper(PanelSlots);
+                if (State.AvailablePoints <= 0 || State.Levels[SkillNum] >= MaxLevel) State.Reset(PanelSlots, PanelSlots * 4);
+
+                State.Levels[SkillNum]++;
+                State.AvailablePoints--;
+            }
+        }
+
+        int64 FrameBits = 0;
+        const double Start = FPlatformTime::Seconds();
+
+        for (int32 Player = 0; Player < ReplicationPlayers; Player++)
+        {
+            FBitWriter Writer(0, true);
+            TSharedPtr<INetDeltaBaseState> NewBase;
+
+            FNetDeltaSerializeInfo WriteParms;
+            WriteParms.Writer = &Writer;
+            WriteParms.OldState = Bases[Player].Get();
+            WriteParms.NewState = &NewBase;
+
+            //Nothing changed - nothing gets sent
+            if (!ServerStates[Player].NetDeltaSerialize(WriteParms)) continue;
+
+            if (!Bases[Player].IsValid() && FullUpdateBits == 0) FullUpdateBits = Writer.GetNumBits();
+            Bases[Player] = NewBase;
+            FrameBits += Writer.GetNumBits();
+
+            FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+            FNetDeltaSerializeInfo ReadParms;
+            ReadParms.Reader = &Reader;
+
+            ClientStates[Player].NetDeltaSerialize(ReadParms);
+            if (ClientStates[Player].Levels != ServerStates[Player].Levels || ClientStates[Player].AvailablePoints != ServerStates[Player].AvailablePoints) NumMismatches++;
+        }
+
+        const double SerializeSeconds = FPlatformTime::Seconds() - Start;
+
+        if (Frame < NumWarmupFrames) continue;
+
+        BitsPerUpdate.Samples.Add((double)FrameBits / ReplicationPlayers);
+        BytesPerPlayerPerSecond.Samples.Add((double)FrameBits / 8.0 / ReplicationPlayers / FixedDeltaTime);
+        SerializeMs.Samples.Add(SerializeSeconds * 1000.0);
+    }
+
+    if (NumMismatches > 0) UE_LOG(LogSkillsTree, Error, TEXT("%d decoded skill states did not match the server"), NumMismatches);
+
+    Report->SetNumberField(TEXT("Players"), ReplicationPlayers);
+    Report->SetNumberField(TEXT("Slots"), PanelSlots);
+    Report->SetNumberField(TEXT("MaxLevel"), MaxLevel);
+    Report->SetNumberField(TEXT("Changes"), PanelChangeRate);
+    Report->SetNumberField(TEXT("FullUpdateBits"), FullUpdateBits);
+    Report->SetNumberField(TEXT("Mismatches"), NumMismatches);
+    Report->SetNumberField(TEXT("Frames"), NumFrames);
+
+    OutSeries = { BitsPerUpdate, BytesPerPlayerPerSecond, SerializeMs };
+    return NumMismatches == 0;
+}
+
+bool USkillsTreeBenchmarkCommandlet::RunRewindScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries)
+{
+    if (NumCharacters <= 0 || RewindQueries <= 0)
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("The Rewind scenario needs characters and queries"));
+        return false;
+    }
+
+    FSkillLagCompensation LagCompensation;
+    LagCompensation.Init(NumCharacters, RewindFrames);
+
+    //Character sized capsules walking around a square the size of a small map
+    const float MapExtent = 5000.f;
+    FRandomStream Random(Seed);
+    TArray<UCapsuleComponent*> Capsules;
+    TArray<FVector> Velocities;
+
+    for (int32 i = 0; i < NumCharacters; i++)
+    {
+        UCapsuleComponent* Capsule = NewObject<UCapsuleComponent>(GetTransientPackage());
+        Capsule->AddToRoot();
+        Capsule->InitCapsuleSize(42.f, 96.f);
+        Capsule->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+        Capsule->SetWorldLocation(FVector(Random.FRandRange(-MapExtent, MapExtent), Random.FRandRange(-MapExtent, MapExtent), 96.f));
+
+        Capsules.Add(Capsule);
+        Velocities.Add(FVector(Random.FRandRange(-600.f, 600.f), Random.FRandRange(-600.f, 600.f), 0.f));
+        LagCompensation.Register(Capsule);
+    }
+
+    FSkillsBenchmarkSeries RecordMs(TEXT("RecordMs"));
+    FSkillsBenchmarkSeries RewindMs(TEXT("RewindMs"));
+    FSkillsBenchmarkSeries Overlaps(TEXT("Overlaps"));
+
+    TArray<int32, TInlineAllocator<8>> Slots;
+    float Time = 0.f;
+
+    for (int32 Frame = 0; Frame < NumWarmupFrames + NumFrames; Frame++)
+    {
+        Time += FixedDeltaTime;
+
+        for (int32 i = 0; i < Capsules.Num(); i++)
+        {
+            FVector Location = Capsules[i]->GetComponentLocation() + Velocities[i] * FixedDeltaTime;
+            if (FMath::Abs(Location.X) > MapExtent) Velocities[i].X = -Velocities[i].X;
+            if (FMath::Abs(Location.Y) > MapExtent) Velocities[i].Y = -Velocities[i].Y;
+            Capsules[i]->SetWorldLocation(Location);
+        }
+
+        double Start = FPlatformTime::Seconds();
+        LagCompensation.Record(Time);
+        const double RecordSeconds = FPlatformTime::Seconds() - Start;
+
+        //Projectiles near a random capsule, rewound by a random ping
+        int32 NumOverlaps = 0;
+        Start = FPlatformTime::Seconds();
+        for (int32 Query = 0; Query < RewindQueries; Query++)
+        {
+            const FVector Target = Capsules[Random.RandHelper(Capsules.Num())]->GetComponentLocation() + Random.VRand() * 150.f;
+            Slots.Reset();
+            NumOverlaps += LagCompensation.OverlapSphere(Time - Random.FRandRange(0.f, 0.3f), Target, 20.f, Slots);
+        }
+        const double RewindSeconds = FPlatformTime::Seconds() - Start;
+
+        if (Frame < NumWarmupFrames) continue;
+
+        RecordMs.Samples.Add(RecordSeconds * 1000.0);
+        RewindMs.Samples.Add(RewindSeconds * 1000.0);
+        Overlaps.Samples.Add(NumOverlaps);
+    }
+
+    for (UCapsuleComponent* Capsule : Capsules) Capsule->RemoveFromRoot();
+
+    Report->SetNumberField(TEXT("Capsules"), NumCharacters);
+    Report->SetNumberField(TEXT("QueriesPerFrame"), RewindQueries);
+    Report->SetNumberField(TEXT("HistoryFrames"), RewindFrames);
+    Report->SetNumberField(TEXT("HistoryBytes"), (double)LagCompensation.GetAllocatedSize());
+    Report->SetNumberField(TEXT("Frames"), NumFrames);
+
+    OutSeries = { RecordMs, RewindMs, Overlaps };
+    return true;
+}
+
+void USkillsTreeBenchmarkCommandlet::OnPanelSlotChanged(int32 SkillNum, int32 NewLevel)
+{
+    NumPanelRedraws++;
+}
+
+void USkillsTreeBenchmarkCommandlet::OnPanelPointsChanged(int32 AvailablePoints)
+{
+    NumPanelRedraws++;
+}
+
+UWorld* USkillsTreeBenchmarkCommandlet::CreateBenchmarkWorld()
+{
+    UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("SkillsTreeBenchmark"));
+    if (!World)
+    {
+        UE_LOG(LogSkillsTree, Error, TEXT("Could not create the benchmark world"));
+        return nullptr;
+    }
+
+    FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+    WorldContext.SetCurrentWorld(World);
+
+    const FURL URL;
+    World->SetGameMode(URL);
+    World->InitializeActorsForPlay(URL);
+    World->BeginPlay();
+    return World;
+}
+
+void USkillsTreeBenchmarkCommandlet::DestroyBenchmarkWorld(UWorld* World)
+{
+    World->BeginTearingDown();
+    World->DestroyWorld(false);
+    GEngine->DestroyWorldContext(World);
+    CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+bool USkillsTreeBenchmarkCommandlet::WriteReports(const FString& OutputPath, TSharedRef<FJsonObject> Report, const TArray<FSkillsBenchmarkSeries>& Series) const
+{
+    IFileManager::Get().MakeDirectory(*FPaths::GetPath(OutputPath), true);
+
+    TSharedRef<FJsonObject> Metrics = MakeShareable(new FJsonObject());
+    for (const FSkillsBenchmarkSeries& It : Series) Metrics->SetObjectField(It.Name, It.ToJson());
+    Report->SetObjectField(TEXT("Metrics"), Metrics);
+
+    FString Json;
+    TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+    FJsonSerializer::Serialize(Report, Writer);
+
+    //One row per frame, one column per series
+    FString Csv = TEXT("Frame");
+    int32 NumRows = 0;
+    for (const FSkillsBenchmarkSeries& It : Series)
+    {
+        Csv += TEXT(",") + It.Name;
+        NumRows = FMath::Max(NumRows, It.Samples.Num());
+    }
+    Csv += LINE_TERMINATOR;
+
+    for (int32 Row = 0; Row < NumRows; Row++)
+    {
+        Csv += FString::FromInt(Row);
+        for (const FSkillsBenchmarkSeries& It : Series)
+        {
+            Csv += It.Samples.IsValidIndex(Row) ? FString::Printf(TEXT(",%.4f"), It.Samples[Row]) : TEXT(",");
+        }
+        Csv += LINE_TERMINATOR;
+    }
+
+    const bool bSaved = FFileHelper::SaveStringToFile(Json, *(OutputPath + TEXT(".json"))) && FFileHelper::SaveStringToFile(Csv, *(OutputPath + TEXT(".csv")));
+    if (bSaved) UE_LOG(LogSkillsTree, Display, TEXT("Wrote the benchmark reports to %s.json/.csv"), *OutputPath);
+    else UE_LOG(LogSkillsTree, Error, TEXT("Could not write the benchmark reports to %s"), *OutputPath);
+
+    return bSaved;
+}
@@ -0,0 +1,233 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "Dom/JsonObject.h"
+#include "SkillsTreeBenchmarkCommandlet.generated.h"
+
+/*Collects one value per frame and reduces it to the numbers we compare between runs*/
+struct FSkillsBenchmarkSeries
+{
+	FString Name;
+
+	TArray<double> Samples;
+
+	FSkillsBenchmarkSeries() {}
+	FSkillsBenchmarkSeries(const FString& InName) : Name(InName) {}
+
+	/*Returns the nearest rank percentile (0-100) of the samples*/
+	double GetPercentile(double Percentile) const;
+
+	/*Returns mean, p50, p90, p99 and max as a json object*/
+	TSharedRef<FJsonObject> ToJson() const;
+};
+
+/*Headless load benchmark of the skills tree.
+
+Run it from the editor binary so it works without a window:
+	UE4Editor SkillsTree.uproject -run=SkillsTreeBenchmark -nullrhi -unattended -Scenario=Load -Characters=200 -Frames=3000
+
+Every scenario uses a fixed delta time and a seeded random stream so two runs do the same work,
+the reports (json summary + csv with one row per frame) can be diffed between commits.
+Pass -Label=<commit> to tag the reports, -Output=<path without extension> to choose where they go*/
+UCLASS(Config = Game)
+class SKILLSTREE_API USkillsTreeBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USkillsTreeBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	/*The character which gets spawned by the scenarios - needs skills in its skills component (-CharacterClass=)*/
+	UPROPERTY(Config)
+	FStringClassReference CharacterClass;
+
+	/*The amount of characters spawned by the scenarios (-Characters=)*/
+	UPROPERTY(Config)
+	int32 NumCharacters = 100;
+
+	/*Measured frames (-Frames=)*/
+	UPROPERTY(Config)
+	int32 NumFrames = 1800;
+
+	/*Frames which run before measuring so pools and caches are warm (-WarmupFrames=)*/
+	UPROPERTY(Config)
+	int32 NumWarmupFrames = 120;
+
+	/*The fixed delta time of every frame (-DeltaTime=)*/
+	UPROPERTY(Config)
+	float FixedDeltaTime = 1.f / 60.f;
+
+	/*Shots per character per second (-FireRate=)*/
+	UPROPERTY(Config)
+	float FireRate = 2.f;
+
+	/*Level ups per character per second (-LevelRate=)*/
+	UPROPERTY(Config)
+	float LevelUpRate = 0.5f;
+
+	/*Skill point resets per character per second (-ResetRate=)*/
+	UPROPERTY(Config)
+	float ResetRate = 0.05f;
+
+	/*Runs a full garbage collection every GCInterval frames and measures the pause (-GCInterval=)*/
+	UPROPERTY(Config)
+	int32 GCInterval = 300;
+
+	/*Seed of the random streams of the scenarios (-Seed=)*/
+	UPROPERTY(Config)
+	int32 Seed = 1234;
+
+	/*The amount of skills in the slot table for each run of the Lookup scenario (-LookupSizes=8,64,512)*/
+	UPROPERTY(Config)
+	TArray<int32> LookupSizes;
+
+	/*Passes over each key set of each run of the Lookup scenario (-LookupIterations=)*/
+	UPROPERTY(Config)
+	int32 LookupIterations = 2000;
+
+	/*The amount of projectiles in flight for each run of the Sweeps scenario (-SweepCounts=1000,5000,10000)*/
+	UPROPERTY(Config)
+	TArray<int32> SweepCounts;
+
+	/*The amount of characters scattered among the projectiles of the Sweeps scenario (-SweepTargets=)*/
+	UPROPERTY(Config)
+	int32 SweepTargets = 1000;
+
+	/*The amount of slots of the skill panel of the Panel scenario (-PanelSlots=)*/
+	UPROPERTY(Config)
+	int32 PanelSlots = 256;
+
+	/*Level ups per second of the Panel scenario (-PanelChanges=)*/
+	UPROPERTY(Config)
+	float PanelChangeRate = 2.f;
+
+	/*The amount of connected players of the Replication scenario (-Players=)*/
+	UPROPERTY(Config)
+	int32 ReplicationPlayers = 64;
+
+	/*The highest skill level of the Replication scenario - decides the bits per level (-MaxLevel=)*/
+	UPROPERTY(Config)
+	int32 ReplicationMaxLevel = 5;
+
+	/*Hit checks per frame of the Rewind scenario, against NumCharacters capsules (-RewindQueries=)*/
+	UPROPERTY(Config)
+	int32 RewindQueries = 2000;
+
+	/*Frames of capsule history of the Rewind scenario (-RewindFrames=)*/
+	UPROPERTY(Config)
+	int32 RewindFrames = 64;
+
+	/*The amount of characters of the Targets scenario (-Targets=)*/
+	UPROPERTY(Config)
+	int32 TargetCount = 1000;
+
+	/*Queries per frame and kind of the Targets scenario - one per projectile (-TargetQueries=)*/
+	UPROPERTY(Config)
+	int32 TargetQueries = 5000;
+
+	/*The radius of the queries of the Targets scenario (-TargetRadius=)*/
+	UPROPERTY(Config)
+	float TargetQueryRadius = 500.f;
+
+	/*The amount of targets each nearest query of the Targets scenario looks for (-Nearest=)*/
+	UPROPERTY(Config)
+	int32 TargetNearest = 4;
+
+	/*The amount of players of the Profiles scenario (-Profiles=)*/
+	UPROPERTY(Config)
+	int32 ProfileCount = 100000;
+
+	/*Saves and loads per measured batch of the Profiles scenario (-ProfileBatch=)*/
+	UPROPERTY(Config)
+	int32 ProfileBatch = 1000;
+
+	/*The amount of projectiles fired during a run of the Replay scenario (-ReplayProjectiles=)*/
+	UPROPERTY(Config)
+	int32 ReplayProjectiles = 2000;
+
+	/*The simulated seconds of a run of the Replay scenario - keep it below the lifetime of the skill (-ReplaySeconds=)*/
+	UPROPERTY(Config)
+	float ReplaySeconds = 2.f;
+
+	/*The fixed step the Replay scenario runs the batched simulation with (-ReplayStep=)*/
+	UPROPERTY(Config)
+	float ReplayFixedStep = 1.f / 60.f;
+
+	/*The caster which gets spawned by the Crowd scenario - casters without skills get the ones of CharacterClass (-CasterClass=)*/
+	UPROPERTY(Config)
+	FStringClassReference CrowdCasterClass;
+
+	/*The amount of crowd casters of the Crowd scenario, split in two teams (-Casters=)*/
+	UPROPERTY(Config)
+	int32 CrowdCasterCount = 2000;
+
+	/*The distance between two casters of a team in the Crowd scenario (-CrowdSpacing=)*/
+	UPROPERTY(Config)
+	float CrowdSpacing = 300.f;
+
+private:
+	/*Spawns characters and drives Fire, AdvanceSkillLevel and ResetSkillPoints*/
+	bool RunLoadScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries);
+
+	/*Builds a USkillsComponent with SetSkills for every size and times GetSkillSlotById and GetSkillByType against the scan over
+	the default objects of SkillsArray they replaced, for ids at the tail, misses and random ids*/
+	bool RunLookupScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries);
+
+	/*Compares a skill panel which polls every slot each frame against one which listens to the change notifications*/
+	bool RunPanelScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries);
+
+	/*Serializes the skill state of many players like a server would and decodes it like their clients would*/
+	bool RunReplicationScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries);
+
+	/*Records moving capsules into the lag compensation history and rewinds sphere checks against it*/
+	bool RunRewindScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries);
+
+	/*Compares radius and nearest queries of the skill target grid against overlaps of the physics scene*/
+	bool RunTargetsScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries);
+
+	/*Saves many skill profiles to a fresh profile store, reopens it and loads them back*/
+	bool RunProfilesScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries);
+
+	/*Spawns two teams of crowd casters facing each other and lets the world's crowd fight it out*/
+	bool RunCrowdScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries);
+
+	/*Keeps a fixed amount of batched projectiles in flight among characters, with synchronous then async sweeps*/
+	bool RunSweepsScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries);
+
+	/*Moves characters with the data-only muzzle offset, then the same characters with the spawn spring arms they used to carry*/
+	bool RunMuzzleScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries);
+
+	/*Fires the same seeded projectiles with the fixed step simulation at a steady then a jittered frame rate and compares where they end up*/
+	bool RunReplayScenario(TSharedRef<FJsonObject> Report, TArray<FSkillsBenchmarkSeries>& OutSeries);
+
+	/*The listener of the Panel scenario - stands in for a widget redraw*/
+	UFUNCTION()
+	void OnPanelSlotChanged(int32 SkillNum, int32 NewLevel);
+
+	UFUNCTION()
+	void OnPanelPointsChanged(int32 AvailablePoints);
+
+	/*Creates an empty game world which ticks like the real thing - returns null on failure*/
+	UWorld* CreateBenchmarkWorld();
+
+	void DestroyBenchmarkWorld(UWorld* World);
+
+	/*Writes <OutputPath>.json and <OutputPath>.csv*/
+	bool WriteReports(const FString& OutputPath, TSharedRef<FJsonObject> Report, const TArray<FSkillsBenchmarkSeries>& Series) const;
+
+	/*Overrides the config defaults with the command line switches*/
+	void ParseParams(const FString& Params);
+
+	FString Scenario;
+
+	FString Label;
+
+	/*Redraws of the Panel scenario*/
+	int32 NumPanelRedraws = 0;
+};
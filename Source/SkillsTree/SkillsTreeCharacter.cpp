@@ -7,7 +7,13 @@
 #include "Components/InputComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h"
+#include "GameFramework/PlayerState.h"
 #include "GameFramework/SpringArmComponent.h"
+#include "SkillsTree.h"
+#include "SkillsWorldManager.h"
+#include "SkillProfileStore.h"
+#include "SkillsTreeStats.h"
+#include "Misc/CoreDelegates.h"
 
 //////////////////////////////////////////////////////////////////////////
 // ASkillsTreeCharacter
@@ -49,21 +55,8 @@ ASkillsTreeCharacter::ASkillsTreeCharacter()
 
 	// ---- Skill code
 	// ---------------------
-	//Create the root component for our spring arms
-	SkillsRootComp = CreateDefaultSubobject<USceneComponent>(FName("SkillsRootComp"));
-
-	//Attach it to our root
-	SkillsRootComp->SetupAttachment(RootComponent);
-
-	//Create the spring arm components and attach them to their root
-	LevelOneSpringArm = CreateDefaultSubobject<USpringArmComponent>(FName("LevelOneSpringArm"));
-	LevelTwoSpringArm = CreateDefaultSubobject<USpringArmComponent>(FName("LevelTwoSpringArm"));
-	LevelThreeSpringArm = CreateDefaultSubobject<USpringArmComponent>(FName("LevelThreeSpringArm"));
-
-
-	LevelOneSpringArm->SetupAttachment(SkillsRootComp);
-	LevelTwoSpringArm->SetupAttachment(SkillsRootComp);
-	LevelThreeSpringArm->SetupAttachment(SkillsRootComp);
+	//Skills spawn in front of the character - the muzzle is plain data, no components needed
+	MuzzleOffset = FTransform(FVector(100.f, 0.f, 0.f));
 
 	//Initializing the skills component
 	SkillsComponent = CreateDefaultSubobject<USkillsComponent>(FName("SkillsComponent"));
@@ -157,68 +150,274 @@ void ASkillsTreeCharacter::MoveRight(float Value)
 	}
 }
 
-FTransform ASkillsTreeCharacter::GetFixedSpringArmTransform(USpringArmComponent* SpringArm)
+FTransform ASkillsTreeCharacter::GetMuzzleTransform(int32 SkillNum) const
 {
-	FTransform result;
-	if (SpringArm)
+	//Skills may bring their own muzzle offset, otherwise we use the character's one
+	const FSkillSlotInfo* Info = SkillsComponent->GetSkillSlotInfo(SkillNum);
+	const FTransform& Offset = (Info && Info->bOverrideMuzzleOffset) ? Info->MuzzleOffset : MuzzleOffset;
+
+	return Offset * GetActorTransform();
+}
+
+void ASkillsTreeCharacter::Fire(bool bShouldFireSecondary)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SkillsFire);
+
+	const int32 SkillNum = GetFireSkillNum(bShouldFireSecondary);
+	if (!SkillsComponent->SkillsArray.IsValidIndex(SkillNum)) return;
+
+	if (HasAuthority())
 	{
-		result = SpringArm->GetComponentTransform();
-		//We want a fixed location for our transform, since we don't want to spawn our skills
-		//right on top of our character.
-		result.SetLocation(result.GetLocation() + SpringArm->GetForwardVector() * 100);
+		FireAuthoritative(SkillNum, 0);
+		return;
 	}
-	return result;
+
+	//Shots the server would reject don't get predicted or sent - the server checks again with its own clock
+	if (!SkillsComponent->TryCastSkill(SkillNum, GetWorld()->GetTimeSeconds())) return;
+
+	//Keys wrap around but skip 0, which marks volleys nobody predicted
+	if (++LastPredictionKey == 0) LastPredictionKey = 1;
+
+	FPredictedSkillVolley& Prediction = PredictedVolleys[PredictedVolleys.AddDefaulted()];
+	Prediction.FireTime = FPlatformTime::Seconds();
+	Prediction.Volley = MakeVolley(SkillNum, SkillsComponent->GetSkillLevel(SkillNum));
+	Prediction.Volley.PredictionKey = LastPredictionKey;
+
+	//Our projectiles show up right away - the server's volley corrects them once it arrives
+	if (bPredictSkills && Prediction.Volley.Level > 0)
+	{
+		FireVolley(Prediction.Volley, true, &Prediction);
+		VisibleFireTimes.Add(Prediction.FireTime);
+		if (!EndFrameHandle.IsValid()) EndFrameHandle = FCoreDelegates::OnEndFrame.AddUObject(this, &ASkillsTreeCharacter::SampleInputToVisible);
+	}
+
+	ServerFire(bShouldFireSecondary, LastPredictionKey, Prediction.Volley.Seed);
 }
 
-void ASkillsTreeCharacter::Fire(bool bShouldFireSecondary)
+int32 ASkillsTreeCharacter::GetFireSkillNum(bool bShouldFireSecondary) const
 {
 	//This is a dummy logic - we will only have 2 skills for this post
-	TSubclassOf<ASkill> SkillBP = (bShouldFireSecondary && SkillsComponent->SkillsArray.IsValidIndex(1)) ? SkillsComponent->SkillsArray[1] : SkillsComponent->SkillsArray[0];
+	return (bShouldFireSecondary && SkillsComponent->SkillsArray.IsValidIndex(1)) ? 1 : 0;
+}
 
-	if (SkillBP)
+void ASkillsTreeCharacter::FireAuthoritative(int32 SkillNum, uint16 PredictionKey, uint16 PredictedSeed)
+{
+	//The level lives in our skills component - every character has its own levels
+	const int32 SkillLevel = SkillsComponent->GetSkillLevel(SkillNum);
+	const float Tolerance = IsLocallyControlled() ? 0.f : RemoteCastTolerance;
+	if (SkillLevel <= 0 || !SkillsComponent->TryCastSkill(SkillNum, GetWorld()->GetTimeSeconds(), Tolerance))
 	{
-		FActorSpawnParameters ActorSpawnParams;
+		if (PredictionKey != 0) ClientRejectVolley(PredictionKey);
+		return;
+	}
 
-		TArray<FTransform> SpawnTransforms = GetSpawnTransforms(SkillBP->GetDefaultObject<ASkill>()->GetLevel());
+	FSkillVolley Volley = MakeVolley(SkillNum, SkillLevel);
+	Volley.PredictionKey = PredictionKey;
 
-		for (int32 i = 0; i < SpawnTransforms.Num(); i++)
-		{	
-			GetWorld()->SpawnActor<ASkill>(SkillBP, SpawnTransforms[i]);
-		}
+	//The owner already drew the spread of its prediction - a new seed would move every jittered projectile
+	if (PredictionKey != 0) Volley.Seed = PredictedSeed;
+
+	//Remote shooters saw everyone else a one way trip ago
+	const float LagCompensationTime = (!IsLocallyControlled() && PlayerState) ? PlayerState->ExactPing * 0.0005f : 0.f;
+	FireVolley(Volley, false, nullptr, LagCompensationTime);
+
+	if (GetNetMode() != NM_Standalone) MulticastFireVolley(Volley);
+}
+
+void ASkillsTreeCharacter::ServerFire_Implementation(bool bShouldFireSecondary, uint16 PredictionKey, uint16 Seed)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SkillsFire);
+
+	const int32 SkillNum = GetFireSkillNum(bShouldFireSecondary);
+	if (SkillsComponent->SkillsArray.IsValidIndex(SkillNum)) FireAuthoritative(SkillNum, PredictionKey, Seed);
+	else if (PredictionKey != 0) ClientRejectVolley(PredictionKey);
+}
+
+bool ASkillsTreeCharacter::ServerFire_Validate(bool bShouldFireSecondary, uint16 PredictionKey, uint16 Seed)
+{
+	return true;
+}
+
+void ASkillsTreeCharacter::MulticastFireVolley_Implementation(const FSkillVolley& Volley)
+{
+	//The server already fired the real projectiles
+	if (HasAuthority()) return;
+
+	if (Volley.PredictionKey != 0 && IsLocallyControlled()) ReconcileVolley(Volley);
+	else FireVolley(Volley, true);
+}
+
+void ASkillsTreeCharacter::ClientRejectVolley_Implementation(uint16 PredictionKey)
+{
+	const int32 Index = PredictedVolleys.IndexOfByPredicate([PredictionKey](const FPredictedSkillVolley& It) { return It.Volley.PredictionKey == PredictionKey; });
+	if (Index == INDEX_NONE) return;
+
+	RollbackVolley(PredictedVolleys[Index]);
+	PredictedVolleys.RemoveAtSwap(Index);
+}
+
+void ASkillsTreeCharacter::ReconcileVolley(const FSkillVolley& Volley)
+{
+	//Predictions which timed out already showed the shot
+	const int32 Index = PredictedVolleys.IndexOfByPredicate([&Volley](const FPredictedSkillVolley& It) { return It.Volley.PredictionKey == Volley.PredictionKey; });
+	if (Index == INDEX_NONE) return;
+
+	FPredictedSkillVolley& Prediction = PredictedVolleys[Index];
+	Prediction.ConfirmTime = FPlatformTime::Seconds();
+	SET_FLOAT_STAT(STAT_SkillsVolleyRoundTripMs, (Prediction.ConfirmTime - Prediction.FireTime) * 1000.0);
+
+	//Nothing predicted - the shot only becomes visible now
+	if (Prediction.Skills.Num() == 0)
+	{
+		FireVolley(Volley, true);
+		VisibleFireTimes.Add(Prediction.FireTime);
+		if (!EndFrameHandle.IsValid()) EndFrameHandle = FCoreDelegates::OnEndFrame.AddUObject(this, &ASkillsTreeCharacter::SampleInputToVisible);
+		PredictedVolleys.RemoveAtSwap(Index);
+		return;
+	}
+
+	//The server fired something else (our level was stale) - replace the prediction with the real volley
+	if (Prediction.Volley.SkillNum != Volley.SkillNum || Prediction.Volley.Level != Volley.Level)
+	{
+		RollbackVolley(Prediction);
+		FireVolley(Volley, true);
+		PredictedVolleys.RemoveAtSwap(Index);
+		return;
+	}
 
+	//Our projectiles flew since the input - they continue on the server's paths from there
+	FSkillSpawnTransforms AuthoritativeTransforms;
+	SkillsComponent->GetSpawnTransforms(Volley, (float)(Prediction.ConfirmTime - Prediction.FireTime), AuthoritativeTransforms);
+
+	const float MaxErrorSq = FMath::Square(MaxPredictionError);
+	Prediction.Errors.SetNumZeroed(Prediction.Skills.Num());
+
+	for (int32 i = 0; i < Prediction.Skills.Num() && i < AuthoritativeTransforms.Num(); i++)
+	{
+		ASkill* Skill = Prediction.Skills[i].Get();
+		if (!Skill || !Skill->IsSkillActive() || Skill->GetPredictionKey() != Volley.PredictionKey) continue;
+
+		//Small errors get hidden by the blend, large ones would look like the projectile slides sideways
+		const FVector Error = Skill->CorrectPrediction(AuthoritativeTransforms[i]);
+		Prediction.Errors[i] = (Error.SizeSquared() <= MaxErrorSq) ? Error : FVector::ZeroVector;
+		Skill->SetVisualOffset(Prediction.Errors[i]);
 	}
 }
 
-TArray<FTransform> ASkillsTreeCharacter::GetSpawnTransforms(int32 level)
+void ASkillsTreeCharacter::SampleInputToVisible()
 {
+	//The projectiles got placed during this frame - they are on screen once the frame we end here is drawn
+	const double Now = FPlatformTime::Seconds();
+	for (double FireTime : VisibleFireTimes)
+	{
+		SET_FLOAT_STAT(STAT_SkillsInputToVisibleMs, (Now - FireTime) * 1000.0);
+		UE_LOG(LogSkillsTree, Verbose, TEXT("%s: input to visible %.1f ms"), *GetName(), (Now - FireTime) * 1000.0);
+	}
+	VisibleFireTimes.Reset();
 
-	TArray<FTransform> SpawnPoints;
-	switch (level)
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	EndFrameHandle.Reset();
+}
+
+void ASkillsTreeCharacter::RollbackVolley(FPredictedSkillVolley& Prediction)
+{
+	INC_DWORD_STAT(STAT_SkillsMispredictions);
+
+	for (const TWeakObjectPtr<ASkill>& It : Prediction.Skills)
 	{
-		case 1:
-		{
-			SpawnPoints.Add(GetFixedSpringArmTransform(LevelOneSpringArm));
-			break; 
-		}
-		case 2:
+		//Pooled skills may already fly for another shot
+		ASkill* Skill = It.Get();
+		if (Skill && Skill->IsSkillActive() && Skill->GetPredictionKey() == Prediction.Volley.PredictionKey) Skill->ReleaseSkill();
+	}
+	Prediction.Skills.Reset();
+}
+
+void ASkillsTreeCharacter::BeginPlay()
+{
+	Super::BeginPlay();
+
+	ASkillsWorldManager* SkillsManager = ASkillsWorldManager::Get(this);
+	if (!SkillsManager) return;
+
+	//Only servers keep a history - clients get INDEX_NONE
+	LagCompensationHandle = SkillsManager->RegisterLagCompensatedCapsule(GetCapsuleComponent());
+	SkillTargetHandle = SkillsManager->RegisterSkillTarget(this);
+	RegisteredManager = SkillsManager;
+}
+
+void ASkillsTreeCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	//Not Get - that would spawn a manager while the world tears down
+	ASkillsWorldManager* SkillsManager = RegisteredManager.Get();
+	if (SkillsManager && LagCompensationHandle != INDEX_NONE) SkillsManager->UnregisterLagCompensatedCapsule(LagCompensationHandle);
+	if (SkillsManager && SkillTargetHandle != INDEX_NONE) SkillsManager->UnregisterSkillTarget(SkillTargetHandle);
+	LagCompensationHandle = INDEX_NONE;
+	SkillTargetHandle = INDEX_NONE;
+
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	EndFrameHandle.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ASkillsTreeCharacter::PossessedBy(AController* NewController)
+{
+	Super::PossessedBy(NewController);
+
+	//Players without an online id (ie PIE without a subsystem) play with a fresh tree
+	APlayerState* NewPlayerState = NewController ? NewController->PlayerState : nullptr;
+	if (NewPlayerState && NewPlayerState->UniqueId.IsValid())
+	{
+		SkillsComponent->BindSkillProfile(FSkillProfileStore::MakeKey(NewPlayerState->UniqueId->ToString()));
+	}
+}
+
+void ASkillsTreeCharacter::PawnClientRestart()
+{
+	Super::PawnClientRestart();
+
+	//The skill panel draws the icons of the pawn we control - possession may come after the component's BeginPlay
+	SkillsComponent->RequestSkillIcons();
+}
+
+void ASkillsTreeCharacter::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (PredictedVolleys.Num() == 0) return;
+
+	const double Now = FPlatformTime::Seconds();
+
+	for (int32 i = PredictedVolleys.Num() - 1; i >= 0; i--)
+	{
+		FPredictedSkillVolley& Prediction = PredictedVolleys[i];
+
+		if (Prediction.ConfirmTime == 0.0)
 		{
-			SpawnPoints.Add(GetFixedSpringArmTransform(LevelTwoSpringArm));
-			SpawnPoints.Add(GetFixedSpringArmTransform(LevelThreeSpringArm));
-			break;
+			//The volley got lost - the predicted projectiles simply fly on
+			if (Now - Prediction.FireTime > PredictionTimeout) PredictedVolleys.RemoveAtSwap(i);
+			continue;
 		}
-		case 3:
+
+		const float Alpha = (PredictionBlendTime > 0.f) ? FMath::Clamp(1.f - (float)(Now - Prediction.ConfirmTime) / PredictionBlendTime, 0.f, 1.f) : 0.f;
+
+		for (int32 j = 0; j < Prediction.Skills.Num() && j < Prediction.Errors.Num(); j++)
 		{
-			SpawnPoints.Add(GetFixedSpringArmTransform(LevelOneSpringArm));
-			SpawnPoints.Add(GetFixedSpringArmTransform(LevelTwoSpringArm));
-			SpawnPoints.Add(GetFixedSpringArmTransform(LevelThreeSpringArm));
+			ASkill* Skill = Prediction.Skills[j].Get();
+			if (Skill && Skill->IsSkillActive() && Skill->GetPredictionKey() == Prediction.Volley.PredictionKey) Skill->SetVisualOffset(Prediction.Errors[j] * Alpha);
 		}
-		default:
-			// break;
-			// for tests
-			SpawnPoints.Add(GetFixedSpringArmTransform(LevelOneSpringArm));
-			SpawnPoints.Add(GetFixedSpringArmTransform(LevelTwoSpringArm));
-			SpawnPoints.Add(GetFixedSpringArmTransform(LevelThreeSpringArm));
-			break;
+
+		if (Alpha <= 0.f) PredictedVolleys.RemoveAtSwap(i);
 	}
-	return SpawnPoints;
+}
+
+FSkillVolley ASkillsTreeCharacter::MakeVolley(int32 SkillNum, int32 Level) const
+{
+	return SkillsComponent->MakeVolley(SkillNum, Level, GetMuzzleTransform(SkillNum));
+}
+
+void ASkillsTreeCharacter::FireVolley(const FSkillVolley& Volley, bool bCosmetic, FPredictedSkillVolley* Prediction, float LagCompensationTime)
+{
+	//Predictions start at the muzzle - everything else catches up with the server's projectiles
+	SkillsComponent->FireVolley(Volley, Prediction ? 0.f : SkillsComponent->GetVolleyCatchUpTime(Volley, MaxVolleyCatchUp), bCosmetic, Prediction, LagCompensationTime);
 }
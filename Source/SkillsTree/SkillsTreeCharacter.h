@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "SkillsComponent.h"
+#include "SkillVolley.h"
 #include "SkillsTreeCharacter.generated.h"
 
 UCLASS(config=Game)
@@ -82,31 +83,114 @@ public:
 
 private:
 
-	/*Returns a fixed transform based on the given spring arm comp*/
-	FTransform GetFixedSpringArmTransform(USpringArmComponent* SpringArm);
+	/*Returns the world transform which the spawn pattern of the given skill's index is relative to*/
+	FTransform GetMuzzleTransform(int32 SkillNum) const;
 
-	/*Returns an array of transform in order to determine how many skills will get spawned*/
-	TArray<FTransform> GetSpawnTransforms(int32 level);
+	/*Returns the skill's index Fire uses*/
+	int32 GetFireSkillNum(bool bShouldFireSecondary) const;
+
+	/*Returns the volley the given skill's index fires from the current muzzle*/
+	FSkillVolley MakeVolley(int32 SkillNum, int32 Level) const;
+
+	/*Fires the real projectiles and tells the clients - server only. Predicted volleys keep the spread seed the client fired with*/
+	void FireAuthoritative(int32 SkillNum, uint16 PredictionKey, uint16 PredictedSeed = 0);
+
+	/*Spawns the projectiles of a volley - cosmetic volleys never apply damage. Predicted volleys get their projectiles tagged and collected.
+	Projectiles with a LagCompensationTime get their hits checked against where the shooter saw its targets*/
+	void FireVolley(const FSkillVolley& Volley, bool bCosmetic, FPredictedSkillVolley* Prediction = nullptr, float LagCompensationTime = 0.f);
+
+	/*Matches the server's volley to our prediction and moves the predicted projectiles onto the server's paths*/
+	void ReconcileVolley(const FSkillVolley& Volley);
+
+	/*Removes the projectiles of a prediction the server did not confirm*/
+	void RollbackVolley(FPredictedSkillVolley& Prediction);
+
+	/*Clients fire through the server - the server is the only one which applies hits*/
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerFire(bool bShouldFireSecondary, uint16 PredictionKey, uint16 Seed);
+
+	/*One RPC per shot instead of an actor channel per projectile - clients rebuild the volley locally*/
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastFireVolley(const FSkillVolley& Volley);
+
+	/*The server could not fire the predicted volley*/
+	UFUNCTION(Client, Reliable)
+	void ClientRejectVolley(uint16 PredictionKey);
+
+	/*Volleys we fired on this client and the server didn't confirm yet, or whose correction is still blending*/
+	TArray<FPredictedSkillVolley> PredictedVolleys;
+
+	/*The key of the last predicted volley - 0 is never used*/
+	uint16 LastPredictionKey = 0;
+
+	/*Samples the input to visible latency of the shots which spawned their projectiles this frame - bound to the end of the frame*/
+	void SampleInputToVisible();
+
+	/*The input times of the shots which became visible this frame*/
+	TArray<double, TInlineAllocator<4>> VisibleFireTimes;
+
+	FDelegateHandle EndFrameHandle;
+
+	/*Our capsule's handle in the world's lag compensation history*/
+	int32 LagCompensationHandle = INDEX_NONE;
+
+	/*Our handle in the world's skill targets*/
+	int32 SkillTargetHandle = INDEX_NONE;
+
+	/*The manager which holds LagCompensationHandle and SkillTargetHandle*/
+	TWeakObjectPtr<class ASkillsWorldManager> RegisteredManager;
 
 protected:
 
-	/*The root component in which the spring arm components will be attached*/
-	UPROPERTY(VisibleAnywhere)
-	USceneComponent* SkillsRootComp;
+	/*Where the skills get spawned, relative to the character - skills can override it*/
+	UPROPERTY(EditDefaultsOnly, Category = TLSkillsTree)
+	FTransform MuzzleOffset;
+
+	/*Clients move the projectiles of a volley forward by the time it took to arrive, up to this many seconds*/
+	UPROPERTY(EditDefaultsOnly, Category = TLSkillsTree)
+	float MaxVolleyCatchUp = 0.25f;
 
-	UPROPERTY(VisibleAnywhere)
-	USpringArmComponent* LevelOneSpringArm;
+	/*When true the owning client spawns its projectiles right away instead of waiting a round trip for the server's volley.
+	Compare "stat SkillsTree" with and without it while simulating lag with "Net PktLag=150"*/
+	UPROPERTY(EditDefaultsOnly, Category = TLSkillsTree)
+	bool bPredictSkills = true;
 
-	UPROPERTY(VisibleAnywhere)
-	USpringArmComponent* LevelTwoSpringArm;
+	/*The time a corrected prediction takes to blend its visuals into the server's path*/
+	UPROPERTY(EditDefaultsOnly, Category = TLSkillsTree)
+	float PredictionBlendTime = 0.15f;
 
-	UPROPERTY(VisibleAnywhere)
-	USpringArmComponent* LevelThreeSpringArm;
+	/*Predicted projectiles which are further off than this snap to the server's path*/
+	UPROPERTY(EditDefaultsOnly, Category = TLSkillsTree)
+	float MaxPredictionError = 300.f;
+
+	/*Predictions the server didn't answer within this many seconds are left alone - their projectiles fly on*/
+	UPROPERTY(EditDefaultsOnly, Category = TLSkillsTree)
+	float PredictionTimeout = 1.f;
+
+	/*Remote shooters' casts may come in this many seconds before their cooldown ends - network jitter bunches up their shots*/
+	UPROPERTY(EditDefaultsOnly, Category = TLSkillsTree)
+	float RemoteCastTolerance = 0.05f;
 
 	/*Skills Component reference*/
 	UPROPERTY(VisibleAnywhere/*, meta = (AllowPrivateAccess = "true")*/)
 	USkillsComponent* SkillsComponent;
 
+public:
+
+	/*Registers the capsule for lag compensation*/
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/*Binds the skills of the server's copy to the saved profile of the possessing player*/
+	virtual void PossessedBy(AController* NewController) override;
+
+	/*Streams in the skill icons once we are the local player's pawn*/
+	virtual void PawnClientRestart() override;
+
+	/*Blends corrected predictions*/
+	virtual void Tick(float DeltaSeconds) override;
+
 	/*Fires a skill*/
 	UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
 	void Fire(bool bShouldFireSecondary = false);
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+/*Everything the skills tree reports to the stats system - "stat SkillsTree" in the console,
+"stat startfile"/"stat stopfile" to capture it for the session frontend*/
+DECLARE_STATS_GROUP(TEXT("SkillsTree"), STATGROUP_SkillsTree, STATCAT_Advanced);
+
+//Cycles
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fire"), STAT_SkillsFire, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("GetSpawnTransforms"), STAT_SkillsGetSpawnTransforms, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Acquire Skill"), STAT_SkillsAcquire, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Skill OnHit"), STAT_SkillsOnHit, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Skill BeginPlay"), STAT_SkillsSkillBeginPlay, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Component BeginPlay"), STAT_SkillsComponentBeginPlay, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Rebuild Skill Index"), STAT_SkillsRebuildIndex, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Level Up"), STAT_SkillsLevelUp, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Reset/Refund Points"), STAT_SkillsResetPoints, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Lookup"), STAT_SkillsLookup, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Simulate"), STAT_SkillsSimulate, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Simulate Substep"), STAT_SkillsSimulateSubstep, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Expire"), STAT_SkillsExpire, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Process Hits"), STAT_SkillsProcessHits, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Rewind Hits"), STAT_SkillsRewind, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update Instanced Visuals"), STAT_SkillsUpdateVisuals, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update Skill Targets"), STAT_SkillsUpdateTargets, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Acquire Homing Targets"), STAT_SkillsAcquireTargets, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Splash"), STAT_SkillsSplash, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Profile Load"), STAT_SkillsProfileLoad, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Profile Flush"), STAT_SkillsProfileFlush, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Crowd Think"), STAT_SkillsCrowdThink, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Crowd Cast"), STAT_SkillsCrowdCast, STATGROUP_SkillsTree, SKILLSTREE_API);
+
+//Counters - the per frame ones get cleared every frame, divide by the frame time for the rates
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Live Projectiles"), STAT_SkillsLiveProjectiles, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Simulated Projectiles"), STAT_SkillsSimulatedProjectiles, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Scheduled Expiries"), STAT_SkillsScheduledExpiries, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Instanced Projectiles"), STAT_SkillsInstancedProjectiles, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Particle Projectiles"), STAT_SkillsParticleProjectiles, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Crowd Casters"), STAT_SkillsCrowdCasters, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shots"), STAT_SkillsShots, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Spawns"), STAT_SkillsSpawns, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hits"), STAT_SkillsHits, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Dropped Hits"), STAT_SkillsDroppedHits, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Impact FX Played"), STAT_SkillsImpactFXPlayed, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Impact FX Downgraded"), STAT_SkillsImpactFXDowngraded, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Impact FX Culled"), STAT_SkillsImpactFXCulled, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Mispredicted Volleys"), STAT_SkillsMispredictions, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Rewound Hits"), STAT_SkillsRewoundHits, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Simulation Substeps"), STAT_SkillsSubsteps, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Profile Writes"), STAT_SkillsProfileWrites, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Rejected Casts"), STAT_SkillsRejectedCasts, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Crowd Casts"), STAT_SkillsCrowdCasts, STATGROUP_SkillsTree, SKILLSTREE_API);
+
+//Latency - the value of the last shot, sampled at the end of the frame which placed its projectiles.
+//To test with simulated lag, play in the editor with two players, run "Net PktLag=<ms>" on the client and
+//"log LogSkillsTree Verbose" to get one line per shot next to "stat SkillsTree"
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Input To Visible (ms)"), STAT_SkillsInputToVisibleMs, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Volley Round Trip (ms)"), STAT_SkillsVolleyRoundTripMs, STATGROUP_SkillsTree, SKILLSTREE_API);
+
+//Memory
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Skill Slot Tables"), STAT_SkillsSlotTablesMemory, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Projectile Simulation"), STAT_SkillsSimulationMemory, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Expiry Wheel"), STAT_SkillsExpiryMemory, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Hit Buffer"), STAT_SkillsHitBufferMemory, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Lag Compensation History"), STAT_SkillsLagCompensationMemory, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Skill Target Grid"), STAT_SkillsTargetHashMemory, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Profile Store Index"), STAT_SkillsProfileStoreMemory, STATGROUP_SkillsTree, SKILLSTREE_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Crowd Casters"), STAT_SkillsCrowdMemory, STATGROUP_SkillsTree, SKILLSTREE_API);
@@ -0,0 +1,461 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillExpiryWheel.h"
+#include "SkillProfileStore.h"
+#include "SkillSpatialHash.h"
+#include "SkillsComponent.h"
+#include "SkillsState.h"
+#include "Engine/Engine.h"
+#include "Engine/TargetPoint.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+    const uint32 SkillsTestFlags = EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter;
+
+    //The wheel never dereferences its skills - any distinct pointer will do
+    ASkill* MakeFakeSkill(UPTRINT Id)
+    {
+        return reinterpret_cast<ASkill*>(Id * 16);
+    }
+
+    //Writes Source against Base (null for a full state) and moves Base to what got written - returns false if there was nothing to send
+    bool WriteSkillsState(FSkillsState& Source, TSharedPtr<INetDeltaBaseState>& Base, FBitWriter& Writer)
+    {
+        TSharedPtr<INetDeltaBaseState> NewState;
+        FNetDeltaSerializeInfo Parms;
+        Parms.Writer = &Writer;
+        Parms.OldState = Base.Get();
+        Parms.NewState = &NewState;
+        if (!Source.NetDeltaSerialize(Parms)) return false;
+
+        Base = NewState;
+        return true;
+    }
+
+    bool ReadSkillsState(FSkillsState& Target, FBitWriter& Writer)
+    {
+        FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+        FNetDeltaSerializeInfo Parms;
+        Parms.Reader = &Reader;
+        return Target.NetDeltaSerialize(Parms);
+    }
+
+    int32 CountReceivedSlots(const FSkillsState& State)
+    {
+        int32 Count = 0;
+        for (TConstSetBitIterator<> It(State.ReceivedSlots); It; ++It) Count++;
+        return Count;
+    }
+
+    //Every player's record can be rebuilt from its index, so loads can be checked
+    FSkillProfileRecord MakeTestRecord(int32 Player, int32 Revision)
+    {
+        FRandomStream Random(Player * 31 + Revision);
+        FSkillProfileRecord Record;
+        Record.Key = FSkillProfileStore::MakeKey(FString::Printf(TEXT("TestPlayer%d"), Player));
+        Record.Schema = 7;
+        Record.AvailablePoints = Revision;
+        Record.NumSlots = 12;
+        Record.NumNodeWords = 1;
+        for (int32 Slot = 0; Slot < Record.NumSlots; Slot++) Record.Levels[Slot] = (uint8)Random.RandRange(0, 5);
+        Record.UnlockedNodes[0] = ((uint64)Random.GetUnsignedInt() << 32) | Random.GetUnsignedInt();
+        return Record;
+    }
+
+    bool IsSameRecord(const FSkillProfileRecord& A, const FSkillProfileRecord& B)
+    {
+        return FMemory::Memcmp(&A, &B, sizeof(FSkillProfileRecord)) == 0;
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSkillsTreeExpiryWheelTest, "SkillsTree.ExpiryWheel.CascadeAndExpiry", SkillsTestFlags)
+
+bool FSkillsTreeExpiryWheelTest::RunTest(const FString& Parameters)
+{
+    FSkillExpiryWheel Wheel;
+    Wheel.TickInterval = 1.f;
+
+    //One in the first level, three which only reach it through the cascades at tick 256 and 512, one cancelled
+    Wheel.Schedule(MakeFakeSkill(1), 1.f);
+    Wheel.Schedule(MakeFakeSkill(2), 300.f);
+    Wheel.Schedule(MakeFakeSkill(3), 600.f);
+    Wheel.Schedule(MakeFakeSkill(7), 256.f);
+    const int32 Cancelled = Wheel.Schedule(MakeFakeSkill(4), 400.f);
+    Wheel.Cancel(Cancelled);
+    Wheel.Cancel(Cancelled);
+    TestEqual(TEXT("Pending after a double cancel"), Wheel.Num(), 4);
+
+    //The delay is at least one tick - nothing expires in the tick it was scheduled in
+    TArray<ASkill*> Expired;
+    Wheel.Advance(0.5f, Expired);
+    TestEqual(TEXT("Expired before the first tick"), Expired.Num(), 0);
+
+    TMap<ASkill*, int32> ExpireTicks;
+    for (int32 Tick = 1; Tick <= 700; Tick++)
+    {
+        Expired.Reset();
+        Wheel.Advance(1.f, Expired);
+        for (ASkill* Skill : Expired) ExpireTicks.Add(Skill, Tick);
+    }
+
+    //The half tick of the first advance is still in the accumulator
+    TestEqual(TEXT("Expired skills"), ExpireTicks.Num(), 4);
+    TestEqual(TEXT("First level expiry tick"), ExpireTicks.FindRef(MakeFakeSkill(1)), 1);
+    TestEqual(TEXT("Expiry tick cascaded at 256"), ExpireTicks.FindRef(MakeFakeSkill(2)), 300);
+    TestEqual(TEXT("Expiry tick cascaded at 512"), ExpireTicks.FindRef(MakeFakeSkill(3)), 600);
+    TestEqual(TEXT("Expiry tick on the cascade tick"), ExpireTicks.FindRef(MakeFakeSkill(7)), 256);
+    TestFalse(TEXT("Cancelled skill expired"), ExpireTicks.Contains(MakeFakeSkill(4)));
+    TestEqual(TEXT("Pending after every expiry"), Wheel.Num(), 0);
+
+    //Delays past the wheel get clamped to its last tick instead of wrapping around
+    Wheel.Schedule(MakeFakeSkill(5), 2.f);
+    Wheel.Schedule(MakeFakeSkill(6), 1000000.f);
+    Expired.Reset();
+    Wheel.Advance(2.f, Expired);
+    TestEqual(TEXT("Expired after two ticks"), Expired.Num(), 1);
+    TestTrue(TEXT("The short delay expired"), Expired.Contains(MakeFakeSkill(5)));
+    TestEqual(TEXT("Pending clamped expiry"), Wheel.Num(), 1);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSkillsTreeSpatialHashNearestTest, "SkillsTree.SpatialHash.Nearest", SkillsTestFlags)
+
+bool FSkillsTreeSpatialHashNearestTest::RunTest(const FString& Parameters)
+{
+    UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("SkillsTreeSpatialHashTest"));
+    if (!World)
+    {
+        AddError(TEXT("Could not create the test world"));
+        return false;
+    }
+
+    FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+    WorldContext.SetCurrentWorld(World);
+
+    //Few buckets so plenty of cells share one - the queries have to filter them
+    FSkillSpatialHash Hash;
+    Hash.Init(250.f, 16);
+
+    FRandomStream Random(1234);
+    FActorSpawnParameters SpawnParams;
+    SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+    TArray<AActor*> Targets;
+    for (int32 i = 0; i < 200; i++)
+    {
+        const FVector Location(Random.FRandRange(-2000.f, 2000.f), Random.FRandRange(-2000.f, 2000.f), Random.FRandRange(0.f, 200.f));
+        AActor* Target = World->SpawnActor<ATargetPoint>(ATargetPoint::StaticClass(), Location, FRotator::ZeroRotator, SpawnParams);
+        if (!Target) continue;
+
+        Targets.Add(Target);
+        Hash.Register(Target);
+    }
+    TestEqual(TEXT("Registered targets"), Hash.Num(), Targets.Num());
+
+    //Every ring search has to agree with sorting all the targets
+    auto CheckNearest = [this, &Hash](const FVector& Center, float MaxRadius, int32 Count, const AActor* IgnoredActor)
+    {
+        TArray<TPair<float, int32>> Expected;
+        for (int32 Slot = 0; Slot < Hash.Num(); Slot++)
+        {
+            const float DistanceSq = FVector::DistSquared(Hash.GetLocation(Slot), Center);
+            if (DistanceSq <= FMath::Square(MaxRadius) && Hash.GetActor(Slot) != IgnoredActor) Expected.Add(MakeTuple(DistanceSq, Slot));
+        }
+        Expected.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key < B.Key; });
+        if (Expected.Num() > Count) Expected.SetNum(Count);
+
+        TArray<int32, TInlineAllocator<16>> Found;
+        const int32 NumFound = Hash.QueryNearest(Center, MaxRadius, Count, Found, IgnoredActor);
+
+        const FString Where = FString::Printf(TEXT("Nearest %d within %.0f of %s"), Count, MaxRadius, *Center.ToString());
+        TestEqual(*Where, NumFound, Expected.Num());
+        for (int32 i = 0; i < FMath::Min(NumFound, Expected.Num()); i++) TestEqual(*Where, Found[i], Expected[i].Value);
+    };
+
+    for (int32 i = 0; i < 20; i++)
+    {
+        const FVector Center(Random.FRandRange(-2500.f, 2500.f), Random.FRandRange(-2500.f, 2500.f), 100.f);
+        CheckNearest(Center, 1200.f, 8, nullptr);
+        CheckNearest(Center, 300.f, 4, nullptr);
+        CheckNearest(Center, 5000.f, 1, nullptr);
+    }
+
+    //Far from every target the rings have to keep going until the radius runs out
+    CheckNearest(FVector(6000.f, 6000.f, 0.f), 10000.f, 3, nullptr);
+    CheckNearest(FVector(6000.f, 6000.f, 0.f), 1000.f, 3, nullptr);
+
+    //A caster never finds itself
+    CheckNearest(Targets[0]->GetActorLocation(), 1000.f, 4, Targets[0]);
+
+    //Targets which left their cell get found in the new one
+    Targets[1]->SetActorLocation(FVector(3900.f, -3900.f, 50.f));
+    Hash.Update();
+    CheckNearest(FVector(3800.f, -3800.f, 50.f), 500.f, 2, nullptr);
+
+    Hash.Unregister(0);
+    TestEqual(TEXT("Targets after an unregister"), Hash.Num(), Targets.Num() - 1);
+
+    World->BeginTearingDown();
+    World->DestroyWorld(false);
+    GEngine->DestroyWorldContext(World);
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSkillsTreeStateRoundTripTest, "SkillsTree.SkillsState.DeltaRoundTrip", SkillsTestFlags)
+
+bool FSkillsTreeStateRoundTripTest::RunTest(const FString& Parameters)
+{
+    FRandomStream Random(42);
+
+    FSkillsState Server;
+    Server.LevelBits = 3;
+    Server.Reset(64, 12);
+    for (uint8& Level : Server.Levels) Level = (uint8)Random.RandRange(0, 7);
+
+    FSkillsState Client;
+    TSharedPtr<INetDeltaBaseState> Base;
+
+    //Nothing acknowledged yet - the whole state goes out and sizes the client's slots
+    {
+        FBitWriter Writer(0, true);
+        TestTrue(TEXT("Full state written"), WriteSkillsState(Server, Base, Writer));
+        TestTrue(TEXT("Full state read"), ReadSkillsState(Client, Writer));
+        TestTrue(TEXT("Full state levels"), Client.Levels == Server.Levels);
+        TestEqual(TEXT("Full state points"), Client.AvailablePoints, 12);
+        TestEqual(TEXT("Full state received slots"), CountReceivedSlots(Client), 64);
+    }
+
+    {
+        FBitWriter Writer(0, true);
+        TestFalse(TEXT("Unchanged state written"), WriteSkillsState(Server, Base, Writer));
+    }
+
+    //One slot - sent as a list of indices
+    int64 SparseBits = 0;
+    {
+        Server.Levels[17] = (Server.Levels[17] + 1) % 8;
+        Server.AvailablePoints--;
+
+        FBitWriter Writer(0, true);
+        TestTrue(TEXT("Sparse delta written"), WriteSkillsState(Server, Base, Writer));
+        SparseBits = Writer.GetNumBits();
+        TestTrue(TEXT("Sparse delta read"), ReadSkillsState(Client, Writer));
+        TestTrue(TEXT("Sparse delta levels"), Client.Levels == Server.Levels);
+        TestEqual(TEXT("Sparse delta points"), Client.AvailablePoints, 11);
+        TestEqual(TEXT("Sparse delta received slots"), CountReceivedSlots(Client), 1);
+        TestTrue(TEXT("Sparse delta received slot 17"), Client.ReceivedSlots[17]);
+    }
+
+    //Half of the slots - sent as a mask
+    {
+        for (int32 Slot = 0; Slot < Server.Levels.Num(); Slot += 2) Server.Levels[Slot] = (Server.Levels[Slot] + 3) % 8;
+
+        FBitWriter Writer(0, true);
+        TestTrue(TEXT("Mask delta written"), WriteSkillsState(Server, Base, Writer));
+        TestTrue(TEXT("A mask costs more than a single index"), Writer.GetNumBits() > SparseBits);
+        TestTrue(TEXT("Mask delta read"), ReadSkillsState(Client, Writer));
+        TestTrue(TEXT("Mask delta levels"), Client.Levels == Server.Levels);
+        TestEqual(TEXT("Mask delta points"), Client.AvailablePoints, 11);
+        TestEqual(TEXT("Mask delta received slots"), CountReceivedSlots(Client), 32);
+    }
+
+    //Only the points
+    {
+        Server.AvailablePoints = 30;
+
+        FBitWriter Writer(0, true);
+        TestTrue(TEXT("Points delta written"), WriteSkillsState(Server, Base, Writer));
+        TestTrue(TEXT("Points delta read"), ReadSkillsState(Client, Writer));
+        TestEqual(TEXT("Points delta points"), Client.AvailablePoints, 30);
+        TestEqual(TEXT("Points delta received slots"), CountReceivedSlots(Client), 0);
+    }
+
+    //A delta for another slot count is a corrupt stream, not a state to apply
+    {
+        Server.Levels[3] = (Server.Levels[3] + 1) % 8;
+
+        FBitWriter Writer(0, true);
+        TestTrue(TEXT("Delta written"), WriteSkillsState(Server, Base, Writer));
+
+        FSkillsState Stale;
+        Stale.Reset(63, 0);
+        TestFalse(TEXT("Delta for another slot count read"), ReadSkillsState(Stale, Writer));
+    }
+
+    //The server changed its skills - the new slot count goes out as a full state and resizes the client
+    {
+        Server.Levels.SetNumZeroed(80);
+        Server.Levels[70] = 5;
+
+        FBitWriter Writer(0, true);
+        TestTrue(TEXT("Resized state written"), WriteSkillsState(Server, Base, Writer));
+        TestTrue(TEXT("Resized state read"), ReadSkillsState(Client, Writer));
+        TestTrue(TEXT("Resized state levels"), Client.Levels == Server.Levels);
+        TestEqual(TEXT("Resized state received slots"), CountReceivedSlots(Client), 80);
+    }
+
+    //Deltas after the resize use the new slot count
+    {
+        Server.Levels[75] = 2;
+
+        FBitWriter Writer(0, true);
+        TestTrue(TEXT("Delta after the resize written"), WriteSkillsState(Server, Base, Writer));
+        TestTrue(TEXT("Delta after the resize read"), ReadSkillsState(Client, Writer));
+        TestTrue(TEXT("Delta after the resize levels"), Client.Levels == Server.Levels);
+        TestEqual(TEXT("Delta after the resize received slots"), CountReceivedSlots(Client), 1);
+    }
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSkillsTreeProfileStoreTest, "SkillsTree.ProfileStore.SaveLoadGrowReopen", SkillsTestFlags)
+
+bool FSkillsTreeProfileStoreTest::RunTest(const FString& Parameters)
+{
+    //Mapped where the platform can map, and the buffered file every platform can fall back to
+    for (const bool bAllowMapping : { true, false })
+    {
+        const FString Filename = FPaths::ConvertRelativePathToFull(FPaths::AutomationTransientDir() / (bAllowMapping ? TEXT("SkillProfiles-Mapped.bin") : TEXT("SkillProfiles-Buffered.bin")));
+        IFileManager::Get().Delete(*Filename, false, true, true);
+
+        const TCHAR* Backing = bAllowMapping ? TEXT("Mapped") : TEXT("Buffered");
+        const int32 NumPlayers = 5;
+        {
+            FSkillProfileStore Store;
+            if (!Store.Open(Filename, 2, bAllowMapping))
+            {
+                AddError(FString::Printf(TEXT("%s store could not be opened"), Backing));
+                continue;
+            }
+            if (!bAllowMapping) TestFalse(TEXT("Buffered store mapped"), Store.IsMapped());
+
+            //Two records fit - the third and fifth grow the file
+            for (int32 Player = 0; Player < NumPlayers; Player++) TestTrue(*FString::Printf(TEXT("%s save %d"), Backing, Player), Store.Save(MakeTestRecord(Player, 1)));
+            TestEqual(*FString::Printf(TEXT("%s records"), Backing), Store.Num(), NumPlayers);
+            TestTrue(*FString::Printf(TEXT("%s grown"), Backing), Store.GetFileSize() >= (uint64)(64 + NumPlayers * sizeof(FSkillProfileRecord)));
+
+            //Queued saves are the newest copy
+            FSkillProfileRecord Loaded;
+            TestTrue(*FString::Printf(TEXT("%s load queued"), Backing), Store.Load(MakeTestRecord(3, 1).Key, Loaded) && IsSameRecord(Loaded, MakeTestRecord(3, 1)));
+
+            Store.Flush();
+            Store.WaitForWrites();
+            TestEqual(*FString::Printf(TEXT("%s pending after a flush"), Backing), Store.GetNumPendingWrites(), 0);
+
+            //A second save of a player replaces the record instead of adding one
+            TestTrue(*FString::Printf(TEXT("%s save again"), Backing), Store.Save(MakeTestRecord(1, 2)));
+            TestEqual(*FString::Printf(TEXT("%s records after a second save"), Backing), Store.Num(), NumPlayers);
+
+            TestFalse(*FString::Printf(TEXT("%s load unknown"), Backing), Store.Load(FSkillProfileStore::MakeKey(TEXT("Nobody")), Loaded));
+
+            FSkillProfileRecord Keyless;
+            TestFalse(*FString::Printf(TEXT("%s save without a key"), Backing), Store.Save(Keyless));
+        }
+
+        //Closing wrote the queued record - a store opened smaller keeps the file's capacity
+        {
+            FSkillProfileStore Store;
+            if (!Store.Open(Filename, 1, bAllowMapping))
+            {
+                AddError(FString::Printf(TEXT("%s store could not be reopened"), Backing));
+                continue;
+            }
+            TestEqual(*FString::Printf(TEXT("%s records after a reopen"), Backing), Store.Num(), NumPlayers);
+
+            for (int32 Player = 0; Player < NumPlayers; Player++)
+            {
+                const FSkillProfileRecord Expected = MakeTestRecord(Player, Player == 1 ? 2 : 1);
+                FSkillProfileRecord Loaded;
+                TestTrue(*FString::Printf(TEXT("%s load %d after a reopen"), Backing, Player), Store.Load(Expected.Key, Loaded) && IsSameRecord(Loaded, Expected));
+            }
+        }
+
+        //A file of another layout gets moved aside instead of read
+        FFileHelper::SaveStringToFile(TEXT("Not a skill profile store, but long enough to look like one at first glance"), *Filename);
+        {
+            FSkillProfileStore Store;
+            TestTrue(*FString::Printf(TEXT("%s open over a foreign file"), Backing), Store.Open(Filename, 4, bAllowMapping));
+            TestEqual(*FString::Printf(TEXT("%s records of a foreign file"), Backing), Store.Num(), 0);
+        }
+
+        IFileManager::Get().Delete(*Filename, false, true, true);
+        IFileManager::Get().Delete(*(Filename + TEXT(".bak")), false, true, true);
+    }
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSkillsTreeCastLimitsTest, "SkillsTree.SkillsComponent.CastLimits", SkillsTestFlags)
+
+bool FSkillsTreeCastLimitsTest::RunTest(const FString& Parameters)
+{
+    USkillsComponent* Skills = NewObject<USkillsComponent>(GetTransientPackage());
+    Skills->SetSkills({ ASkill::StaticClass(), ASkill::StaticClass() });
+
+    //Two charges recharging in 2 seconds for 30 mana, and a skill without cooldown for 50 mana
+    FSkillCastRules ChargedRules;
+    ChargedRules.Cooldown = 2.f;
+    ChargedRules.Charges = 2;
+    ChargedRules.ManaCost = 30.f;
+
+    FSkillCastRules CostlyRules;
+    CostlyRules.ManaCost = 50.f;
+
+    Skills->SkillsState.Levels[0] = 1;
+    Skills->CastLimits[Skills->SkillSlots[0].CastLimitsOffset + 1] = FSkillCastLimits(ChargedRules);
+    Skills->SkillsState.Levels[1] = 1;
+    Skills->CastLimits[Skills->SkillSlots[1].CastLimitsOffset + 1] = FSkillCastLimits(CostlyRules);
+
+    Skills->MaxMana = 100.f;
+    Skills->ManaRegenRate = 10.f;
+    Skills->ManaAtTime = 100.f;
+    Skills->ManaTime = 0.f;
+
+    TestFalse(TEXT("Invalid slot castable"), Skills->CanCastSkill(2, 0.f));
+
+    //Both charges go out back to back, the third cast waits for the cooldown
+    TestTrue(TEXT("First charge"), Skills->TryCastSkill(0, 0.f));
+    TestTrue(TEXT("Second charge"), Skills->TryCastSkill(0, 0.f));
+    TestFalse(TEXT("Third charge"), Skills->TryCastSkill(0, 0.f));
+    TestFalse(TEXT("Charge before the cooldown"), Skills->CanCastSkill(0, 1.99f));
+    TestEqual(TEXT("Mana after two casts"), Skills->GetMana(0.f), 40.f);
+
+    //The first charge is back after one cooldown - mana regenerated meanwhile
+    TestEqual(TEXT("Mana after two seconds"), Skills->GetMana(2.f), 60.f);
+    TestTrue(TEXT("Charge after the cooldown"), Skills->TryCastSkill(0, 2.f));
+    TestEqual(TEXT("Charges full time"), Skills->ChargesFullTimes[0], 6.f);
+
+    //The tolerance accepts the cast early, but the cooldown still starts at the end of the queued recharge
+    TestFalse(TEXT("Early cast without tolerance"), Skills->CanCastSkill(0, 3.9f));
+    TestTrue(TEXT("Early cast within tolerance"), Skills->TryCastSkill(0, 3.9f, 0.2f));
+    TestEqual(TEXT("Charges full time after an early cast"), Skills->ChargesFullTimes[0], 8.f);
+    TestEqual(TEXT("Mana after an early cast"), Skills->GetMana(3.9f), 19.f, 0.001f);
+
+    //Without cooldown only the mana holds the casts back
+    Skills->ManaAtTime = 100.f;
+    Skills->ManaTime = 10.f;
+    TestTrue(TEXT("First costly cast"), Skills->TryCastSkill(1, 10.f));
+    TestTrue(TEXT("Second costly cast"), Skills->TryCastSkill(1, 10.f));
+    TestFalse(TEXT("Costly cast without mana"), Skills->TryCastSkill(1, 10.f));
+    TestTrue(TEXT("Costly cast after the regeneration"), Skills->CanCastSkill(1, 15.f));
+    TestEqual(TEXT("Mana caps at the maximum"), Skills->GetMana(100.f), 100.f);
+
+    //Unlearned skills can never be cast
+    Skills->SkillsState.Levels[1] = 0;
+    TestFalse(TEXT("Unlearned skill castable"), Skills->CanCastSkill(1, 100.f));
+
+    return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
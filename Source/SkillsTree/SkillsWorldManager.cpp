@@ -0,0 +1,377 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SkillsWorldManager.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Misc/Paths.h"
+#include "SkillsTree.h"
+#include "SkillsComponent.h"
+#include "SkillsTreeStats.h"
+
+// Sets default values
+ASkillsWorldManager::ASkillsWorldManager()
+{
+    //Skills get moved before physics, just like a movement comp would do
+    PrimaryActorTick.bCanEverTick = true;
+    PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+    //Hits of the whole frame get handled in one go once physics is done
+    HitTickFunction.bCanEverTick = true;
+    HitTickFunction.bStartWithTickEnabled = true;
+    HitTickFunction.TickGroup = TG_PostPhysics;
+    HitTickFunction.Manager = this;
+}
+
+void ASkillsWorldManager::RegisterActorTickFunctions(bool bRegister)
+{
+    Super::RegisterActorTickFunctions(bRegister);
+
+    if (bRegister)
+    {
+        HitTickFunction.RegisterTickFunction(GetLevel());
+        HitTickFunction.AddPrerequisite(this, PrimaryActorTick);
+    }
+    else if (HitTickFunction.IsTickFunctionRegistered())
+    {
+        HitTickFunction.UnRegisterTickFunction();
+    }
+}
+
+void ASkillsWorldManager::BeginPlay()
+{
+    Super::BeginPlay();
+
+    const bool bIsDedicatedServer = GetNetMode() == NM_DedicatedServer;
+    ProjectileSimulation.WriteBackTolerance = bIsDedicatedServer ? ServerWriteBackTolerance : WriteBackTolerance;
+    ProjectileSimulation.ChunkSize = FMath::Max(SimulationChunkSize, 1);
+    ProjectileSimulation.bAsyncSweeps = bAsyncSkillSweeps;
+    ProjectileSimulation.FixedStep = FMath::Max(SimulationFixedStep, 0.f);
+    ProjectileSimulation.MaxSubsteps = FMath::Max(MaxSimulationSubsteps, 1);
+    ProjectileSimulation.Targets = &TargetHash;
+    TargetHash.Init(SkillTargetCellSize, SkillTargetBuckets);
+    CrowdCasters.ChunkSize = FMath::Max(CrowdCasterChunkSize, 1);
+    CrowdCasters.Targets = &TargetHash;
+    ExpiryWheel.TickInterval = FMath::Max(ExpiryTickInterval, KINDA_SMALL_NUMBER);
+    AssetStreamer.ColdTime = SkillFXColdTime;
+
+    //Nobody watches the FX of a dedicated server - no emitters means impacts get dropped right away
+    if (!bIsDedicatedServer)
+    {
+        ImpactFXPool.Budget = ImpactFXBudget;
+        ImpactFXPool.CullDistance = ImpactFXCullDistance;
+        ImpactFXPool.DowngradeDistance = ImpactFXDowngradeDistance;
+        ImpactFXPool.Init(this, ImpactFXPoolSize);
+
+        InstancedVisuals.ParticleBudget = FMath::Max(ProjectileParticleBudget, 0);
+        InstancedVisuals.Init(this);
+    }
+
+    //Only servers have remote shooters
+    const ENetMode NetMode = GetNetMode();
+    if (bLagCompensation && (NetMode == NM_DedicatedServer || NetMode == NM_ListenServer))
+    {
+        LagCompensation.Init(LagCompensationCapsules, LagCompensationFrames);
+    }
+
+    //Clients get their trees from the server
+    if (bSkillProfiles && NetMode != NM_Client) ProfileStore.Open(FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / SkillProfileFile), SkillProfileCapacity);
+}
+
+void ASkillsWorldManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    //Components which end play after us would find the store closed
+    for (USkillsComponent* SkillsComponent : ProfileComponents)
+    {
+        if (SkillsComponent) SkillsComponent->FlushSkillProfile();
+    }
+
+    //Writes what is still queued
+    ProfileStore.Close();
+
+    Super::EndPlay(EndPlayReason);
+}
+
+void ASkillsWorldManager::Tick(float DeltaSeconds)
+{
+    Super::Tick(DeltaSeconds);
+
+    //Crowd casts fire first so their projectiles move this frame too
+    CrowdCasters.Update(GetWorld()->GetTimeSeconds());
+
+    {
+        SCOPE_CYCLE_COUNTER(STAT_SkillsSimulate);
+        ProjectileSimulation.Simulate(GetWorld(), DeltaSeconds);
+    }
+
+    //Releasing every skill which expired this frame in one go
+    {
+        SCOPE_CYCLE_COUNTER(STAT_SkillsExpire);
+        ExpiredSkills.Reset();
+        ExpiryWheel.Advance(DeltaSeconds, ExpiredSkills);
+        for (ASkill* Skill : ExpiredSkills)
+        {
+            Skill->ExpiryHandle = INDEX_NONE;
+            Skill->ReleaseSkill();
+        }
+    }
+
+    //Pooled skills keep their template between shots - only the FX which got evicted must not stay loaded through them
+    EvictedFXClasses.Reset();
+    AssetStreamer.EvictColdFX(GetWorld()->GetTimeSeconds(), EvictedFXClasses);
+    for (const UClass* SkillClass : EvictedFXClasses) ProjectilePool.ClearFreeSkillFX(SkillClass);
+
+    ProfileFlushTime += DeltaSeconds;
+    if (ProfileFlushTime >= SkillProfileFlushInterval)
+    {
+        ProfileStore.Flush();
+        ProfileFlushTime = 0.f;
+    }
+}
+
+ASkillsWorldManager* ASkillsWorldManager::Get(const UObject* WorldContextObject)
+{
+    UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+    if (!World) return nullptr;
+
+    for (TActorIterator<ASkillsWorldManager> It(World); It; ++It)
+    {
+        if (!It->IsPendingKill()) return *It;
+    }
+
+    //Editor preview worlds don't need a manager
+    if (!World->IsGameWorld()) return nullptr;
+
+    FActorSpawnParameters SpawnParams;
+    SpawnParams.ObjectFlags |= RF_Transient;
+    SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+    return World->SpawnActor<ASkillsWorldManager>(SpawnParams);
+}
+
+ASkill* ASkillsWorldManager::AcquireSkill(TSubclassOf<ASkill> SkillClass, const FTransform& SpawnTransform, AActor* SkillOwner, APawn* SkillInstigator)
+{
+    SCOPE_CYCLE_COUNTER(STAT_SkillsAcquire);
+    return ProjectilePool.Acquire(GetWorld(), SkillClass, SpawnTransform, SkillOwner, SkillInstigator);
+}
+
+void ASkillsWorldManager::ReleaseSkill(ASkill* Skill)
+{
+    ProjectilePool.Release(Skill);
+}
+
+void ASkillsWorldManager::PrewarmSkillPool(TSubclassOf<ASkill> SkillClass, int32 Count)
+{
+    ProjectilePool.Prewarm(GetWorld(), SkillClass, Count);
+}
+
+FSkillPoolStats ASkillsWorldManager::GetSkillPoolStats(TSubclassOf<ASkill> SkillClass) const
+{
+    return SkillClass ? ProjectilePool.GetStats(SkillClass) : ProjectilePool.GetTotalStats();
+}
+
+int32 ASkillsWorldManager::RegisterSimulatedSkill(ASkill* Skill, const FVector& Velocity, float Radius, float GravityZ)
+{
+    return ProjectileSimulation.Add(Skill, Skill->GetActorLocation(), Velocity, Radius, GravityZ, Skill->GetOwner(), Skill->GetSkillType(), GetWorld()->GetTimeSeconds());
+}
+
+void ASkillsWorldManager::UnregisterSimulatedSkill(int32 Handle)
+{
+    ProjectileSimulation.Remove(Handle);
+}
+
+int32 ASkillsWorldManager::ScheduleSkillExpiry(ASkill* Skill, float Delay)
+{
+    return ExpiryWheel.Schedule(Skill, Delay);
+}
+
+void ASkillsWorldManager::CancelSkillExpiry(int32 Handle)
+{
+    ExpiryWheel.Cancel(Handle);
+}
+
+TSharedPtr<FStreamableHandle> ASkillsWorldManager::RequestSkillIcons(const TArray<TSubclassOf<ASkill>>& SkillClasses, FStreamableDelegate OnLoaded)
+{
+    return AssetStreamer.RequestIcons(SkillClasses, OnLoaded);
+}
+
+void ASkillsWorldManager::AcquireSkillFX(TSubclassOf<ASkill> SkillClass)
+{
+    if (IsRunningDedicatedServer()) return;
+    AssetStreamer.AcquireFX(SkillClass, GetWorld()->GetTimeSeconds());
+}
+
+void ASkillsWorldManager::ReleaseSkillFX(TSubclassOf<ASkill> SkillClass)
+{
+    AssetStreamer.ReleaseFX(SkillClass, GetWorld()->GetTimeSeconds());
+}
+
+void ASkillsWorldManager::PrefetchSkillFX(TSubclassOf<ASkill> SkillClass)
+{
+    if (IsRunningDedicatedServer()) return;
+    AssetStreamer.TouchFX(SkillClass, GetWorld()->GetTimeSeconds());
+}
+
+void ASkillsWorldManager::ProcessSkillHits()
+{
+    SCOPE_CYCLE_COUNTER(STAT_SkillsProcessHits);
+
+    //Splashes below and the homing skills of the next frame see the targets where they ended this frame
+    {
+        SCOPE_CYCLE_COUNTER(STAT_SkillsUpdateTargets);
+        TargetHash.Update();
+    }
+
+    //Every capsule moved by now - record them and queue the hits remote shooters saw
+    if (LagCompensation.IsInitialized())
+    {
+        LagCompensation.Record(GetWorld()->GetTimeSeconds());
+        ResolveRewoundHits();
+    }
+
+    const TArrayView<FSkillHitRecord> Hits = HitBuffer.SortAndGet();
+
+    if (Hits.Num() > 0)
+    {
+        for (const FSkillHitRecord& Hit : Hits)
+        {
+            if (Hit.Skill && !Hit.Skill->IsPendingKill()) Hit.Skill->ApplyHitEffects(Hit);
+        }
+
+        OnSkillHitBatch.Broadcast(TArrayView<const FSkillHitRecord>(Hits.GetData(), Hits.Num()));
+        INC_DWORD_STAT_BY(STAT_SkillsHits, Hits.Num());
+    }
+
+    if (HitBuffer.GetNumDropped() > 0)
+    {
+        INC_DWORD_STAT_BY(STAT_SkillsDroppedHits, HitBuffer.GetNumDropped());
+        UE_LOG(LogSkillsTree, Warning, TEXT("%d skill hits didn't fit in the hit buffer and got applied right away - growing the buffer"), HitBuffer.GetNumDropped());
+    }
+    HitBuffer.Reset();
+
+    //The impacts of every hit above are known now - play the ones which matter
+    ImpactFXPool.Flush(GetWorld());
+
+    //Projectiles are where they end this frame - decide which of them keep their particles
+    InstancedVisuals.Update(GetWorld());
+
+    //The state of the frame once every skill moved, hit and expired
+    SET_DWORD_STAT(STAT_SkillsLiveProjectiles, ProjectilePool.GetTotalStats().NumActive);
+    SET_DWORD_STAT(STAT_SkillsSimulatedProjectiles, ProjectileSimulation.Num());
+    SET_DWORD_STAT(STAT_SkillsScheduledExpiries, ExpiryWheel.Num());
+    SET_DWORD_STAT(STAT_SkillsInstancedProjectiles, InstancedVisuals.GetNumInstanced());
+    SET_DWORD_STAT(STAT_SkillsParticleProjectiles, InstancedVisuals.GetNumParticles());
+    SET_DWORD_STAT(STAT_SkillsCrowdCasters, CrowdCasters.Num());
+    SET_MEMORY_STAT(STAT_SkillsSimulationMemory, ProjectileSimulation.GetAllocatedSize());
+    SET_MEMORY_STAT(STAT_SkillsExpiryMemory, ExpiryWheel.GetAllocatedSize());
+    SET_MEMORY_STAT(STAT_SkillsHitBufferMemory, HitBuffer.GetAllocatedSize());
+    SET_MEMORY_STAT(STAT_SkillsLagCompensationMemory, LagCompensation.GetAllocatedSize());
+    SET_MEMORY_STAT(STAT_SkillsTargetHashMemory, TargetHash.GetAllocatedSize());
+    SET_MEMORY_STAT(STAT_SkillsProfileStoreMemory, ProfileStore.GetAllocatedSize());
+    SET_MEMORY_STAT(STAT_SkillsCrowdMemory, CrowdCasters.GetAllocatedSize());
+}
+
+int32 ASkillsWorldManager::RegisterSkillProfile(USkillsComponent* SkillsComponent)
+{
+    if (!ProfileStore.IsOpen()) return INDEX_NONE;
+    return ProfileComponents.Add(SkillsComponent);
+}
+
+void ASkillsWorldManager::UnregisterSkillProfile(int32 Handle)
+{
+    if (!ProfileComponents.IsValidIndex(Handle)) return;
+
+    //The last component moves into the freed slot
+    ProfileComponents.RemoveAtSwap(Handle, 1, false);
+    if (ProfileComponents.IsValidIndex(Handle) && ProfileComponents[Handle]) ProfileComponents[Handle]->ProfileHandle = Handle;
+}
+
+int32 ASkillsWorldManager::RegisterRewoundSkill(ASkill* Skill)
+{
+    if (!LagCompensation.IsInitialized()) return INDEX_NONE;
+
+    RewoundStarts.Add(Skill->GetActorLocation());
+    return RewoundSkills.Add(Skill);
+}
+
+void ASkillsWorldManager::UnregisterRewoundSkill(int32 Handle)
+{
+    if (!RewoundSkills.IsValidIndex(Handle)) return;
+
+    //The last skill moves into the freed slot
+    RewoundSkills.RemoveAtSwap(Handle, 1, false);
+    RewoundStarts.RemoveAtSwap(Handle, 1, false);
+    if (RewoundSkills.IsValidIndex(Handle)) RewoundSkills[Handle]->RewindHandle = Handle;
+}
+
+int32 ASkillsWorldManager::FindSkillTargets(const FVector& Center, float Radius, TArray<AActor*, TInlineAllocator<16>>& OutTargets, const AActor* IgnoredActor) const
+{
+    TArray<int32, TInlineAllocator<16>> Slots;
+    TargetHash.QueryRadius(Center, Radius, Slots, IgnoredActor);
+
+    for (int32 Slot : Slots) OutTargets.Add(TargetHash.GetActor(Slot));
+    return Slots.Num();
+}
+
+int32 ASkillsWorldManager::RegisterCrowdCaster(ASkillCrowdCasterPawn* Caster, int32 TargetSlot)
+{
+    return CrowdCasters.Add(Caster, TargetSlot, GetWorld()->GetTimeSeconds());
+}
+
+AActor* ASkillsWorldManager::FindNearestSkillTarget(const FVector& Center, float MaxRadius, const AActor* IgnoredActor) const
+{
+    TArray<int32, TInlineAllocator<16>> Slots;
+    return TargetHash.QueryNearest(Center, MaxRadius, 1, Slots, IgnoredActor) > 0 ? TargetHash.GetActor(Slots[0]) : nullptr;
+}
+
+void ASkillsWorldManager::ResolveRewoundHits()
+{
+    SCOPE_CYCLE_COUNTER(STAT_SkillsRewind);
+
+    const float Now = GetWorld()->GetTimeSeconds();
+    TArray<int32, TInlineAllocator<8>> Overlaps;
+    TArray<float, TInlineAllocator<8>> Fractions;
+
+    for (int32 i = RewoundSkills.Num() - 1; i >= 0; i--)
+    {
+        ASkill* Skill = RewoundSkills[i];
+        if (Skill->bHasHit) continue;
+
+        //The whole way the skill moved this frame - fast skills would step over a capsule between two checks
+        const float RewindTime = Now - Skill->LagCompensationTime;
+        const FVector Start = RewoundStarts[i];
+        const FVector End = Skill->GetActorLocation();
+        RewoundStarts[i] = End;
+
+        Overlaps.Reset();
+        Fractions.Reset();
+        if (LagCompensation.SweepSphere(RewindTime, Start, End, Skill->GetCollisionRadius(), Overlaps, Fractions) == 0) continue;
+
+        //The first capsule along the way takes the hit
+        int32 HitSlot = INDEX_NONE;
+        float HitFraction = MAX_FLT;
+        for (int32 j = 0; j < Overlaps.Num(); j++)
+        {
+            AActor* Target = LagCompensation.GetActor(Overlaps[j]);
+            if (!Target || Target == Skill->GetOwner() || Target == Skill->Instigator || Fractions[j] >= HitFraction) continue;
+
+            HitSlot = Overlaps[j];
+            HitFraction = Fractions[j];
+        }
+
+        if (HitSlot == INDEX_NONE) continue;
+
+        AActor* Target = LagCompensation.GetActor(HitSlot);
+        const FVector Location = FMath::Lerp(Start, End, HitFraction);
+
+        //The impact faces away from where the target was
+        FVector Center;
+        const FVector Normal = LagCompensation.GetCenter(HitSlot, RewindTime, Center) ? (Location - Center).GetSafeNormal2D() : -Skill->GetActorForwardVector();
+
+        FHitResult Hit(Target, nullptr, Location, Normal);
+        Hit.bBlockingHit = true;
+        Hit.ImpactPoint = Location;
+        Hit.ImpactNormal = Normal;
+
+        INC_DWORD_STAT(STAT_SkillsRewoundHits);
+        Skill->HandleSimulatedHit(Hit);
+    }
+}
@@ -0,0 +1,392 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Skill.h"
+#include "SkillProjectilePool.h"
+#include "SkillProjectileSimulation.h"
+#include "SkillExpiryWheel.h"
+#include "SkillHitBuffer.h"
+#include "SkillAssetStreamer.h"
+#include "SkillImpactFXPool.h"
+#include "SkillLagCompensation.h"
+#include "SkillInstancedVisuals.h"
+#include "SkillSpatialHash.h"
+#include "SkillProfileStore.h"
+#include "SkillCrowdCasters.h"
+#include "SkillsWorldManager.generated.h"
+
+/*Called once per frame with every skill hit of the frame, sorted by skill type and level*/
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnSkillHitBatch, TArrayView<const FSkillHitRecord>);
+
+/*One per game world - owns the state that is shared by every skill in the world (projectile pool etc.)*/
+UCLASS(NotPlaceable, Transient, Config = Game)
+class SKILLSTREE_API ASkillsWorldManager : public AActor
+{
+	GENERATED_BODY()
+
+	/*The benchmarks switch the config of the managers they spawn*/
+	friend class USkillsTreeBenchmarkCommandlet;
+
+public:
+	// Sets default values for this actor's properties
+	ASkillsWorldManager();
+
+	/*Returns the skills manager of the given object's world - spawns one if the world is a game world and has none yet*/
+	UFUNCTION(BlueprintPure, Category = TLSkillsTree, meta = (WorldContext = "WorldContextObject"))
+	static ASkillsWorldManager* Get(const UObject* WorldContextObject);
+
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Called every frame
+	virtual void Tick(float DeltaSeconds) override;
+
+	virtual void RegisterActorTickFunctions(bool bRegister) override;
+
+	//----------------------------------------------------------------
+	//Projectile pool
+	//----------------------------------------------------------------
+
+	/*Returns an activated skill of the given class - the skill is spawned only if the pool is empty*/
+	ASkill* AcquireSkill(TSubclassOf<ASkill> SkillClass, const FTransform& SpawnTransform, AActor* SkillOwner = nullptr, APawn* SkillInstigator = nullptr);
+
+	/*Returns the given skill to the pool*/
+	void ReleaseSkill(ASkill* Skill);
+
+	/*Drops a pooled skill which got destroyed while in flight from the pool's counters*/
+	void RemoveDestroyedSkill(ASkill* Skill) { ProjectilePool.RemoveDestroyed(Skill); }
+
+	/*Makes sure that at least Count skills of the given class wait in the pool*/
+	UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
+	void PrewarmSkillPool(TSubclassOf<ASkill> SkillClass, int32 Count);
+
+	/*Returns the pool counters of the given class - pass None for the whole pool*/
+	UFUNCTION(BlueprintCallable, Category = TLSkillsTree)
+	FSkillPoolStats GetSkillPoolStats(TSubclassOf<ASkill> SkillClass) const;
+
+	//----------------------------------------------------------------
+	//Batched projectile simulation
+	//----------------------------------------------------------------
+
+	/*Adds the given skill to the batched simulation and returns its handle*/
+	int32 RegisterSimulatedSkill(ASkill* Skill, const FVector& Velocity, float Radius, float GravityZ);
+
+	/*Removes the skill of the given handle from the batched simulation*/
+	void UnregisterSimulatedSkill(int32 Handle);
+
+	/*Steers a simulated skill towards the nearest skill target within Range - 0 turns homing off*/
+	void SetSimulatedSkillHoming(int32 Handle, float Acceleration, float Range) { ProjectileSimulation.SetHoming(Handle, Acceleration, Range); }
+
+	/*Moves a simulated skill to a new location and velocity - used to correct predicted projectiles*/
+	void TeleportSimulatedSkill(int32 Handle, const FVector& Location, const FVector& Velocity) { ProjectileSimulation.Teleport(Handle, Location, Velocity); }
+
+	/*Returns the number of skills in the batched simulation*/
+	int32 GetNumSimulatedSkills() const { return ProjectileSimulation.Num(); }
+
+	/*Returns where the batched simulation has the given skill on its last step - zero when the skill is not simulated*/
+	FVector GetSimulatedSkillLocation(const ASkill* Skill) const { return ProjectileSimulation.GetLocation(Skill->SimulationHandle); }
+
+	//----------------------------------------------------------------
+	//Expiry
+	//----------------------------------------------------------------
+
+	/*Releases the given skill after Delay seconds - returns the handle of the expiry*/
+	int32 ScheduleSkillExpiry(ASkill* Skill, float Delay);
+
+	/*Cancels the expiry of the given handle*/
+	void CancelSkillExpiry(int32 Handle);
+
+	/*Returns the number of scheduled expiries - every live skill with a lifetime has one, not only the ones about to be released*/
+	int32 GetNumScheduledExpiries() const { return ExpiryWheel.Num(); }
+
+	//----------------------------------------------------------------
+	//Hits
+	//----------------------------------------------------------------
+
+	/*Queues a hit for the batch after physics - returns false if the hit could not be queued*/
+	bool RecordSkillHit(const FSkillHitRecord& Record) { return HitBuffer.Append(Record); }
+
+	/*Applies the effects of every hit of this frame and notifies the subscribers*/
+	void ProcessSkillHits();
+
+	/*Gameplay systems subscribe here instead of binding to every skill*/
+	FOnSkillHitBatch OnSkillHitBatch;
+
+	//----------------------------------------------------------------
+	//Skill targets
+	//----------------------------------------------------------------
+
+	/*Makes the given actor a target of area of effect and homing skills - returns its handle*/
+	int32 RegisterSkillTarget(AActor* Target) { return TargetHash.Register(Target); }
+
+	/*Removes the target of the given handle - call it before the actor gets destroyed*/
+	void UnregisterSkillTarget(int32 Handle) { TargetHash.Unregister(Handle); }
+
+	/*Appends the targets within Radius of Center to OutTargets, as of the last frame - returns the amount of targets found*/
+	int32 FindSkillTargets(const FVector& Center, float Radius, TArray<AActor*, TInlineAllocator<16>>& OutTargets, const AActor* IgnoredActor = nullptr) const;
+
+	/*Returns the nearest target within MaxRadius of Center, as of the last frame - null if there is none*/
+	AActor* FindNearestSkillTarget(const FVector& Center, float MaxRadius, const AActor* IgnoredActor = nullptr) const;
+
+	/*Returns the number of skill targets*/
+	int32 GetNumSkillTargets() const { return TargetHash.Num(); }
+
+	//----------------------------------------------------------------
+	//Crowd casters
+	//----------------------------------------------------------------
+
+	/*Lets the crowd decide the casts of the given caster - TargetSlot is the caster's skill target handle. Returns its handle*/
+	int32 RegisterCrowdCaster(class ASkillCrowdCasterPawn* Caster, int32 TargetSlot);
+
+	/*Removes the caster of the given handle from the crowd*/
+	void UnregisterCrowdCaster(int32 Handle) { CrowdCasters.Remove(Handle); }
+
+	/*Returns the number of crowd casters*/
+	int32 GetNumCrowdCasters() const { return CrowdCasters.Num(); }
+
+	/*Returns the casts the crowd fired this frame*/
+	int32 GetNumCrowdCasts() const { return CrowdCasters.GetNumCasts(); }
+
+	//----------------------------------------------------------------
+	//Skill profiles
+	//----------------------------------------------------------------
+
+	/*Copies the saved skill tree of the given player to OutRecord - false if there is none or this is a client*/
+	bool LoadSkillProfile(uint64 Key, FSkillProfileRecord& OutRecord) const { return ProfileStore.IsOpen() && ProfileStore.Load(Key, OutRecord); }
+
+	/*Queues the given skill tree for the next batched write of the profile store*/
+	void SaveSkillProfile(const FSkillProfileRecord& Record) { ProfileStore.Save(Record); }
+
+	/*Returns the number of players in the profile store*/
+	int32 GetNumSkillProfiles() const { return ProfileStore.Num(); }
+
+	/*Saves the tree of the given component when the world ends, before the store gets closed - returns the handle*/
+	int32 RegisterSkillProfile(class USkillsComponent* SkillsComponent);
+
+	/*Stops saving the tree of the given handle when the world ends*/
+	void UnregisterSkillProfile(int32 Handle);
+
+	//----------------------------------------------------------------
+	//Lag compensation
+	//----------------------------------------------------------------
+
+	/*Records the given capsule so skills can be checked against its past - returns INDEX_NONE on clients or when the history is full*/
+	int32 RegisterLagCompensatedCapsule(UCapsuleComponent* Capsule) { return LagCompensation.Register(Capsule); }
+
+	/*Stops recording the capsule of the given handle*/
+	void UnregisterLagCompensatedCapsule(int32 Handle) { LagCompensation.Unregister(Handle); }
+
+	/*Appends every recorded capsule to OutCapsules - rewound skills ignore them in the present*/
+	void GetLagCompensatedCapsules(TArray<UPrimitiveComponent*>& OutCapsules) const { LagCompensation.GetCapsules(OutCapsules); }
+
+	/*Returns true if the given component is a recorded capsule*/
+	bool IsLagCompensated(const UPrimitiveComponent* Component) const { return LagCompensation.Contains(Component); }
+
+	/*Checks the given skill against the capsules as they were its LagCompensationTime ago, every frame until it hits - returns the handle*/
+	int32 RegisterRewoundSkill(ASkill* Skill);
+
+	/*Stops the rewound checks of the given handle*/
+	void UnregisterRewoundSkill(int32 Handle);
+
+	/*Returns the furthest a skill gets rewound in seconds*/
+	float GetMaxLagCompensation() const { return MaxLagCompensation; }
+
+	//----------------------------------------------------------------
+	//Asset streaming
+	//----------------------------------------------------------------
+
+	/*Starts loading the icons of the given skills - they stay loaded while the returned handle is alive*/
+	TSharedPtr<FStreamableHandle> RequestSkillIcons(const TArray<TSubclassOf<ASkill>>& SkillClasses, FStreamableDelegate OnLoaded);
+
+	/*Keeps the FX of the given skill loaded - call it when a character learns the skill*/
+	void AcquireSkillFX(TSubclassOf<ASkill> SkillClass);
+
+	/*Lets the FX of the given skill go cold - call it when a character unlearns the skill*/
+	void ReleaseSkillFX(TSubclassOf<ASkill> SkillClass);
+
+	/*Call before firing the given skill - keeps its FX warm and loads them right away if nobody did*/
+	void PrefetchSkillFX(TSubclassOf<ASkill> SkillClass);
+
+	//----------------------------------------------------------------
+	//Impact FX
+	//----------------------------------------------------------------
+
+	/*Plays the given impact FX from the shared emitter pool once the hits of the frame are processed - does nothing on dedicated servers*/
+	void PlayImpactFX(UParticleSystem* FX, const FVector& Location, const FRotator& Rotation) { ImpactFXPool.Request(FX, Location, Rotation); }
+
+	//----------------------------------------------------------------
+	//Instanced visuals
+	//----------------------------------------------------------------
+
+	/*Draws the given skill with the instanced mesh of its type while it is far away - returns INDEX_NONE on dedicated servers*/
+	int32 RegisterLightweightSkill(ASkill* Skill) { return InstancedVisuals.Add(Skill); }
+
+	/*Stops drawing the skill of the given handle*/
+	void UnregisterLightweightSkill(int32 Handle) { InstancedVisuals.Remove(Handle); }
+
+	/*Returns the number of lightweight skills drawn as instances in the last frame*/
+	int32 GetNumInstancedSkills() const { return InstancedVisuals.GetNumInstanced(); }
+
+	/*Returns the number of lightweight skills drawn with their own particles in the last frame*/
+	int32 GetNumParticleSkills() const { return InstancedVisuals.GetNumParticles(); }
+
+	/*Returns the number of instanced mesh components - one per skill type*/
+	int32 GetNumInstancedComponents() const { return InstancedVisuals.GetNumComponents(); }
+
+protected:
+	/*The resolution of skill expiries in seconds*/
+	UPROPERTY(Config)
+	float ExpiryTickInterval = 1.f / 60.f;
+
+	/*Simulated skills only get moved when they drifted further than this (in uu) from their last written location*/
+	UPROPERTY(Config)
+	float WriteBackTolerance = 1.f;
+
+	/*Same as WriteBackTolerance but for dedicated servers - overlaps and replication read the actors, so they get every move by default*/
+	UPROPERTY(Config)
+	float ServerWriteBackTolerance = 0.f;
+
+	/*The amount of skills each parallel simulation task integrates*/
+	UPROPERTY(Config)
+	int32 SimulationChunkSize = 512;
+
+	/*When true simulated skills sweep with async traces which get consumed on the next frame*/
+	UPROPERTY(Config)
+	bool bAsyncSkillSweeps = true;
+
+	/*When above 0 simulated skills advance in steps of this many seconds, independent of the frame rate - 0 uses the frame's delta time*/
+	UPROPERTY(Config)
+	float SimulationFixedStep = 0.f;
+
+	/*The most fixed steps per frame - a longer frame leaves its remaining time unsimulated*/
+	UPROPERTY(Config)
+	int32 MaxSimulationSubsteps = 8;
+
+	/*FX of skills which nobody learned get unloaded after this many seconds without being fired*/
+	UPROPERTY(Config)
+	float SkillFXColdTime = 30.f;
+
+	/*The amount of emitters which play the impact FX of the world*/
+	UPROPERTY(Config)
+	int32 ImpactFXPoolSize = 32;
+
+	/*The most impact FX which start per frame - the least significant ones get culled*/
+	UPROPERTY(Config)
+	int32 ImpactFXBudget = 16;
+
+	/*Impact FX further away from every viewer get culled*/
+	UPROPERTY(Config)
+	float ImpactFXCullDistance = 8000.f;
+
+	/*Impact FX further away from every viewer play at their lowest LOD*/
+	UPROPERTY(Config)
+	float ImpactFXDowngradeDistance = 3000.f;
+
+	/*The amount of lightweight skills nearest to the viewers which keep their particles - the rest are drawn as instances*/
+	UPROPERTY(Config)
+	int32 ProjectileParticleBudget = 16;
+
+	/*The size of the cells of the skill target grid - about the largest splash radius works best*/
+	UPROPERTY(Config)
+	float SkillTargetCellSize = 500.f;
+
+	/*The amount of buckets the cells of the skill target grid hash into*/
+	UPROPERTY(Config)
+	int32 SkillTargetBuckets = 4096;
+
+	/*The amount of crowd casters each parallel task thinks for*/
+	UPROPERTY(Config)
+	int32 CrowdCasterChunkSize = 256;
+
+	/*When true servers and standalone games save the skill trees of their players in SkillProfileFile.
+	Off by default - the ids of the NULL online subsystem are new every session, so its players would only fill the store*/
+	UPROPERTY(Config)
+	bool bSkillProfiles = false;
+
+	/*The profile store of the skill trees, relative to the saved directory*/
+	UPROPERTY(Config)
+	FString SkillProfileFile = TEXT("Profiles/SkillProfiles.bin");
+
+	/*The amount of profiles the store has room for at first - it doubles when it runs full*/
+	UPROPERTY(Config)
+	int32 SkillProfileCapacity = 4096;
+
+	/*Changed skill trees get written in one batch this often, in seconds*/
+	UPROPERTY(Config)
+	float SkillProfileFlushInterval = 1.f;
+
+	/*When true servers check the skills of remote shooters against where the shooters saw their targets*/
+	UPROPERTY(Config)
+	bool bLagCompensation = true;
+
+	/*The most capsules the lag compensation history holds*/
+	UPROPERTY(Config)
+	int32 LagCompensationCapsules = 128;
+
+	/*The amount of frames the lag compensation history holds - frames times MaxLagCompensation should fit in*/
+	UPROPERTY(Config)
+	int32 LagCompensationFrames = 64;
+
+	/*The furthest a skill gets rewound in seconds - shooters with a worse ping have to lead their targets*/
+	UPROPERTY(Config)
+	float MaxLagCompensation = 0.3f;
+
+private:
+	UPROPERTY()
+	FSkillProjectilePool ProjectilePool;
+
+	FSkillProjectileSimulation ProjectileSimulation;
+
+	FSkillExpiryWheel ExpiryWheel;
+
+	/*Skills which expired this frame - kept around so expiring doesn't allocate*/
+	TArray<ASkill*> ExpiredSkills;
+
+	/*Skill classes whose FX got evicted this frame - same*/
+	TArray<const UClass*> EvictedFXClasses;
+
+	FSkillHitBuffer HitBuffer;
+
+	FSkillAssetStreamer AssetStreamer;
+
+	FSkillLagCompensation LagCompensation;
+
+	/*The targets of area of effect and homing skills - updated once per frame after physics*/
+	FSkillSpatialHash TargetHash;
+
+	FSkillProfileStore ProfileStore;
+
+	/*NPCs whose casts get decided in one batch before the projectiles move*/
+	FSkillCrowdCasters CrowdCasters;
+
+	/*Time since the profile store was flushed last*/
+	float ProfileFlushTime = 0.f;
+
+	/*Components with a bound profile - their trees get saved before the store closes. Referenced so the collector nulls components which got destroyed without ending play*/
+	UPROPERTY()
+	TArray<class USkillsComponent*> ProfileComponents;
+
+	/*Skills of remote shooters which get checked against the capsule history*/
+	TArray<ASkill*> RewoundSkills;
+
+	/*Where each of the RewoundSkills was at the last check - the next check sweeps from there*/
+	TArray<FVector> RewoundStarts;
+
+	/*Hits the skills in RewoundSkills against the capsules as their shooters saw them*/
+	void ResolveRewoundHits();
+
+	UPROPERTY()
+	FSkillImpactFXPool ImpactFXPool;
+
+	UPROPERTY()
+	FSkillInstancedVisuals InstancedVisuals;
+
+	/*Processes the hits in TG_PostPhysics, after every skill moved*/
+	UPROPERTY()
+	FSkillHitTickFunction HitTickFunction;
+};